@@ -4,11 +4,17 @@
 Module of the main benchmark class, parent of all benchkit benchmarks.
 """
 
+import contextlib
 import inspect
+import io
 import itertools
 import json
 import os
 import pathlib
+import queue
+import threading
+import uuid
+from concurrent.futures import FIRST_EXCEPTION, Future, ThreadPoolExecutor, wait
 from multiprocessing import Barrier
 from subprocess import CalledProcessError
 from typing import IO, Any, Dict, Iterable, List, Optional, Protocol, Tuple
@@ -20,8 +26,16 @@ from benchkit.platforms import get_current_platform
 from benchkit.sharedlibs import SharedLib
 from benchkit.sharedlibs.tiltlib import TiltLib
 from benchkit.shell.shellasync import AsyncProcess, shell_async
+from benchkit.utils.convergence import ConvergenceCriterion
 from benchkit.utils.gdb import generate_gdb_script_from_cmd
 from benchkit.utils.misc import CSV_SEPARATOR, TimeMeasure, dict_union, seconds2pretty
+from benchkit.utils.parquetsink import (
+    ParquetSink,
+    comment_metadata,
+    parquet_dataset_path,
+)
+from benchkit.utils.partitions import RunPartition, get_run_partitions
+from benchkit.utils.recordindex import RecordIndex
 from benchkit.utils.system import get_boot_args
 from benchkit.utils.tee import teeprint
 from benchkit.utils.types import (
@@ -39,6 +53,41 @@ RecordValue = Any
 RecordParameters = Dict[RecordKey, RecordValue]
 RecordResult = Dict[RecordKey, RecordValue]
 
+HARNESS_RESULT_PREFIX = "[benchkit] "
+
+
+def _parse_harness_value(value: str) -> RecordValue:
+    for convert in (int, float):
+        try:
+            return convert(value)
+        except ValueError:
+            pass
+    return value
+
+
+def parse_harness_output(command_output: str) -> RecordResult:
+    """
+    Parse the result lines emitted by native benchmarks built with the benchkit harness
+    (benchkit/include/benchkit/harness.h), of the form "[benchkit] <key>=<value>".
+    Other lines of the output are ignored, and the last value of a key wins.
+
+    Args:
+        command_output (str):
+            raw output of the benchmark command.
+
+    Returns:
+        RecordResult: the results, with integer and floating-point values converted.
+    """
+    result = {}
+    for line in command_output.splitlines():
+        line = line.strip()
+        if not line.startswith(HARNESS_RESULT_PREFIX):
+            continue
+        key, sep, value = line[len(HARNESS_RESULT_PREFIX) :].partition("=")
+        if sep and key:
+            result[key.strip()] = _parse_harness_value(value.strip())
+    return result
+
 
 class WriteRecordFileFunction(Protocol):
     """
@@ -134,10 +183,18 @@ class Benchmark:
         self._use_tilt = None
         self._constants = None
         self._pretty_variables = None
+        self._nb_background_builds = 0
+        self._background_build_cpus = None
+        self._partitions: List[RunPartition] = []
+        self._convergence: Optional[ConvergenceCriterion] = None
+        self._parquet_row_group_size: Optional[int] = None
+        self._parquet_sink: Optional[ParquetSink] = None
 
         self._total_nb_runs = None
         self._nb_runs_done = 0
         self._first_line_is_printed = False
+        self._results_lock = threading.Lock()
+        self._thread_state = threading.local()
 
         self._debug = False
         self._gdb = False
@@ -301,6 +358,11 @@ class Benchmark:
         pretty_variables: Pretty,
         debug: bool,
         gdb: bool,
+        nb_background_builds: int = 0,
+        background_build_cpus: Optional[List[int]] = None,
+        concurrent_partitions: Optional[str | List[List[int]]] = None,
+        convergence: Optional[ConvergenceCriterion] = None,
+        parquet_row_group_size: Optional[int] = None,
     ) -> None:
         """
         Configure the benchmark variables once they are associated with a campaign.
@@ -319,7 +381,8 @@ class Benchmark:
                 duration, in seconds, of a single run of the benchmark (when the benchmark supports
                 a fixed duration).
             nb_runs (int):
-                number of runs for each fixed configuration (with the same variable values).
+                number of runs for each fixed configuration (with the same variable values), or
+                maximal number of runs when a convergence criterion is given.
             constants (Constants):
                 constant columns to add to the results.
             variables (RecordParameters):
@@ -330,9 +393,35 @@ class Benchmark:
                 whether to enable debug.
             gdb (bool):
                 whether to enable gdb.
+            nb_background_builds (int, optional):
+                number of upcoming build variants to build in the background (see
+                background_build_bench) while the runs of the current variant are measured.
+                Defaults to 0, where the builds and the runs strictly alternate.
+            background_build_cpus (Optional[List[int]], optional):
+                CPUs on which the background builds run, out of the CPUs the benchmark is measured
+                on (see background_build_cpus). None takes the CPUs out of all the partitions when
+                concurrent_partitions is given. Defaults to None.
+            concurrent_partitions (Optional[str | List[List[int]]], optional):
+                partitions of the platform on which independent records run concurrently, each
+                run confined to a partition (see get_run_partitions): "numa" for one partition
+                per NUMA node, or the list of CPUs of each partition. None runs the records one at
+                a time, on the whole platform. Defaults to None.
+            convergence (Optional[ConvergenceCriterion], optional):
+                criterion to stop the runs of a configuration as soon as the confidence interval
+                of the mean of a metric is narrow enough (after at most nb_runs runs). Each result
+                line then reports this relative interval so far (the <metric>_rel_ci column) and
+                whether it converged (<metric>_converged). None runs nb_runs times every
+                configuration. Defaults to None.
+            parquet_row_group_size (Optional[int], optional):
+                when given, the result lines are also written in the Parquet dataset next to the
+                CSV output file (see parquet_dataset_path), in a new file every this number of
+                lines, with the header of the CSV file as metadata. It requires pyarrow. None only
+                writes the CSV file. Defaults to None.
 
         Raises:
-            ValueError: if the benchmark is already configured.
+            ValueError:
+                if the benchmark is already configured, or if the background builds have no CPUs
+                of their own.
         """
         if self._configured:
             raise ValueError("Benchmark already configured")
@@ -354,6 +443,14 @@ class Benchmark:
         self._debug = debug
         self._gdb = gdb
 
+        self._nb_background_builds = nb_background_builds
+        self._partitions = get_run_partitions(platform=self.platform, spec=concurrent_partitions)
+        self._background_build_cpus = self._checked_background_build_cpus(
+            cpus=background_build_cpus,
+        )
+        self._convergence = convergence
+        self._parquet_row_group_size = parquet_row_group_size
+
     def valid_experiment_parameters(
         self,
         **kwargs,
@@ -380,7 +477,8 @@ class Benchmark:
 
     def total_nb_runs(self) -> int:
         """
-        Compute the total number of runs of this benchmark once configured.
+        Compute the total number of runs of this benchmark once configured (an upper bound when the
+        runs of the configurations stop on convergence).
 
         Returns:
             int: the total number of runs.
@@ -465,40 +563,6 @@ class Benchmark:
 
         return records, print_comments
 
-    def filter_result_execution_set(
-        self,
-        record_params: Dict[str, Any],
-        executions_dict: List[Dict[str, str]],
-    ) -> List[Dict[str, str]]:
-        """
-        Remove from executions_dict keys that are not parameters. I.e., remove result keys.
-
-        Args:
-            record_params (Dict[str, Any]):
-                parameters of the current record.
-            executions_dict (List[Dict[str, str]]):
-                currently recorded results of executions.
-
-        Returns:
-            List[Dict[str, str]]:
-                the filtered executions_dict.
-        """
-        if executions_dict:
-            for execution in executions_dict:
-                results_keys = execution.keys() - record_params.keys()
-                results_keys = results_keys - self._constants.keys()
-                results_keys = results_keys - {"experiment_name", "rep"}
-
-                pretty_keys = [k for k in results_keys if k.endswith("_pretty")]
-                for pretty_key in pretty_keys:
-                    results_keys.remove(pretty_key)
-
-                for key in results_keys:
-                    if key in execution:
-                        execution.pop(key)
-
-        return executions_dict
-
     def run(
         self,
         other_campaigns_seconds: int,
@@ -517,6 +581,13 @@ class Benchmark:
                 whether caching of results is enabled.
         """
         self._check_config()
+        if barrier is not None and self._partitions:
+            raise ValueError("Concurrent runs on partitions cannot be synchronized with a barrier")
+        if self._convergence is not None and self.in_process_repetitions():
+            raise ValueError(
+                "A convergence criterion cannot stop the repetitions run in a single run of the "
+                "benchmark (in_process_repetitions): disable one of them"
+            )
 
         self._other_campaigns_seconds = other_campaigns_seconds
 
@@ -542,24 +613,37 @@ class Benchmark:
             total_seconds=expected_total_seconds,
         )
 
-        with TimeMeasure() as run_duration:
+        with TimeMeasure() as run_duration, contextlib.ExitStack() as closing:
             executions_dict, print_comments_header = self.get_execution_set(continuing)
-
-            if print_comments_header:
-                with open(self._csv_output_path, "a") as csv_output_file:
-                    self._log_headers(
-                        output_file=csv_output_file,
-                        experiment_name=self._experiment_name,
-                        benchmark_duration_seconds=self._benchmark_duration_seconds,
-                        nb_runs=self._nb_runs,
-                        start_time=run_duration.start_time,
-                        expected_duration_seconds=expected_total_seconds,
+            cached_records = RecordIndex(records=executions_dict)
+
+            if print_comments_header or self._parquet_row_group_size is not None:
+                headers = io.StringIO()
+                self._log_headers(
+                    output_file=headers,
+                    experiment_name=self._experiment_name,
+                    benchmark_duration_seconds=self._benchmark_duration_seconds,
+                    nb_runs=self._nb_runs,
+                    start_time=run_duration.start_time,
+                    expected_duration_seconds=expected_total_seconds,
+                )
+                if prebuild_seconds is not None:
+                    self._log_prebuild_time(
+                        output_file=headers,
+                        prebuild_seconds=prebuild_seconds,
                     )
-                    if prebuild_seconds is not None:
-                        self._log_prebuild_time(
-                            output_file=csv_output_file,
-                            prebuild_seconds=prebuild_seconds,
-                        )
+                if print_comments_header:
+                    with open(self._csv_output_path, "a") as csv_output_file:
+                        csv_output_file.write(headers.getvalue())
+                if self._parquet_row_group_size is not None:
+                    self._parquet_sink = ParquetSink(
+                        dataset_path=parquet_dataset_path(csv_output_path=self._csv_output_path),
+                        metadata=comment_metadata(comments=headers.getvalue()),
+                        row_group_size=self._parquet_row_group_size,
+                        nb_thread_columns=self._max_nb_threads(),
+                    )
+                    # the lines so far stay in the dataset, as in the CSV file, if the runs fail
+                    closing.callback(self._close_parquet_sink)
 
             self._nb_runs_done = 0
             self._first_line_is_printed = False
@@ -568,7 +652,7 @@ class Benchmark:
                 variables_names=self.get_build_var_names(),
                 bench_variables=self._variables,
             )
-
+            build_groups = []
             for build_variables, build_run_variables in build_gb:
                 example_build_run_variables = build_run_variables[0]
                 actual_build_variables = {
@@ -579,28 +663,39 @@ class Benchmark:
                         and var_value == example_build_run_variables[var_name]
                     )
                 }
-                valid = self._build_one_bench(actual_build_variables)
-                if valid:
-                    for record_params in build_run_variables:
-                        executions_dict = self.filter_result_execution_set(
-                            record_params,
-                            executions_dict,
-                        )
-
-                        self._run_single_run(
-                            record_parameters=record_params,
-                            executions_dict=executions_dict,
+                build_groups.append((actual_build_variables, build_run_variables))
+
+            with ThreadPoolExecutor(max_workers=1) as background_builder:
+                background_builds: Dict[int, Future] = {}
+                for group_index, (actual_build_variables, build_run_variables) in enumerate(
+                    build_groups
+                ):
+                    if group_index in background_builds:
+                        background_builds[group_index].result()
+                    valid = self._build_one_bench(actual_build_variables)
+                    self._submit_background_builds(
+                        background_builder=background_builder,
+                        background_builds=background_builds,
+                        build_groups=build_groups,
+                        current_index=group_index,
+                    )
+                    if valid:
+                        self._run_records(
+                            records=build_run_variables,
+                            cached_records=cached_records,
                             continuing=continuing,
                             barrier=barrier,
                         )
 
         actual_total_seconds = run_duration.duration_seconds
 
+        footers = io.StringIO()
+        self._log_footers(
+            output_file=footers,
+            total_duration_seconds=actual_total_seconds,
+        )
         with open(self._csv_output_path, "a") as csv_output_file:
-            self._log_footers(
-                output_file=csv_output_file,
-                total_duration_seconds=actual_total_seconds,
-            )
+            csv_output_file.write(footers.getvalue())
 
         print(f"[INFO] Benchmark done. " f'Results are stored in: "{self._csv_output_path}"')
 
@@ -631,6 +726,30 @@ class Benchmark:
         """
         pass
 
+    def background_build_bench(
+        self,
+        cpus: Optional[List[int]],
+        parallel_make_str: str,
+        **kwargs,
+    ) -> None:
+        """
+        Build the benchmark ahead of time for the given build variables, while the runs of another
+        build variant are measured (see the nb_background_builds option of the campaigns).
+        The build must land out of the way of the running benchmark (e.g. in a per-variant build
+        directory), such that the later build_bench call with the same build variables just picks
+        up its result. It is called from a background thread.
+
+        Args:
+            cpus (Optional[List[int]]):
+                CPUs to confine the build commands to (e.g. with taskset), or None.
+            parallel_make_str (str):
+                the parallelism option of make matching these CPUs (e.g. " -j 4 ").
+
+        Raises:
+            NotImplementedError: if the benchmark does not support background builds.
+        """
+        raise NotImplementedError
+
     def build_bench(
         self,
         **kwargs,
@@ -656,6 +775,21 @@ class Benchmark:
         """
         raise NotImplementedError
 
+    def in_process_repetitions(self) -> bool:
+        """
+        Return whether a single run of the benchmark executes the repetitions of a record back to
+        back in the same process, to amortize the start-up of the benchmark process.
+        If so, single_run receives the number of repetitions to run as its `nb_repetitions`
+        keyword argument, and parse_output_to_results returns one result per repetition, each
+        with its `rep` (from 1 to `nb_repetitions`). When continuing a campaign, only the
+        repetitions missing from the result file run. A convergence criterion cannot be used with
+        such benchmarks, as all the repetitions are done at once.
+
+        Returns:
+            bool: whether the repetitions run in the same process. Defaults to False.
+        """
+        return False
+
     def parse_output_to_results(
         self,
         command_output: str,
@@ -668,6 +802,9 @@ class Benchmark:
         """
         Parse the output of the benchmark commands and convert it into a dictionary of recorded
         results.
+        By default, the results are the lines emitted with the benchkit harness of native
+        benchmarks (see parse_harness_output); benchmarks with another output format override
+        this method.
 
         Args:
             command_output (str):
@@ -685,7 +822,13 @@ class Benchmark:
             RecordResult:
                 the record results corresponding to the output of the run.
         """
-        raise NotImplementedError
+        result = parse_harness_output(command_output=command_output)
+        if not result:
+            raise NotImplementedError(
+                "The benchmark output holds no benchkit harness result line: "
+                "parse_output_to_results must be implemented by the benchmark."
+            )
+        return result
 
     def run_bench_command(
         self,
@@ -728,6 +871,9 @@ class Benchmark:
                 environment=environment,
             )
             return ""  # unreachable
+        partition = self.current_partition()
+        if partition is not None:
+            wrapped_run_command = partition.command_prefix() + list(wrapped_run_command)
         if self._command_is_async():
             process = self._run_async_bench_command(
                 wrapped_run_command=wrapped_run_command,
@@ -748,6 +894,29 @@ class Benchmark:
         )
         return output
 
+    def current_partition(self) -> Optional[RunPartition]:
+        """
+        Return the partition of the platform on which the current run executes, when the records
+        run concurrently on partitions (see configure_variables), so that the benchmark can e.g.
+        pin its threads within the partition.
+
+        Returns:
+            Optional[RunPartition]: the partition of the current run, None if runs are sequential.
+        """
+        return getattr(self._thread_state, "partition", None)
+
+    def background_build_cpus(self) -> List[int]:
+        """
+        Return the CPUs on which the background builds run while the benchmark is measured (see
+        configure_variables), so that the benchmark can keep its threads out of them.
+
+        Returns:
+            List[int]: the CPUs of the background builds, empty if there are no background builds.
+        """
+        if self._nb_background_builds == 0:
+            return []
+        return list(self._background_build_cpus)
+
     def must_debug(self) -> bool:
         """
         Return whether the benchmark must be debugged.
@@ -798,13 +967,18 @@ class Benchmark:
         )
         raise SystemExit(0)
 
+    def _close_parquet_sink(self) -> None:
+        self._parquet_sink.close()
+        print(f'[INFO] Results are also stored in: "{self._parquet_sink.path}"')
+        self._parquet_sink = None
+
     def _max_nb_threads(self) -> int:
         # we allow over-subscription
         result = 4 * self.platform.nb_cpus()
         return result
 
-    def _parallel_make_str(self) -> str:
-        nb_active_cpus = self.platform.nb_active_cpus()
+    def _parallel_make_str(self, cpus: Optional[List[int]] = None) -> str:
+        nb_active_cpus = self.platform.nb_active_cpus() if cpus is None else len(cpus)
         parallel_make_str = f" -j {nb_active_cpus} " if nb_active_cpus > 1 else ""
         return parallel_make_str
 
@@ -881,6 +1055,106 @@ class Benchmark:
         )
         return True
 
+    def _submit_background_builds(
+        self,
+        background_builder: ThreadPoolExecutor,
+        background_builds: Dict[int, Future],
+        build_groups: List[Tuple[Dict[str, Any], List[Dict[str, Any]]]],
+        current_index: int,
+    ) -> None:
+        """
+        Start in the background the builds of the next build groups, up to nb_background_builds
+        groups ahead of the current one. They run one at a time, in the order of the groups.
+
+        Args:
+            background_builder (ThreadPoolExecutor):
+                executor running the background builds.
+            background_builds (Dict[int, Future]):
+                the background builds started so far, by index of their build group; updated.
+            build_groups (List[Tuple[Dict[str, Any], List[Dict[str, Any]]]]):
+                the build variables and the records of each build group.
+            current_index (int):
+                index of the build group being run.
+        """
+        last_index = min(current_index + self._nb_background_builds, len(build_groups) - 1)
+        for group_index in range(current_index + 1, last_index + 1):
+            build_variables, _ = build_groups[group_index]
+            if group_index in background_builds or not self.valid_experiment_parameters(
+                **build_variables
+            ):
+                continue
+            background_builds[group_index] = background_builder.submit(
+                self._background_build_one_bench,
+                build_variables,
+            )
+
+    def _checked_background_build_cpus(
+        self,
+        cpus: Optional[List[int]],
+    ) -> Optional[List[int]]:
+        """
+        Check that the background builds, if any, run on CPUs of their own, out of the partitions
+        of the runs.
+
+        Args:
+            cpus (Optional[List[int]]):
+                the CPUs given for the background builds, None to take the CPUs out of all the
+                partitions.
+
+        Raises:
+            ValueError: if there are no such CPUs, or if some of them are in a partition.
+
+        Returns:
+            Optional[List[int]]: the CPUs of the background builds.
+        """
+        if self._nb_background_builds <= 0:
+            return cpus
+
+        partition_cpus = {cpu for partition in self._partitions for cpu in partition.cpus}
+        if cpus is None:
+            if not self._partitions:
+                raise ValueError(
+                    "Background builds need CPUs of their own, out of the CPUs of the runs: "
+                    "give background_build_cpus"
+                )
+            cpus = sorted(set(range(self.platform.nb_cpus())) - partition_cpus)
+            if not cpus:
+                raise ValueError(
+                    "The partitions leave no CPU to the background builds: "
+                    "give background_build_cpus out of them"
+                )
+        if not cpus:
+            raise ValueError("The list of the CPUs of the background builds is empty")
+
+        shared_cpus = partition_cpus.intersection(cpus)
+        if shared_cpus:
+            raise ValueError(
+                f"The CPUs {sorted(shared_cpus)} of the background builds are in the partitions of "
+                "the runs"
+            )
+        return list(cpus)
+
+    def _background_build_one_bench(
+        self,
+        build_variables: Dict[str, Any],
+    ) -> None:
+        if self._nb_background_builds == 0:
+            return
+        cpus = self._background_build_cpus
+        try:
+            self.background_build_bench(
+                cpus=cpus,
+                parallel_make_str=self._parallel_make_str(cpus=cpus),
+                benchmark_duration_seconds=self._benchmark_duration_seconds,
+                **build_variables,
+            )
+        except NotImplementedError:
+            print(
+                "[WARNING] The benchmark does not support background builds, "
+                "each variant is built before its runs."
+            )
+            self._nb_background_builds = 0
+
     def _group_record_parameters(
         self,
         record_parameters: Dict[str, Any],
@@ -911,25 +1185,76 @@ class Benchmark:
         }
         return build_variables, run_variables, tilt_variables, other_variables
 
-    def _is_result_cached(
+    def _cached_result(
         self,
-        record_to_run: Dict[str, Any],
-        cached_records: Iterable[Dict[str, Any]],
-    ) -> bool:
-        for cached_record in cached_records:
-            same_record = True
-            for key in record_to_run:
-                if key in cached_record:
-                    if cached_record[key] != record_to_run[key]:
-                        same_record = False
-                        break
-            if same_record:
-                return True
+        record_to_run: Dict[str, str],
+        record_parameters: Dict[str, Any],
+        cached_records: RecordIndex,
+    ) -> Optional[Dict[str, str]]:
+        """
+        Return the cached result of the record if it has already been run, i.e. the cached record
+        with the same parameters, constants, experiment name and run number.
+
+        Args:
+            record_to_run (Dict[str, str]):
+                the record to run, its values converted to strings as in the CSV file.
+            record_parameters (Dict[str, Any]):
+                input parameters of the record.
+            cached_records (RecordIndex):
+                index of the records of the CSV file.
+
+        Returns:
+            Optional[Dict[str, str]]: the cached record, or None if the record is not in the cache.
+        """
+        columns = list(record_parameters) + ["experiment_name", "rep"]
+        if self._constants is not None:
+            columns.extend(self._constants)
+        return cached_records.find(record=record_to_run, columns=columns)
+
+    def _missing_run_ids(
+        self,
+        first_run_id: int,
+        record_to_run: Dict[str, str],
+        record_parameters: Dict[str, Any],
+        cached_records: Optional[RecordIndex],
+    ) -> List[int]:
+        """
+        Return the runs of a record still to run from the given one, which is not cached, when
+        its repetitions run in a single run of the benchmark (see in_process_repetitions).
+
+        Args:
+            first_run_id (int):
+                the first run of the record that is not cached.
+            record_to_run (Dict[str, str]):
+                the record of this run, its values converted to strings as in the CSV file.
+            record_parameters (Dict[str, Any]):
+                input parameters of the record.
+            cached_records (Optional[RecordIndex]):
+                index of the records of the CSV file, None if the campaign is not continued.
+
+        Returns:
+            List[int]: the identifiers of the runs to do, in increasing order.
+        """
+        result = [first_run_id]
+        for run_id in range(first_run_id + 1, self._nb_runs + 1):
+            if cached_records is None or (
+                self._cached_result(
+                    record_to_run=dict_union(record_to_run, {"rep": str(run_id)}),
+                    record_parameters=record_parameters,
+                    cached_records=cached_records,
+                )
+                is None
+            ):
+                result.append(run_id)
+        return result
 
     def _temp_record_prefix(self) -> pathlib.Path:
-        # TODO warning, does not support concurrent execution
-        # for this, need a unique record path for each benchmark run
-        return pathlib.Path("/tmp/benchkit_record")
+        # unique for each thread running records, so that concurrent runs do not share it
+        prefix = getattr(self._thread_state, "record_prefix", None)
+        if prefix is None:
+            prefix = pathlib.Path(f"/tmp/benchkit_record-{uuid.uuid4().hex}")
+            self._thread_state.record_prefix = prefix
+        return prefix
 
     def _temp_record_data_dir(self, record_data_dir: pathlib.Path):
         # The ./ prefix is necessary since pathlib ignores the first
@@ -938,10 +1263,69 @@ class Benchmark:
         # never an absolute path. 
         return self._temp_record_prefix() / f"./{record_data_dir}"
 
+    def _run_records(
+        self,
+        records: List[Dict[str, Any]],
+        cached_records: RecordIndex,
+        continuing: bool,
+        barrier: Optional[Barrier],
+    ) -> None:
+        """
+        Run the given records (of the same build variant), one after the other, or concurrently
+        when partitions are configured: each record then runs on the first partition that is free,
+        its runs confined to the partition.
+
+        Args:
+            records (List[Dict[str, Any]]):
+                input parameters of the records to run.
+            cached_records (RecordIndex):
+                records already stored in the CSV file, when continuing a campaign.
+            continuing (bool):
+                whether caching of the results is enabled.
+            barrier (Optional[Barrier]):
+                if applicable, the barrier for the benchmark to wait (runs are then sequential).
+        """
+        if not self._partitions:
+            for record_params in records:
+                self._run_single_run(
+                    record_parameters=record_params,
+                    cached_records=cached_records,
+                    continuing=continuing,
+                    barrier=barrier,
+                )
+            return
+
+        free_partitions: queue.Queue[RunPartition] = queue.Queue()
+        for partition in self._partitions:
+            free_partitions.put(partition)
+
+        def run_on_free_partition(record_params: Dict[str, Any]) -> None:
+            # there are as many workers as partitions, so one is always free
+            partition = free_partitions.get()
+            self._thread_state.partition = partition
+            try:
+                self._run_single_run(
+                    record_parameters=record_params,
+                    cached_records=cached_records,
+                    continuing=continuing,
+                    barrier=None,
+                )
+            finally:
+                self._thread_state.partition = None
+                free_partitions.put(partition)
+
+        with ThreadPoolExecutor(max_workers=len(self._partitions)) as executor:
+            futures = [executor.submit(run_on_free_partition, r) for r in records]
+            done, not_done = wait(futures, return_when=FIRST_EXCEPTION)
+            for future in not_done:
+                future.cancel()
+            for future in done:
+                future.result()
+
     def _run_single_run(
         self,
         record_parameters: Dict[str, Any],
-        executions_dict: Iterable[Dict[str, str]],
+        cached_records: RecordIndex,
         continuing: bool,
         barrier: Optional[Barrier],
     ) -> None:
@@ -951,8 +1335,8 @@ class Benchmark:
         Args:
             record_parameters (Dict[str, Any]):
                 input parameters for the current record run.
-            executions_dict (Iterable[Dict[str, str]]):
-                current information that need to be stored in the record.
+            cached_records (RecordIndex):
+                records already stored in the CSV file, when continuing a campaign.
             continuing (bool):
                 whether caching of the results is enabled.
             barrier (Optional[Barrier]):
@@ -964,6 +1348,8 @@ class Benchmark:
             _,  # tilt_variables, TODO remove tilt
             other_variables,
         ) = self._group_record_parameters(record_parameters=record_parameters)
+        in_process_repetitions = self.in_process_repetitions()
+        metric_values: List[float] = []  # values of the convergence metric, if any, in each run
 
         for run_id in range(1, self._nb_runs + 1):
             record_data_dir = self._record_data_dir(
@@ -989,6 +1375,9 @@ class Benchmark:
                     experiment_results[f"{var_name}_pretty"] = f'"{pretty_var_value}"'
 
             experiment_results.update({"rep": run_id})
+            partition = self.current_partition()
+            if partition is not None:
+                experiment_results["run_partition"] = partition.index
 
             if not self.valid_experiment_parameters(**experiment_results):
                 break
@@ -1009,13 +1398,30 @@ class Benchmark:
 
             # If this execution has already been done and continuing option is activated,
             # then skip
-            if continuing and self._is_result_cached(execution_parameters, executions_dict):
+            cached_result = None
+            if continuing:
+                cached_result = self._cached_result(
+                    record_to_run=execution_parameters,
+                    record_parameters=record_parameters,
+                    cached_records=cached_records,
+                )
+            if cached_result is not None:
                 print("[CONTINUING] This execution has already been done. Skipping it")
-                self._nb_runs_done += 1
-                if not self._first_line_is_printed:
-                    self._first_line_is_printed = True
-                    with open(self._csv_output_path, "a") as csv_output_file:
-                        teeprint(content="# Continuing campaign execution", file=csv_output_file)
+                with self._results_lock:
+                    self._nb_runs_done += 1
+                    if not self._first_line_is_printed:
+                        self._first_line_is_printed = True
+                        with open(self._csv_output_path, "a") as csv_output_file:
+                            teeprint(
+                                content="# Continuing campaign execution",
+                                file=csv_output_file,
+                            )
+                if self._convergence is not None:
+                    metric = self._convergence.metric
+                    if cached_result.get(metric) not in (None, ""):  # 0 is a legitimate value
+                        metric_values.append(float(cached_result[metric]))
+                    if self._record_converged(metric_values=metric_values, run_id=run_id):
+                        break
                 continue
 
             # Replace record_data_dir with a temporary data directory for the 
@@ -1037,11 +1443,24 @@ class Benchmark:
                 if barrier_ret == 0:
                     barrier.reset()
 
+            # the missing repetitions of the record all run in this single run, if supported
+            repetition_variables = {}
+            repetition_run_ids = [run_id]
+            if in_process_repetitions:
+                repetition_run_ids = self._missing_run_ids(
+                    first_run_id=run_id,
+                    record_to_run=execution_parameters,
+                    record_parameters=record_parameters,
+                    cached_records=cached_records if continuing else None,
+                )
+                repetition_variables["nb_repetitions"] = len(repetition_run_ids)
+
             single_run_return = self.single_run(
                 platform=self.platform,
                 benchmark_duration_seconds=self._benchmark_duration_seconds,
                 build_variables=build_variables,
                 record_data_dir=temp_record_data_dir,
+                **repetition_variables,
                 **run_variables,
             )
 
@@ -1071,7 +1490,9 @@ class Benchmark:
                 record_data_dir=record_data_dir,
             )
 
-            self._nb_runs_done += 1
+            with self._results_lock:
+                # the cached repetitions after this run are done as well
+                self._nb_runs_done += (self._nb_runs - run_id + 1) if in_process_repetitions else 1
             experiment_results_header = experiment_results
 
             if isinstance(single_run_results, list):
@@ -1084,6 +1505,16 @@ class Benchmark:
                 record_params_results = dict_union(experiment_results_header, single_run_results)
                 experiment_results_lines = [record_params_results]
 
+            if in_process_repetitions:
+                # the results give their repetition (from 1), i.e. the index of the missing run
+                result_lines = (
+                    single_run_results
+                    if isinstance(single_run_results, list)
+                    else [single_run_results]
+                )
+                for result_line, line in zip(result_lines, experiment_results_lines):
+                    line["rep"] = repetition_run_ids[int(result_line.get("rep", 1)) - 1]
+
             def wrdr(file_content: str, filename: PathType) -> None:
                 self._write_to_record_data_dir(
                     file_content=file_content,
@@ -1101,13 +1532,27 @@ class Benchmark:
                     for xrline in experiment_results_lines:
                         xrline.update(hook_dict)
 
+            if self._convergence is not None:
+                self._add_convergence_columns(
+                    experiment_results_lines=experiment_results_lines,
+                    metric_values=metric_values,
+                )
+
             wrdr(
                 file_content=json.dumps(experiment_results_lines, indent=4).strip() + "\n",
                 filename="experiment_results.json",
             )
 
-            with open(self._csv_output_path, "a") as csv_output_file:
+            with self._results_lock, open(self._csv_output_path, "a") as csv_output_file:
                 for experiment_results_line in experiment_results_lines:
+                    # the number of thread_<k> columns varies between the records: they come last,
+                    # so that the other columns stay aligned with the header
+                    experiment_results_line = dict(
+                        sorted(
+                            experiment_results_line.items(),
+                            key=lambda item: item[0].startswith("thread_"),
+                        )
+                    )
                     sep = CSV_SEPARATOR
                     if not self._first_line_is_printed:
                         header_list = list(experiment_results_line.keys())
@@ -1130,6 +1575,71 @@ class Benchmark:
                         self._first_line_is_printed = True
                     current_line = sep.join(map(str, experiment_results_line.values()))
                     teeprint(content=current_line, file=csv_output_file)
+                    if self._parquet_sink is not None:
+                        self._parquet_sink.append(row=experiment_results_line)
+
+            if in_process_repetitions:
+                break
+            if self._convergence is not None and self._record_converged(
+                metric_values=metric_values,
+                run_id=run_id,
+            ):
+                break
+
+    def _add_convergence_columns(
+        self,
+        experiment_results_lines: List[RecordResult],
+        metric_values: List[float],
+    ) -> None:
+        """
+        Add the values of the convergence metric of the result lines of a run to the values of the
+        previous runs, and report in each line the confidence interval reached so far.
+
+        Args:
+            experiment_results_lines (List[RecordResult]): the result lines of the run.
+            metric_values (List[float]): the values of the metric in the previous runs, extended.
+
+        Raises:
+            ValueError: if a result line has no value for the convergence metric.
+        """
+        metric = self._convergence.metric
+        for line in experiment_results_lines:
+            if metric not in line:
+                raise ValueError(f'The results have no "{metric}" metric to converge: {line}')
+            metric_values.append(float(line[metric]))
+            line[f"{metric}_rel_ci"] = self._convergence.relative_half_width(values=metric_values)
+            line[f"{metric}_converged"] = self._convergence.is_converged(values=metric_values)
+
+    def _record_converged(
+        self,
+        metric_values: List[float],
+        run_id: int,
+    ) -> bool:
+        """
+        Return whether the runs of a record can stop after the given run, since the convergence
+        metric has converged.
+
+        Args:
+            metric_values (List[float]): the values of the metric in the runs done so far.
+            run_id (int): the number of the last run done.
+
+        Returns:
+            bool: whether the metric has converged.
+        """
+        if not self._convergence.is_converged(values=metric_values):
+            return False
+        nb_skipped_runs = self._nb_runs - run_id
+        if nb_skipped_runs > 0:
+            relative_ci = self._convergence.relative_half_width(values=metric_values)
+            print(
+                f"[INFO] {self._convergence.metric} converged after {run_id} runs "
+                f"(relative confidence interval: {relative_ci:.2%}), "
+                f"skipping the {nb_skipped_runs} remaining runs"
+            )
+            with self._results_lock:
+                # the total number of runs is an upper bound, the skipped runs count as done
+                self._nb_runs_done += nb_skipped_runs
+        return True
 
     def _record_data_dir(
         self,
@@ -1183,6 +1693,8 @@ class Benchmark:
         log_line(f"benchmark_campaign_name: {experiment_name}")
         log_line(f"benchmark_duration_seconds: {benchmark_duration_seconds}")
         log_line(f"nb_runs: {nb_runs}")
+        if self._convergence is not None:
+            log_line(f"convergence: {self._convergence}")
 
         date_val = start_time.strftime("%Y%m%d_%H%M%S")
         log_line(f"date: {start_time}")
@@ -23,8 +23,10 @@ from benchkit.lwchart import (
     identical_dataframe,
 )
 from benchkit.platforms import Platform, get_current_platform
+from benchkit.utils.convergence import ConvergenceCriterion
 from benchkit.utils.dir import parentdir
 from benchkit.utils.misc import seconds2pretty
+from benchkit.utils.parquetsink import parquet_dataset_path
 from benchkit.utils.types import Constants, PathType, Pretty
 from benchkit.utils.variables import cartesian_product
 
@@ -72,6 +74,11 @@ class Campaign:
             pretty_variables=params.get("pretty"),
             debug=debug,
             gdb=gdb,
+            nb_background_builds=params.get("nb_background_builds", 0),
+            background_build_cpus=params.get("background_build_cpus"),
+            concurrent_partitions=params.get("concurrent_partitions"),
+            convergence=params.get("convergence"),
+            parquet_row_group_size=params.get("parquet_row_group_size"),
         )
 
     def csv_file(
@@ -214,6 +221,20 @@ class Campaign:
         """
         return self._benchmark.total_nb_runs()
 
+    def chart_results_path(self) -> pathlib.Path:
+        """
+        Return the path of the results from which the charts of this campaign are generated: the
+        Parquet dataset when the campaign writes one (the charts then only read the columns they
+        plot), the CSV output file otherwise.
+
+        Returns:
+            pathlib.Path: the absolute path of the results to plot.
+        """
+        result_csv_path = pathlib.Path(os.path.abspath(self.parameters.get("result_csv_path")))
+        if self.parameters.get("parquet_row_group_size") is not None:
+            return parquet_dataset_path(csv_output_path=result_csv_path)
+        return result_csv_path
+
     def generate_graph(
         self,
         plot_name: str | List[str],
@@ -237,10 +258,8 @@ class Campaign:
             )
             return
 
-        result_csv_path = os.path.abspath(self.parameters.get("result_csv_path"))
-
         generate_chart_from_single_csv(
-            csv_pathname=result_csv_path,
+            csv_pathname=self.chart_results_path(),
             output_dir=base_data_dir,
             plot_name=plot_name,
             prefix=prefix,
@@ -375,7 +394,7 @@ class CampaignSuite:
                 suite_path = parentdir(suite_path_tentative)
 
         generate_chart_from_multiple_csvs(
-            csv_pathnames=result_csv_paths,
+            csv_pathnames=[c.chart_results_path() for c in self._campaigns],
             plot_name=plot_name,
             output_dir=suite_path,
             process_dataframe=process_dataframe,
@@ -413,6 +432,11 @@ class CampaignTemplate(Campaign):
         benchmark_duration_seconds: Optional[int] = None,
         results_dir: Optional[PathType] = None,
         pretty: Pretty | None = None,
+        nb_background_builds: int = 0,
+        background_build_cpus: Optional[List[int]] = None,
+        concurrent_partitions: Optional[str | List[List[int]]] = None,
+        convergence: Optional[ConvergenceCriterion] = None,
+        parquet_row_group_size: Optional[int] = None,
     ):
         csv_filename = self.csv_file(
             campaign_name="benchmark",
@@ -461,6 +485,12 @@ class CampaignTemplate(Campaign):
         if pretty is not None:
             self.parameters["pretty"] = pretty
 
+        self.parameters["nb_background_builds"] = nb_background_builds
+        self.parameters["background_build_cpus"] = background_build_cpus
+        self.parameters["concurrent_partitions"] = concurrent_partitions
+        self.parameters["convergence"] = convergence
+        self.parameters["parquet_row_group_size"] = parquet_row_group_size
+
         super().__init__(
             debug=debug, gdb=gdb, enable_data_dir=enable_data_dir, continuing=continuing
         )
@@ -486,6 +516,11 @@ class CampaignIterateVariables(CampaignTemplate):
         benchmark_duration_seconds: Optional[int] = None,
         results_dir: Optional[PathType] = None,
         pretty: Pretty | None = None,
+        nb_background_builds: int = 0,
+        background_build_cpus: Optional[List[int]] = None,
+        concurrent_partitions: Optional[str | List[List[int]]] = None,
+        convergence: Optional[ConvergenceCriterion] = None,
+        parquet_row_group_size: Optional[int] = None,
     ):
         super().__init__(
             name=name,
@@ -500,6 +535,11 @@ class CampaignIterateVariables(CampaignTemplate):
             benchmark_duration_seconds=benchmark_duration_seconds,
             results_dir=results_dir,
             pretty=pretty,
+            nb_background_builds=nb_background_builds,
+            background_build_cpus=background_build_cpus,
+            concurrent_partitions=concurrent_partitions,
+            convergence=convergence,
+            parquet_row_group_size=parquet_row_group_size,
         )
 
 
@@ -524,6 +564,11 @@ class CampaignCartesianProduct(CampaignTemplate):
         benchmark_duration_seconds: Optional[int] = None,
         results_dir: Optional[PathType] = None,
         pretty: Pretty | None = None,
+        nb_background_builds: int = 0,
+        background_build_cpus: Optional[List[int]] = None,
+        concurrent_partitions: Optional[str | List[List[int]]] = None,
+        convergence: Optional[ConvergenceCriterion] = None,
+        parquet_row_group_size: Optional[int] = None,
     ):
         records_gen = cartesian_product(variables)
         super().__init__(
@@ -539,4 +584,9 @@ class CampaignCartesianProduct(CampaignTemplate):
             benchmark_duration_seconds=benchmark_duration_seconds,
             results_dir=results_dir,
             pretty=pretty,
+            nb_background_builds=nb_background_builds,
+            background_build_cpus=background_build_cpus,
+            concurrent_partitions=concurrent_partitions,
+            convergence=convergence,
+            parquet_row_group_size=parquet_row_group_size,
         )
@@ -4,10 +4,11 @@
 Functions to get dataframe from CSV file and compute useful values (like the fairness factor).
 """
 
-from typing import Any, Dict
+from typing import Any, Dict, List, Optional
 
 import pandas as pd
 
+from benchkit.utils.parquetsink import is_parquet_path, read_columns, read_metadata
 from benchkit.utils.types import PathType
 
 
@@ -29,21 +30,29 @@ def fairness_factor(row: Dict[str, Any]) -> float:
     return result
 
 
-def get_dataframe(csv_path: PathType) -> pd.DataFrame:
+def get_dataframe(csv_path: PathType, columns: Optional[List[str]] = None) -> pd.DataFrame:
     """Get dataframe from CSV file, filtering the comment and assuming the "comma" is a ";".
+    The results can also be read from a Parquet dataset (".parquet" suffix, see
+    benchkit.utils.parquetsink), of which only the given columns are then loaded.
 
     Args:
-        csv_path (PathType): path to the CSV file containing the results.
+        csv_path (PathType): path to the CSV file (or Parquet dataset) containing the results.
+        columns (Optional[List[str]], optional):
+            columns to read from a Parquet dataset, None for all of them. The CSV files are always
+            read entirely. Defaults to None.
 
     Returns:
         pd.DataFrame: dataframe holding the results.
     """
-    df = pd.read_csv(
-        f"{csv_path}",
-        sep=";",
-        comment="#",
-        engine="python",
-    )
+    if is_parquet_path(pathname=csv_path):
+        df = read_columns(pathname=csv_path, columns=columns)
+    else:
+        df = pd.read_csv(
+            f"{csv_path}",
+            sep=";",
+            comment="#",
+            engine="python",
+        )
     if "global_count" in df.columns and "duration" in df.columns:
         df["throughput"] = df["global_count"] / df["duration"]
 
@@ -55,8 +64,14 @@ def get_dataframe(csv_path: PathType) -> pd.DataFrame:
 
 def get_comments_parameters(csv_path):
     """
-    returns dictionary with the values present in the comments of the CSV file.
+    returns dictionary with the values present in the comments of the CSV file, or in the
+    metadata of the Parquet dataset.
     """
+    if is_parquet_path(pathname=csv_path):
+        benchmark_comments_parameters = read_metadata(pathname=csv_path)
+        benchmark_comments_parameters["variables"] = {}
+        return benchmark_comments_parameters
+
     with open(csv_path, "r") as csv_file:
         comments = [line for line in csv_file if line.strip().startswith("#")]
 
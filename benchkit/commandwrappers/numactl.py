@@ -18,11 +18,35 @@ class NumactlWrap(CommandWrapper):
         self,
         local_alloc: bool,
         interleave_nodes: Iterable[int] | None,
+        cpu_nodes: Iterable[int] | None = None,
+        membind_nodes: Iterable[int] | None = None,
+        physical_cpus: Iterable[int] | None = None,
     ) -> None:
+        """
+        Args:
+            local_alloc (bool):
+                whether to allocate the memory on the node where the allocating thread runs.
+            interleave_nodes (Iterable[int] | None):
+                nodes to interleave the memory allocations on, or None.
+            cpu_nodes (Iterable[int] | None, optional):
+                nodes whose CPUs the threads are confined to (--cpunodebind), or None.
+                Defaults to None.
+            membind_nodes (Iterable[int] | None, optional):
+                nodes the memory allocations are confined to (--membind), or None.
+                Defaults to None.
+            physical_cpus (Iterable[int] | None, optional):
+                CPUs the threads are confined to (--physcpubind), or None. Defaults to None.
+        """
         super().__init__()
 
+        def to_list(values: Iterable[int] | None) -> List[int] | None:
+            return list(values) if values is not None else None
+
         self._local_alloc = local_alloc
-        self._interleave_nodes = list(interleave_nodes) if interleave_nodes is not None else None
+        self._interleave_nodes = to_list(interleave_nodes)
+        self._cpu_nodes = to_list(cpu_nodes)
+        self._membind_nodes = to_list(membind_nodes)
+        self._physical_cpus = to_list(physical_cpus)
 
     def dependencies(self) -> List[PackageDependency]:
         return super().dependencies() + [
@@ -40,6 +64,12 @@ class NumactlWrap(CommandWrapper):
             options.append("--localalloc")
         if self._interleave_nodes is not None:
             options.append(f"--interleave={','.join(map(str, self._interleave_nodes))}")
+        if self._cpu_nodes is not None:
+            options.append(f"--cpunodebind={','.join(map(str, self._cpu_nodes))}")
+        if self._membind_nodes is not None:
+            options.append(f"--membind={','.join(map(str, self._membind_nodes))}")
+        if self._physical_cpus is not None:
+            options.append(f"--physcpubind={','.join(map(str, self._physical_cpus))}")
 
         numactl_prefix = ["numactl"] + options
 
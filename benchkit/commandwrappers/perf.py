@@ -2,10 +2,12 @@
 # SPDX-License-Identifier: MIT
 """
 Command wrapper for the `perf` Linux utility which allows to capture performance monitoring values
-when executing the wrapped command. Wrappers can execute "perf record" and "perf stat".
+when executing the wrapped command. Wrappers can execute "perf record", "perf stat" and
+"perf c2c".
 """
 
 import csv
+import io
 import json
 import os
 import os.path
@@ -15,7 +17,7 @@ import subprocess
 import sys
 import time
 from functools import cache
-from typing import Callable, Dict, List, Optional, Tuple
+from typing import Callable, Dict, Iterable, List, Optional, Tuple
 
 from benchkit.benchmark import RecordResult, WriteRecordFileFunction
 from benchkit.commandwrappers import CommandWrapper, PackageDependency
@@ -29,6 +31,10 @@ from benchkit.utils.types import Environment, PathType
 PerfEvent = str
 
 FILENAME_FLAMEGRAPH = "flamegraph.svg"
+FILENAME_C2C_DATA = "perf-c2c.data"
+FILENAME_C2C_REPORT = "perf-c2c.report"
+FILENAME_C2C_CACHELINES = "c2c_cachelines.csv"
+FILENAME_C2C_SYMBOLS = "c2c_symbols.csv"
 
 
 def _perf_command_prefix(
@@ -232,6 +238,15 @@ def _validate_events(
     return available_events
 
 
+def _chown(platform: Platform, pathname: PathType) -> None:
+    # perf run with sudo leaves files owned by root, that perf then refuses to read as the user
+    path = pathlib.Path(pathname)
+    current_owner = path.owner()  # TODO only works on local platforms
+    user = platform.current_user()
+    if current_owner != user:
+        shell_out(["sudo", "chown", f"{user}:{user}", str(path)], print_output=False)
+
+
 def enable_non_sudo_perf(comm_layer: CommunicationLayer) -> None:
     """Allows non-root / non-sudoer to run perf.
 
@@ -809,11 +824,7 @@ class PerfReportWrap(CommandWrapper):
         )
 
     def _chown(self, pathname: PathType) -> None:
-        path = pathlib.Path(pathname)
-        current_owner = path.owner()  # TODO only works on local platforms
-        user = self.platform.current_user()
-        if current_owner != user:
-            shell_out(["sudo", "chown", f"{user}:{user}", str(path)], print_output=False)
+        _chown(platform=self.platform, pathname=pathname)
 
     def _perf_report_command(self, perf_data_pathname: PathType) -> SplitCommand:
         command = [
@@ -852,3 +863,349 @@ class PerfReportWrap(CommandWrapper):
             chosen_path = os.path.join(search_dir, chosen_file)
             command = command_fun(chosen_path)
             shell_interactive(command=command, ignore_ret_codes=(-13,))  # ignore broken pipe error
+
+
+class PerfC2CWrap(CommandWrapper):
+    """
+    Command wrapper for the `perf c2c` utility, which samples the memory accesses of the wrapped
+    command to find the contended cache lines (false sharing, lock words bouncing between cores).
+
+    The post run hook reports the HITMs (loads hitting a cache line modified in another core,
+    in the same node or in a remote one) of the whole run as summary columns, and stores in the
+    record data directory the raw report, the HITMs of each contended cache line and the code
+    (symbol, object, source line) accessing each of them.
+    """
+
+    # summary columns and the statistics of the report ("Trace Event Information" and "Global
+    # Shared Cache Line Event Information" sections) they come from
+    _summary_stats = {
+        "c2c_records": "Total records",
+        "c2c_loads": "Load Operations",
+        "c2c_stores": "Store Operations",
+        "c2c_local_hitm": "Load Local HITM",
+        "c2c_remote_hitm": "Load Remote HITM",
+        "c2c_shared_cachelines": "Total Shared Cache Lines",
+    }
+
+    # columns of the "Shared Data Cache Line Table" section, from their header in the report
+    _cacheline_columns = {
+        "index": "Index",
+        "address": "Address",
+        "node": "Node",
+        "hitm_share": "Hitm",
+        "total_hitm": "Total",
+        "local_hitm": "LclHitm",
+        "remote_hitm": "RmtHitm",
+        "records": "records",
+        "loads": "Loads",
+        "stores": "Stores",
+    }
+
+    _symbol_columns = [
+        "cacheline",
+        "cacheline_address",
+        "offset",
+        "code_address",
+        "local_hitm_share",
+        "remote_hitm_share",
+        "symbol",
+        "object",
+        "source",
+    ]
+
+    def __init__(
+        self,
+        perf_path: Optional[PathType] = None,
+        ldlat: Optional[int] = None,
+        all_user: bool = False,
+        all_kernel: bool = False,
+        source_lines: bool = True,
+        perf_record_options: Optional[List[str]] = None,
+        perf_report_options: Optional[List[str]] = None,
+        platform: Platform | None = None,
+    ):
+        """
+        Create the perf c2c wrapper.
+
+        Args:
+            perf_path (Optional[PathType], optional):
+                directory of the perf binary, searched in the PATH if None. Defaults to None.
+            ldlat (Optional[int], optional):
+                minimal latency, in cycles, of the sampled loads (perf default if None).
+                Defaults to None.
+            all_user (bool, optional): whether to sample the user space accesses only.
+                Defaults to False.
+            all_kernel (bool, optional): whether to sample the kernel accesses only.
+                Defaults to False.
+            source_lines (bool, optional):
+                whether to resolve the source lines of the accessing code, which can make the
+                report take long on large binaries. Defaults to True.
+            perf_record_options (Optional[List[str]], optional):
+                additional options of perf c2c record. Defaults to None.
+            perf_report_options (Optional[List[str]], optional):
+                additional options of perf c2c report, e.g. ["--display", "rmt"] to sort the
+                cache lines on the remote HITMs. Defaults to None.
+            platform (Platform | None, optional):
+                platform where the command runs, the current one if None. Defaults to None.
+        """
+        super().__init__()
+        self.platform = get_current_platform() if platform is None else platform
+
+        self._perf_bin = _find_perf_bin(search_path=perf_path)
+
+        self._ldlat = ldlat
+        self._all_user = all_user
+        self._all_kernel = all_kernel
+        self._source_lines = source_lines
+        self._extra_record_options = [] if perf_record_options is None else perf_record_options
+        self._extra_report_options = [] if perf_report_options is None else perf_report_options
+
+    @property
+    def perf_record_options(self) -> List[str]:
+        """Get all options formatted for the command line format of perf c2c record.
+
+        Returns:
+            List[str]: partial split commands with the options formatted as expected by
+                       perf-c2c-record command line.
+        """
+        pro = []
+        if self._ldlat is not None:
+            pro.extend(["--ldlat", f"{self._ldlat}"])
+        if self._all_user:
+            pro.append("--all-user")
+        if self._all_kernel:
+            pro.append("--all-kernel")
+        return pro + self._extra_record_options
+
+    @property
+    def perf_report_options(self) -> List[str]:
+        """Get all options formatted for the command line format of perf c2c report.
+
+        Returns:
+            List[str]: partial split commands with the options formatted as expected by
+                       perf-c2c-report command line.
+        """
+        pro = ["--stdio"]
+        if not self._source_lines:
+            pro.append("--no-source")
+        return pro + self._extra_report_options
+
+    def dependencies(self) -> List[PackageDependency]:
+        kernel_version = self.platform.kernel_version()
+        return super().dependencies() + [
+            PackageDependency("linux-tools-common"),
+            PackageDependency("linux-tools-generic"),
+            PackageDependency(f"linux-tools-{kernel_version}"),
+        ]
+
+    def command_prefix(  # pylint: disable=arguments-differ
+        self,
+        record_data_dir: Optional[PathType],
+        platform: Platform,
+        **kwargs,
+    ) -> List[str]:
+        cmd_prefix = super().command_prefix(**kwargs)
+
+        _validate_record_data_dir(record_data_dir=record_data_dir)
+        perf_data_pathname = os.path.join(record_data_dir, FILENAME_C2C_DATA)
+
+        perf_prefix = _perf_command_prefix(perf_bin=self._perf_bin, platform=platform)
+        cmd_prefix = (
+            perf_prefix
+            + ["c2c", "record", "--output", f"{perf_data_pathname}"]
+            + self.perf_record_options
+            + ["--"]
+            + cmd_prefix
+        )
+
+        return cmd_prefix
+
+    def post_run_hook_update_results(
+        self,
+        experiment_results_lines: List[RecordResult],
+        record_data_dir: PathType,
+        write_record_file_fun: WriteRecordFileFunction,
+    ) -> RecordResult:
+        """Post run hook to extend the record results with the HITMs of the run, and to store the
+        contended cache lines and the code accessing them into the data directory of the record.
+
+        Args:
+            experiment_results_lines (List[RecordResult]): the record results.
+            record_data_dir (PathType): path to the record data directory.
+            write_record_file_fun (WriteRecordFileFunction): callback to record a file into data
+                                                             directory.
+
+        Returns:
+            RecordResult: the summary columns (c2c_local_hitm, c2c_remote_hitm, ...).
+        """
+        assert experiment_results_lines  # to remove the "unused" warning
+
+        perf_data_pathname = os.path.join(record_data_dir, FILENAME_C2C_DATA)
+        _chown(platform=self.platform, pathname=perf_data_pathname)
+
+        report = shell_out(
+            command=[self._perf_bin, "c2c", "report", "--input", f"{perf_data_pathname}"]
+            + self.perf_report_options,
+            print_output=False,
+        )
+        write_record_file_fun(file_content=report.strip() + "\n", filename=FILENAME_C2C_REPORT)
+
+        cachelines = self.parse_cachelines(report=report)
+        write_record_file_fun(
+            file_content=self._to_csv(rows=cachelines, field_names=self._cacheline_columns),
+            filename=FILENAME_C2C_CACHELINES,
+        )
+        symbols = self.parse_symbols(report=report)
+        write_record_file_fun(
+            file_content=self._to_csv(rows=symbols, field_names=self._symbol_columns),
+            filename=FILENAME_C2C_SYMBOLS,
+        )
+
+        return self.parse_summary(report=report)
+
+    @classmethod
+    def parse_summary(cls, report: str) -> RecordResult:
+        """Parse the summary columns from the statistics of a perf c2c report.
+
+        Args:
+            report (str): the output of perf c2c report --stdio.
+
+        Returns:
+            RecordResult: the summary columns, the ones missing from the report being left out.
+        """
+        stats = {}
+        for line in report.splitlines():
+            if line.strip().startswith("#"):
+                break  # the statistics are followed by the tables, whose header starts with '#'
+            m = re.match(pattern=r"^\s*(?P<name>[^:]*\S)\s*:\s*(?P<value>\d+)\s*$", string=line)
+            if m is not None:
+                stats[m.group("name")] = int(m.group("value"))
+
+        result = {
+            column: stats[stat_name]
+            for column, stat_name in cls._summary_stats.items()
+            if stat_name in stats
+        }
+        if "c2c_local_hitm" in result and "c2c_remote_hitm" in result:
+            result["c2c_total_hitm"] = result["c2c_local_hitm"] + result["c2c_remote_hitm"]
+        return result
+
+    @classmethod
+    def parse_cachelines(cls, report: str) -> List[Dict[str, str]]:
+        """Parse the HITMs of each contended cache line from a perf c2c report.
+
+        Args:
+            report (str): the output of perf c2c report --stdio.
+
+        Returns:
+            List[Dict[str, str]]: one row per cache line, in the order of the report.
+        """
+        result = []
+        header = None
+        for line in cls._section_lines(report=report, title="Shared Data Cache Line Table"):
+            if line.startswith("#"):
+                header = header or cls._column_names(header_line=line, first_column="Index")
+                continue
+            values = line.split()
+            if header is None or len(values) != len(header):
+                continue
+            result.append(
+                {
+                    column: values[header.index(name)]
+                    for column, name in cls._cacheline_columns.items()
+                    if name in header
+                }
+            )
+        return result
+
+    @classmethod
+    def parse_symbols(cls, report: str) -> List[Dict[str, str]]:
+        """Parse the code accessing each contended cache line from a perf c2c report.
+
+        Args:
+            report (str): the output of perf c2c report --stdio.
+
+        Returns:
+            List[Dict[str, str]]: one row per accessing code address and cache line.
+        """
+        result = []
+        header = None
+        cacheline = None
+        pareto_title = "Shared Cache Line Distribution Pareto"
+        for line in cls._section_lines(report=report, title=pareto_title):
+            if line.startswith("#"):
+                header = header or cls._column_names(header_line=line, first_column="Num")
+                continue
+            if line.startswith("-"):
+                continue
+            values = line.split()
+            symbol_marks = [k for k, v in enumerate(values) if re.fullmatch(r"\[.\]", v)]
+            if not symbol_marks:
+                # cache line row, e.g. "0  4807  1643  5450  0  0x602180"
+                if values and values[0].isdigit():
+                    cacheline = (values[0], values[-1])
+                continue
+            if header is None or cacheline is None:
+                continue
+
+            # the columns before the symbol are numbers, the ones after are separated by spaces
+            mark = symbol_marks[0]
+            shares = [v for v in values[:mark] if v.endswith("%")]
+            addresses = [v for v in values[:mark] if v.startswith("0x")]
+            hitm_names = [n for n in header if n in ("LclHitm", "RmtHitm")]
+            hitm_shares = dict(zip(hitm_names, shares))
+            rest = line.split(values[mark], 1)[1].strip()
+            names = re.split(r"\s{2,}", rest)
+            result.append(
+                {
+                    "cacheline": cacheline[0],
+                    "cacheline_address": cacheline[1],
+                    "offset": addresses[0] if addresses else "",
+                    "code_address": addresses[1] if len(addresses) > 1 else "",
+                    "local_hitm_share": hitm_shares.get("LclHitm", ""),
+                    "remote_hitm_share": hitm_shares.get("RmtHitm", ""),
+                    "symbol": names[0],
+                    "object": names[1] if len(names) > 1 else "",
+                    "source": names[2] if len(names) > 2 and ":" in names[2] else "",
+                }
+            )
+        return result
+
+    @staticmethod
+    def _section_lines(report: str, title: str) -> List[str]:
+        # lines of the section (stripped, non-empty) between its title and the next title
+        lines = [line.strip() for line in report.splitlines()]
+        result = []
+        in_section = False
+        for k, line in enumerate(lines):
+            if line.startswith("====="):
+                continue
+            is_title = (
+                0 < k < len(lines) - 1
+                and lines[k - 1].startswith("=====")
+                and lines[k + 1].startswith("=====")
+            )
+            if is_title:
+                in_section = line == title
+            elif in_section and line and line != "#":
+                result.append(line)
+        return result
+
+    @staticmethod
+    def _column_names(header_line: str, first_column: str) -> Optional[List[str]]:
+        # the header line naming the columns, e.g. "# Index  Address  Node  PA cnt  Hitm ..."
+        names = header_line.lstrip("#").split()
+        if not names or names[0] != first_column:
+            return None
+        joined = " ".join(names)
+        for two_words in ["PA cnt", "L1 Hit", "L1 Miss", "Code address", "rmt hitm", "lcl hitm"]:
+            joined = joined.replace(two_words, two_words.replace(" ", "_"))
+        return joined.split()
+
+    @staticmethod
+    def _to_csv(rows: List[Dict[str, str]], field_names: Iterable[str]) -> str:
+        output = io.StringIO()
+        writer = csv.DictWriter(output, fieldnames=list(field_names), lineterminator="\n")
+        writer.writeheader()
+        writer.writerows(rows)
+        return output.getvalue()
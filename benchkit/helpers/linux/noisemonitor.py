@@ -0,0 +1,404 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Monitor of the system noise on the CPUs a benchmark runs on: interrupts, softirqs, context
+switches, frequency and thermal throttling, sampled before, during and after each run.
+
+Even on a machine made predictable (see benchkit.helpers.linux.predictable), some runs are
+outliers; the noise columns added to the results allow to filter them or to correlate them with
+the noise the run endured.
+"""
+
+import csv
+import io
+import os
+import re
+import subprocess
+import threading
+import time
+from typing import Dict, Iterable, List, Optional, Set
+
+from benchkit.benchmark import RecordResult, WriteRecordFileFunction
+from benchkit.platforms import Platform, get_current_platform
+from benchkit.shell.shellasync import AsyncProcess
+from benchkit.utils.types import PathType
+
+FILENAME_NOISE_SAMPLES = "noise_samples.csv"
+
+# cumulative per-CPU counters of a sample, and the frequency (not cumulative)
+_COUNTERS = ["interrupts", "softirqs", "context_switches", "throttle_count"]
+_SAMPLE_COLUMNS = ["time_ns", "cpu"] + _COUNTERS + ["freq_khz"]
+
+_SYS_CPU_PATH = "/sys/devices/system/cpu"
+_THROTTLE_FILES = ["core_throttle_count", "package_throttle_count"]
+
+CpuSample = Dict[str, Optional[int]]
+
+
+class _RunSamples:
+    """Samples of a run, shared by its hooks and the sampling thread of its attachment."""
+
+    def __init__(self) -> None:
+        self.samples: List[Dict[int, CpuSample]] = []
+        self.pinned_cpus: Set[int] = set()
+        self.stop = threading.Event()
+        self.sampler: Optional[threading.Thread] = None
+
+
+class NoiseMonitor:
+    """
+    Sampler of the noise counters of the CPUs a benchmark runs on, to register as a pre-run hook
+    (sample before the run), a command attachment (samples at an interval during the run, for
+    the benchmarks whose command is asynchronous) and a post-run hook (sample after the run):
+
+        noise = NoiseMonitor(interval_ms=100)
+        benchmark = Bench(
+            command_attachments=[noise.attachment],
+            pre_run_hooks=[noise.pre_run_hook],
+            post_run_hooks=[noise.post_run_hook_update_results],
+        )
+
+    The time series of the counters of each monitored CPU is stored in the record data directory
+    (noise_samples.csv), and the post-run hook adds the noise endured by the run on these CPUs
+    to its results: noise_interrupts, noise_softirqs, noise_context_switches and
+    noise_throttle_events (increments over the run), noise_min_freq_mhz and noise_mean_freq_mhz.
+    The counters the platform does not expose (e.g. the per-CPU context switches require
+    /proc/schedstat, the throttle counters an Intel CPU) are left out.
+
+    On a local platform, the sampling thread runs on the CPUs that are not monitored (the CPUs
+    given, or the ones the benchmark threads are observed pinned to), so that it does not add
+    to the noise it measures; it stays on all the CPUs when every CPU is monitored.
+    """
+
+    def __init__(
+        self,
+        cpus: Optional[Iterable[int]] = None,
+        interval_ms: int = 100,
+        platform: Optional[Platform] = None,
+    ) -> None:
+        """
+        Create the noise monitor.
+
+        Args:
+            cpus (Optional[Iterable[int]], optional):
+                CPUs to monitor, the only ones whose counters are read. None monitors the CPUs the
+                threads of the benchmark process and of its child processes (e.g. the benchmark
+                run by a wrapper such as perf) are pinned to, as observed by the attachment during
+                the run (all the CPUs when the command is synchronous, or when no thread is
+                pinned). Defaults to None.
+            interval_ms (int, optional):
+                period of the samples taken by the attachment during the run. Defaults to 100.
+            platform (Optional[Platform], optional):
+                platform of the benchmark (only local platforms are sampled during the run, as
+                the attachment reads the affinity of the process threads). None takes the current
+                platform. Defaults to None.
+        """
+        self._cpus = sorted(set(cpus)) if cpus is not None else None
+        self._interval_ms = interval_ms
+        self._platform = get_current_platform() if platform is None else platform
+        # records can run concurrently (one per thread) on the partitions of the platform
+        self._thread_state = threading.local()
+
+    def pre_run_hook(
+        self,
+        build_variables: RecordResult,
+        run_variables: RecordResult,
+        record_data_dir: PathType,
+    ) -> None:
+        """
+        Pre-run hook taking the sample before the run.
+
+        Args:
+            build_variables (RecordResult): the build variables of the run.
+            run_variables (RecordResult): the run variables of the run.
+            record_data_dir (PathType): path to the record data directory.
+        """
+        assert build_variables is not None  # to remove the "unused" warning
+        assert run_variables is not None
+
+        run = _RunSamples()
+        run.samples.append(self.sample())
+        self._thread_state.run = run
+
+    def attachment(
+        self,
+        process: AsyncProcess,
+        record_data_dir: PathType,
+    ) -> None:
+        """
+        Command attachment sampling the counters at the given interval while the process runs,
+        in a background thread stopped by the post-run hook.
+
+        Args:
+            process (AsyncProcess): the process of the benchmark.
+            record_data_dir (PathType): path to the record data directory.
+        """
+        run = getattr(self._thread_state, "run", None)
+        if run is None:  # without the pre-run hook
+            run = self._thread_state.run = _RunSamples()
+
+        def sample_during_run() -> None:
+            is_local = self._platform.comm.is_local
+            if is_local and self._cpus is not None:
+                self._move_sampler(monitored_cpus=self._cpus)
+            while not run.stop.wait(timeout=self._interval_ms / 1000):
+                if process.is_finished():
+                    return
+                sample = self.sample()
+                if is_local and self._cpus is None:
+                    pinned_cpus = self._pinned_cpus(pid=process.pid, all_cpus=set(sample))
+                    if not pinned_cpus <= run.pinned_cpus:
+                        run.pinned_cpus |= pinned_cpus
+                        self._move_sampler(monitored_cpus=run.pinned_cpus)
+                run.samples.append(sample)
+
+        run.sampler = threading.Thread(target=sample_during_run, daemon=True)
+        run.sampler.start()
+
+    def post_run_hook_update_results(
+        self,
+        experiment_results_lines: List[RecordResult],
+        record_data_dir: PathType,
+        write_record_file_fun: WriteRecordFileFunction,
+    ) -> RecordResult:
+        """
+        Post-run hook taking the sample after the run, storing the time series into the record
+        data directory and extending the results with the noise endured by the run.
+
+        Args:
+            experiment_results_lines (List[RecordResult]): the record results.
+            record_data_dir (PathType): path to the record data directory.
+            write_record_file_fun (WriteRecordFileFunction): callback to record a file into data
+                                                             directory.
+
+        Returns:
+            RecordResult: the noise summary columns (noise_interrupts, noise_softirqs, ...).
+        """
+        assert experiment_results_lines  # to remove the "unused" warning
+
+        run = getattr(self._thread_state, "run", None) or _RunSamples()
+        self._thread_state.run = None
+        if run.sampler is not None:
+            run.stop.set()
+            run.sampler.join()
+        samples = run.samples + [self.sample()]
+        cpus = self._monitored_cpus(samples=samples, pinned_cpus=run.pinned_cpus)
+
+        write_record_file_fun(
+            file_content=self._to_csv(samples=samples, cpus=cpus),
+            filename=FILENAME_NOISE_SAMPLES,
+        )
+        return self.summary(samples=samples, cpus=cpus)
+
+    def sample(self) -> Dict[int, CpuSample]:
+        """
+        Read the noise counters of the monitored CPUs (all the CPUs when they are not given).
+
+        Returns:
+            Dict[int, CpuSample]: the counters (None when the platform does not expose them) and
+                                  the time of the sample (time_ns), by CPU.
+        """
+        time_ns = time.monotonic_ns()
+        interrupts = self.parse_per_cpu_table(text=self._read(path="/proc/interrupts"))
+        softirqs = self.parse_per_cpu_table(text=self._read(path="/proc/softirqs"))
+        context_switches = self.parse_schedstat(text=self._read(path="/proc/schedstat"))
+
+        result = {}
+        cpus = set(interrupts) | set(softirqs) | set(context_switches)
+        if self._cpus is not None:
+            cpus &= set(self._cpus)
+        for cpu in sorted(cpus):
+            cpu_path = f"{_SYS_CPU_PATH}/cpu{cpu}"
+            throttle_counts = [
+                self._read_int(path=f"{cpu_path}/thermal_throttle/{filename}")
+                for filename in _THROTTLE_FILES
+            ]
+            throttle_counts = [c for c in throttle_counts if c is not None]
+            result[cpu] = {
+                "time_ns": time_ns,
+                "interrupts": interrupts.get(cpu),
+                "softirqs": softirqs.get(cpu),
+                "context_switches": context_switches.get(cpu),
+                "throttle_count": sum(throttle_counts) if throttle_counts else None,
+                "freq_khz": self._read_int(path=f"{cpu_path}/cpufreq/scaling_cur_freq"),
+            }
+        return result
+
+    @staticmethod
+    def summary(samples: List[Dict[int, CpuSample]], cpus: List[int]) -> RecordResult:
+        """
+        Compute the noise endured by the given CPUs between the first and the last sample.
+
+        Args:
+            samples (List[Dict[int, CpuSample]]): the samples, in time order.
+            cpus (List[int]): the monitored CPUs.
+
+        Returns:
+            RecordResult: the increments of the counters over the run, summed on the CPUs, and
+                          the minimum and mean frequencies observed on the CPUs, in MHz.
+        """
+        result = {}
+        if len(samples) < 2:
+            return result
+        first, last = samples[0], samples[-1]
+        column_names = {"throttle_count": "noise_throttle_events"}
+        for counter in _COUNTERS:
+            increments = [
+                last[cpu][counter] - first[cpu][counter]
+                for cpu in cpus
+                if cpu in first
+                and cpu in last
+                and first[cpu][counter] is not None
+                and last[cpu][counter] is not None
+            ]
+            if increments:
+                result[column_names.get(counter, f"noise_{counter}")] = sum(increments)
+
+        frequencies = [
+            sample[cpu]["freq_khz"]
+            for sample in samples
+            for cpu in cpus
+            if cpu in sample and sample[cpu]["freq_khz"] is not None
+        ]
+        if frequencies:
+            result["noise_min_freq_mhz"] = min(frequencies) / 1000
+            result["noise_mean_freq_mhz"] = sum(frequencies) / len(frequencies) / 1000
+        return result
+
+    @staticmethod
+    def parse_per_cpu_table(text: str) -> Dict[int, int]:
+        """
+        Parse a table of per-CPU counters such as /proc/interrupts and /proc/softirqs, whose
+        header gives the CPUs (CPU0, CPU1, ...) and each line the counts of a source on them.
+
+        Args:
+            text (str): the content of the file.
+
+        Returns:
+            Dict[int, int]: the sum of the counts of all the sources, by CPU.
+        """
+        lines = text.splitlines()
+        if not lines:
+            return {}
+        cpus = [int(m.group(1)) for m in re.finditer(r"CPU(\d+)", lines[0])]
+        result = {cpu: 0 for cpu in cpus}
+        for line in lines[1:]:
+            _, _, values = line.partition(":")
+            counts = []
+            for token in values.split()[: len(cpus)]:
+                if not token.isdigit():
+                    break
+                counts.append(int(token))
+            if len(counts) != len(cpus):
+                continue  # counter of the whole system, e.g. ERR and MIS of /proc/interrupts
+            for cpu, count in zip(cpus, counts):
+                result[cpu] += count
+        return result
+
+    @staticmethod
+    def parse_schedstat(text: str) -> Dict[int, int]:
+        """
+        Parse the number of context switches of each CPU (tasks switched in, the number of
+        timeslices run) from /proc/schedstat.
+
+        Args:
+            text (str): the content of the file.
+
+        Returns:
+            Dict[int, int]: the context switches, by CPU.
+        """
+        result = {}
+        for line in text.splitlines():
+            fields = line.split()
+            # cpu<N> yld_count 0 sched_count sched_goidle ttwu_count ttwu_local rq_cpu_time
+            #        run_delay pcount
+            if len(fields) >= 10 and re.fullmatch(r"cpu\d+", fields[0]):
+                result[int(fields[0][3:])] = int(fields[9])
+        return result
+
+    def _monitored_cpus(
+        self,
+        samples: List[Dict[int, CpuSample]],
+        pinned_cpus: Iterable[int],
+    ) -> List[int]:
+        sampled_cpus = set().union(*(sample.keys() for sample in samples))
+        if self._cpus is not None:
+            return [cpu for cpu in self._cpus if cpu in sampled_cpus]
+        pinned = set(pinned_cpus) & sampled_cpus
+        return sorted(pinned if pinned else sampled_cpus)
+
+    @staticmethod
+    def _move_sampler(monitored_cpus: Iterable[int]) -> None:
+        # pins the calling (sampling) thread to the CPUs it may run on, but the monitored ones
+        try:
+            other_cpus = os.sched_getaffinity(0) - set(monitored_cpus)
+            if other_cpus:
+                os.sched_setaffinity(0, other_cpus)
+        except OSError:
+            pass  # e.g. the affinity is restricted by a cgroup: the sampler stays where it is
+
+    @staticmethod
+    def _pinned_cpus(pid: int, all_cpus: set) -> set:
+        # union of the affinities of the threads pinned (by the benchmark itself or by a wrapper)
+        # to a subset of the CPUs, e.g. not the main thread of a benchmark pinning its workers;
+        # the threads of the child processes count as well, as wrappers such as perf run the
+        # benchmark in a child process
+        result = set()
+        for process_pid in NoiseMonitor._process_tree(pid=pid):
+            try:
+                tids = os.listdir(f"/proc/{process_pid}/task")
+            except OSError:
+                continue  # the process exited
+            for tid in tids:
+                try:
+                    affinity = os.sched_getaffinity(int(tid))
+                except OSError:
+                    continue  # the thread exited
+                if affinity < all_cpus:
+                    result |= affinity
+        return result
+
+    @staticmethod
+    def _process_tree(pid: int) -> List[int]:
+        # the process and its descendants, from the parent of each process (the children files
+        # of /proc/<pid>/task/<tid> need a kernel built with CONFIG_PROC_CHILDREN)
+        children: Dict[int, List[int]] = {}
+        for entry in os.listdir("/proc"):
+            if not entry.isdigit():
+                continue
+            try:
+                with open(f"/proc/{entry}/stat", "r") as stat_file:
+                    stat = stat_file.read()
+            except OSError:
+                continue  # the process exited
+            # pid (comm) state ppid ..., the command name possibly holding spaces or parentheses
+            ppid = int(stat.rpartition(")")[2].split()[1])
+            children.setdefault(ppid, []).append(int(entry))
+
+        result = []
+        pending = [pid]
+        while pending:
+            process_pid = pending.pop()
+            if process_pid not in result:
+                result.append(process_pid)
+                pending.extend(children.get(process_pid, []))
+        return result
+
+    def _read(self, path: str) -> str:
+        try:
+            return self._platform.comm.read_file(path=path)
+        except (OSError, subprocess.CalledProcessError):
+            return ""  # not exposed by the platform
+
+    def _read_int(self, path: str) -> Optional[int]:
+        content = self._read(path=path).strip()
+        return int(content) if content.isdigit() else None
+
+    @staticmethod
+    def _to_csv(samples: List[Dict[int, CpuSample]], cpus: List[int]) -> str:
+        output = io.StringIO()
+        writer = csv.DictWriter(output, fieldnames=_SAMPLE_COLUMNS, lineterminator="\n")
+        writer.writeheader()
+        for sample in samples:
+            writer.writerows({"cpu": cpu} | sample[cpu] for cpu in cpus if cpu in sample)
+        return output.getvalue()
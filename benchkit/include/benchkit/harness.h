@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Header-only measurement harness for native (C and C++) benchmarks driven by benchkit.
+ *
+ * It provides a low-overhead tick counter calibrated against the monotonic clock, a start barrier,
+ * per-thread stats slots each on their own cache line, log-linear histograms and an emitter of
+ * result lines that the default Benchmark.parse_output_to_results of benchkit parses:
+ *
+ *     [benchkit] <key>=<value>
+ *
+ * one result per line, the last value of a key winning. The directory holding this header is
+ * returned by benchkit.utils.dir.benchkit_include_dir().
+ */
+
+#ifndef BENCHKIT_HARNESS_H
+#define BENCHKIT_HARNESS_H
+
+#include <inttypes.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef BK_CACHE_LINE_SIZE
+#define BK_CACHE_LINE_SIZE 64
+#endif
+
+#define BK_CACHE_ALIGNED __attribute__((aligned(BK_CACHE_LINE_SIZE)))
+
+#define BK_RESULT_PREFIX "[benchkit] "
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------------------------------------------------------------------------
+ * Timer
+ */
+
+static inline uint64_t bk_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+/*
+ * Tick counter: the time-stamp counter on x86_64, the virtual counter of the generic timer on
+ * Armv8, and the monotonic clock in nanoseconds elsewhere. The reads are ordered after the
+ * preceding instructions, so that a tick interval covers the measured code.
+ */
+static inline uint64_t bk_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ __volatile__("lfence\n\trdtsc" : "=a"(lo), "=d"(hi) : : "memory");
+    return ((uint64_t) hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t value;
+    __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0" : "=r"(value) : : "memory");
+    return value;
+#else
+    return bk_now_ns();
+#endif
+}
+
+/* Nanoseconds per tick, measured against the monotonic clock over about 10 ms of spinning. */
+static inline double bk_ticks_calibrate(void) {
+    const uint64_t ns_start = bk_now_ns();
+    const uint64_t ticks_start = bk_ticks();
+    while (bk_now_ns() - ns_start < 10000000ull) {
+    }
+    const uint64_t ns_end = bk_now_ns();
+    const uint64_t ticks_end = bk_ticks();
+
+    if (ticks_end == ticks_start) {
+        return 1.0;
+    }
+    return (double) (ns_end - ns_start) / (double) (ticks_end - ticks_start);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Start barrier
+ *
+ * Sense-reversing barrier releasing all the threads at once, so that none of them starts measuring
+ * while the others are still being created. Waiting threads spin for a while, then yield the CPU
+ * to accommodate oversubscription.
+ */
+
+typedef struct {
+    uint32_t nb_threads;
+    uint32_t arrived;
+    uint32_t generation;
+} BK_CACHE_ALIGNED bk_barrier_t;
+
+static inline void bk_barrier_init(bk_barrier_t *barrier, uint32_t nb_threads) {
+    barrier->nb_threads = nb_threads;
+    barrier->arrived = 0u;
+    barrier->generation = 0u;
+}
+
+static inline void bk_barrier_wait(bk_barrier_t *barrier) {
+    const uint32_t generation = __atomic_load_n(&barrier->generation, __ATOMIC_ACQUIRE);
+    if (__atomic_add_fetch(&barrier->arrived, 1u, __ATOMIC_ACQ_REL) == barrier->nb_threads) {
+        __atomic_store_n(&barrier->arrived, 0u, __ATOMIC_RELAXED);
+        __atomic_store_n(&barrier->generation, generation + 1u, __ATOMIC_RELEASE);
+        return;
+    }
+    unsigned spins = 0u;
+    while (__atomic_load_n(&barrier->generation, __ATOMIC_ACQUIRE) == generation) {
+        if (++spins > 1024u) {
+            sched_yield();
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Per-thread stats slots
+ *
+ * Each thread updates its own slot with plain stores, and other threads may sample the count while
+ * it runs (e.g. for throughput over time); slots never share a cache line.
+ */
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+} BK_CACHE_ALIGNED bk_slot_t;
+
+static inline void bk_slot_init(bk_slot_t *slot) {
+    slot->count = 0u;
+    slot->sum = 0u;
+    slot->min = UINT64_MAX;
+    slot->max = 0u;
+}
+
+/* Counts one operation and accumulates its value (e.g. its duration). */
+static inline void bk_slot_record(bk_slot_t *slot, uint64_t value) {
+    __atomic_store_n(&slot->count, slot->count + 1u, __ATOMIC_RELAXED);
+    slot->sum += value;
+    slot->min = value < slot->min ? value : slot->min;
+    slot->max = value > slot->max ? value : slot->max;
+}
+
+/* Count of a slot updated by another thread. */
+static inline uint64_t bk_slot_count(const bk_slot_t *slot) {
+    return __atomic_load_n(&slot->count, __ATOMIC_RELAXED);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Histograms
+ *
+ * Log-linear histogram: values are grouped by power of two, and each power of two is split in
+ * 2^BK_HIST_SUB_BITS linear sub-buckets, bounding the relative error to 1/2^BK_HIST_SUB_BITS.
+ * Values below 2^BK_HIST_SUB_BITS are recorded exactly. Recording is a few instructions and never
+ * allocates.
+ */
+
+#define BK_HIST_SUB_BITS 4u
+#define BK_HIST_SUB_BUCKETS (1u << BK_HIST_SUB_BITS)
+#define BK_HIST_NB_GROUPS (64u - BK_HIST_SUB_BITS + 1u)
+#define BK_HIST_NB_BUCKETS (BK_HIST_NB_GROUPS * BK_HIST_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t buckets[BK_HIST_NB_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+} BK_CACHE_ALIGNED bk_hist_t;
+
+static inline unsigned bk_hist_index(uint64_t value) {
+    if (value < BK_HIST_SUB_BUCKETS) {
+        return (unsigned) value;
+    }
+    const unsigned msb = 63u - (unsigned) __builtin_clzll(value);
+    const unsigned group = msb - BK_HIST_SUB_BITS + 1u;
+    const unsigned shift = msb - BK_HIST_SUB_BITS;
+    const unsigned sub = (unsigned) (value >> shift) & (BK_HIST_SUB_BUCKETS - 1u);
+    return group * BK_HIST_SUB_BUCKETS + sub;
+}
+
+/* Lowest value that falls in the given bucket. */
+static inline uint64_t bk_hist_bucket_value(unsigned index) {
+    const unsigned group = index / BK_HIST_SUB_BUCKETS;
+    const uint64_t sub = index % BK_HIST_SUB_BUCKETS;
+    if (group == 0u) {
+        return sub;
+    }
+    const unsigned msb = group + BK_HIST_SUB_BITS - 1u;
+    return (1ull << msb) | (sub << (msb - BK_HIST_SUB_BITS));
+}
+
+static inline void bk_hist_init(bk_hist_t *hist) {
+    memset(hist, 0, sizeof(*hist));
+}
+
+static inline void bk_hist_record(bk_hist_t *hist, uint64_t value) {
+    hist->buckets[bk_hist_index(value)]++;
+    hist->count++;
+    hist->sum += value;
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+static inline void bk_hist_merge(bk_hist_t *dst, const bk_hist_t *src) {
+    for (unsigned i = 0u; i < BK_HIST_NB_BUCKETS; ++i) {
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
+
+/* Value at the given percentile (0 < percentile <= 100), lower bound of the matching bucket. */
+static inline uint64_t bk_hist_percentile(const bk_hist_t *hist, double percentile) {
+    if (hist->count == 0u) {
+        return 0u;
+    }
+    uint64_t rank = (uint64_t) ((percentile / 100.0) * (double) hist->count + 0.5);
+    if (rank == 0u) {
+        rank = 1u;
+    }
+    uint64_t seen = 0u;
+    for (unsigned i = 0u; i < BK_HIST_NB_BUCKETS; ++i) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            const uint64_t value = bk_hist_bucket_value(i);
+            return value < hist->max ? value : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Result emitter
+ *
+ * Keys are made of letters, digits and underscores. The parser treats all the keys alike; the
+ * keys of the form thread_<k> (see bk_emit_thread_u64) are the per-thread results, which the CSV
+ * output of benchkit places last, each thread in its thread_<k> column.
+ */
+
+static inline void bk_emit_u64(const char *key, uint64_t value) {
+    printf(BK_RESULT_PREFIX "%s=%" PRIu64 "\n", key, value);
+}
+
+static inline void bk_emit_i64(const char *key, int64_t value) {
+    printf(BK_RESULT_PREFIX "%s=%" PRId64 "\n", key, value);
+}
+
+static inline void bk_emit_double(const char *key, double value) {
+    printf(BK_RESULT_PREFIX "%s=%.17g\n", key, value);
+}
+
+static inline void bk_emit_str(const char *key, const char *value) {
+    printf(BK_RESULT_PREFIX "%s=%s\n", key, value);
+}
+
+/* Emits the value of thread k as "thread_<k>". */
+static inline void bk_emit_thread_u64(unsigned k, uint64_t value) {
+    printf(BK_RESULT_PREFIX "thread_%u=%" PRIu64 "\n", k, value);
+}
+
+/*
+ * Emits <prefix>_count, <prefix>_mean_ns, <prefix>_p50_ns, _p90_ns, _p99_ns, _p999_ns and
+ * <prefix>_max_ns, converting the recorded ticks with bk_ticks_calibrate() (1.0 if the histogram
+ * recorded nanoseconds).
+ */
+static inline void bk_emit_hist(const char *prefix, const bk_hist_t *hist, double ns_per_tick) {
+    static const struct {
+        const char *suffix;
+        double percentile;
+    } percentiles[] = {{"p50", 50.0}, {"p90", 90.0}, {"p99", 99.0}, {"p999", 99.9}};
+    char key[128];
+
+    snprintf(key, sizeof(key), "%s_count", prefix);
+    bk_emit_u64(key, hist->count);
+    snprintf(key, sizeof(key), "%s_mean_ns", prefix);
+    bk_emit_double(key, hist->count > 0u ? (double) hist->sum / (double) hist->count * ns_per_tick
+                                         : 0.0);
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i) {
+        snprintf(key, sizeof(key), "%s_%s_ns", prefix, percentiles[i].suffix);
+        bk_emit_double(
+            key, (double) bk_hist_percentile(hist, percentiles[i].percentile) * ns_per_tick);
+    }
+    snprintf(key, sizeof(key), "%s_max_ns", prefix);
+    bk_emit_double(key, (double) hist->max * ns_per_tick);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCHKIT_HARNESS_H */
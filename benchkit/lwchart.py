@@ -9,6 +9,9 @@ environment.  Thus, we support dynamically importing the data science
 dependencies, only in case they are present in the environment.
 The chart can be generated only if those are present.
 Otherwise, the generation is skipped (with a warning).
+
+The results can also be read from the Parquet dataset written alongside the CSV file (see
+benchkit.utils.parquetsink), from which only the plotted columns are loaded; this requires pyarrow.
 """
 
 import datetime
@@ -16,8 +19,9 @@ import importlib.util
 import os
 import pathlib
 import sys
-from typing import List, Protocol
+from typing import Any, Dict, List, Optional, Protocol
 
+from benchkit.utils.parquetsink import is_parquet_path, read_columns
 from benchkit.utils.types import PathType
 
 libs = ["pandas", "matplotlib", "seaborn"]
@@ -115,6 +119,33 @@ def _read_csv(
     return result
 
 
+# seaborn arguments that name a column of the dataframe
+_COLUMN_ARGUMENTS = ["x", "y", "hue", "style", "size", "units", "weights", "col", "row"]
+
+
+def _plotted_columns(plot_args: Dict[str, Any]) -> Optional[List[str]]:
+    columns = [
+        value
+        for arg in _COLUMN_ARGUMENTS
+        if isinstance(value := plot_args.get(arg), str) and value
+    ]
+    if not columns:
+        return None  # e.g. wide-form data, all the columns are plotted
+    if "throughput" in columns:
+        columns.extend(["global_count", "duration"])  # see _generate_chart_from_df
+    return columns
+
+
+def _read_results(
+    pathname: PathType,
+    nan_replace: bool,
+    columns: Optional[List[str]],
+):
+    if is_parquet_path(pathname=pathname):
+        return read_columns(pathname=pathname, columns=columns)
+    return _read_csv(csv_pathname=pathname, nan_replace=nan_replace)
+
+
 class DataframeProcessor(Protocol):
     """
     Functions that apply a modification on a dataframe before it is plotted.
@@ -147,11 +178,12 @@ def generate_chart_from_single_csv(
     **kwargs,
 ) -> None:
     """
-    Generate a chart from a single CSV file.
+    Generate a chart from a single CSV file, or from a Parquet dataset (only the columns given to
+    the plot, e.g. x, y and hue, are then read).
 
     Args:
         csv_pathname (PathType):
-            path to the CSV file.
+            path to the CSV file, or to the Parquet dataset (".parquet" suffix).
         plot_name (str | List[str]):
             name of the (Seaborn) plot to generate.
         output_dir (PathType, optional):
@@ -163,7 +195,11 @@ def generate_chart_from_single_csv(
     """
     df = None
     try:
-        df = _read_csv(csv_pathname=csv_pathname, nan_replace=nan_replace)
+        df = _read_results(
+            pathname=csv_pathname,
+            nan_replace=nan_replace,
+            columns=_plotted_columns(plot_args=kwargs),
+        )
     except pd.errors.EmptyDataError:
         pass
 
@@ -189,11 +225,11 @@ def generate_chart_from_multiple_csvs(
     **kwargs,
 ) -> None:
     """
-    Generate a chart from data contained in multiple CSV files.
+    Generate a chart from data contained in multiple CSV files (or Parquet datasets).
 
     Args:
         csv_pathnames (List[PathType]):
-            list of paths to the CSV files.
+            list of paths to the CSV files, or to the Parquet datasets (".parquet" suffix).
         plot_name (str | List[str]):
             name of the (Seaborn) plot to generate.
         output_dir (PathType, optional):
@@ -209,16 +245,20 @@ def generate_chart_from_multiple_csvs(
             when parsing the dataset.
         process_dataframe (DataframeProcessor, optional):
             function to process the dataframe to apply a transformation before plotting.
-            Defaults to identical_dataframe.
+            Defaults to identical_dataframe. The Parquet datasets are then read entirely, as the
+            function may use any column; otherwise only the plotted columns are read.
     """
     if not _LIBRARIES_ENABLED:
         _print_warning()
         return
 
+    columns = None
+    if process_dataframe is identical_dataframe:
+        columns = _plotted_columns(plot_args=kwargs)
     dataframes = [
         df
         for p in csv_pathnames
-        if (df := _read_csv(csv_pathname=p, nan_replace=nan_replace)) is not None
+        if (df := _read_results(pathname=p, nan_replace=nan_replace, columns=columns)) is not None
     ]
     global_dataframe = pd.concat(dataframes)
     processed_dataframe = process_dataframe(dataframe=global_dataframe)
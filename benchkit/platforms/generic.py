@@ -4,14 +4,20 @@
 Module for the representation of generic platforms that can be derived into actual platforms.
 """
 
-from typing import List
+from subprocess import CalledProcessError
+from typing import Dict, List
 
 from benchkit.communication import CommunicationLayer
 from benchkit.platforms import evenorder
 from benchkit.platforms.utils import (
+    CpuLocation,
+    compact_cpu_order,
+    get_cpu_topology,
     get_nb_cpus_active,
     get_nb_cpus_isolated,
     get_nb_cpus_total,
+    get_numa_node_cpus,
+    smt_cpu_order,
 )
 from benchkit.utils import lscpu
 
@@ -176,6 +182,24 @@ class Platform:
         """
         return self._get_lscpu().numa_nodes()
 
+    def numa_node_cpus(self, node: int) -> List[int]:
+        """
+        Get the CPUs of the given NUMA node, as reported by the kernel, or assuming that the CPUs
+        of each node are numbered contiguously when the kernel does not report them.
+
+        Args:
+            node (int): identifier of the NUMA node.
+
+        Returns:
+            List[int]: the sorted identifiers of the CPUs of the NUMA node.
+        """
+        result = sorted(get_numa_node_cpus(comm_layer=self.comm, node=node))
+        if not result:
+            nb_cpus_per_numa_node = self.nb_cpus_per_numa_node()
+            first_cpu = node * nb_cpus_per_numa_node
+            result = list(range(first_cpu, first_cpu + nb_cpus_per_numa_node))
+        return result
+
     def nb_packages(self) -> int:
         """
         Get the total number of packages (or sockets) of the platform.
@@ -203,6 +227,9 @@ class Platform:
         Provide the list of CPU identifiers in the order matching the given specified CPU order.
         For example, if the provided order is "asc" on a platform with 4 cores, the result will be
         [0, 1, 2, 3]. If the provided order is "desc", the result will be [3, 2, 1, 0], etc.
+        The "compact" and "smt" orders follow the topology of the platform (see cpu_topology):
+        "compact" fills the cores of a NUMA node before moving to the next one, the SMT siblings
+        last, and "smt" fills the SMT siblings of a core before moving to the next core.
 
         Args:
             provided_order (str | List[int], optional):
@@ -229,11 +256,42 @@ class Platform:
                 result_ordering = list(range(nb_cpus - 1, -1, -1))
             case "asc":
                 result_ordering = list(range(1, nb_cpus, 1)) + [0]
+            case "compact":
+                result_ordering = compact_cpu_order(topology=self.cpu_topology())
+            case "smt":
+                result_ordering = smt_cpu_order(topology=self.cpu_topology())
             case _:
                 raise NotImplementedError(f"Unknown core ordering technique: {provided_order}")
 
         return result_ordering
 
+    def cpu_topology(self) -> Dict[int, CpuLocation]:
+        """
+        Get the package, the NUMA node and the core of each CPU, as reported by lscpu, since the
+        numbering of the SMT siblings and of the nodes varies between machines. When lscpu cannot
+        report it, the CPUs of each node are assumed to be numbered contiguously, and the SMT
+        siblings of core c to be c, c + nb_cores, ...
+
+        Returns:
+            Dict[int, CpuLocation]: the location of each CPU.
+        """
+        try:
+            result = get_cpu_topology(comm_layer=self.comm)
+        except (CalledProcessError, ValueError):
+            result = {}
+        if not result:
+            nb_cores = self.nb_hyperthreaded_cores()
+            cpu2node = {
+                cpu: node
+                for node in range(self.nb_numa_nodes())
+                for cpu in self.numa_node_cpus(node=node)
+            }
+            result = {
+                cpu: CpuLocation(package=0, node=cpu2node.get(cpu, 0), core=cpu % nb_cores)
+                for cpu in range(self.nb_cpus())
+            }
+        return result
+
     def master_thread_core_id(self, cpu_order_list: List[int]) -> int:
         """
         Given a list of CPU identifiers that will be a thread-to-core assignment, return on what
@@ -5,7 +5,7 @@ Utilities related to platform modules.
 """
 
 import os
-from typing import Set
+from typing import Dict, List, NamedTuple, Set
 
 from benchkit.communication import CommunicationLayer
 
@@ -83,3 +83,106 @@ def get_nb_cpus_active(comm_layer: CommunicationLayer) -> int:
     nb_cpus_active = nb_cpus_total - nb_cpus_isolated
 
     return nb_cpus_active
+
+
+def get_numa_node_cpus(comm_layer: CommunicationLayer, node: int) -> Set[int]:
+    """Get the CPUs of the given NUMA node on the provided host.
+
+    Args:
+        comm_layer (CommunicationLayer): communication layer of the provided host.
+        node (int): identifier of the NUMA node.
+
+    Returns:
+        Set[int]: the identifiers of the CPUs of the NUMA node (empty if unknown).
+    """
+    cpulist_path = f"/sys/devices/system/node/node{node}/cpulist"
+    if not comm_layer.path_exists(path=cpulist_path):
+        return set()
+    cpulist_str = comm_layer.read_file(path=cpulist_path).strip()
+    return _parse_list_ranges(list_ranges=cpulist_str)
+
+
+class CpuLocation(NamedTuple):
+    """Location of a CPU in the topology of the platform."""
+
+    package: int
+    node: int
+    core: int
+
+
+def parse_lscpu_topology(lscpu_output: str) -> Dict[int, CpuLocation]:
+    """Parse the output of `lscpu -p=CPU,CORE,SOCKET,NODE`.
+
+    Args:
+        lscpu_output (str): the output of lscpu.
+
+    Returns:
+        Dict[int, CpuLocation]: the location of each CPU (node 0 when lscpu reports none).
+    """
+    result = {}
+    for line in lscpu_output.splitlines():
+        if not line.strip() or line.startswith("#"):
+            continue
+        cpu, core, package, node = (line.split(",") + ["", "", ""])[:4]
+        result[int(cpu)] = CpuLocation(
+            package=int(package) if package else 0,
+            node=int(node) if node else 0,
+            core=int(core) if core else int(cpu),
+        )
+    return result
+
+
+def get_cpu_topology(comm_layer: CommunicationLayer) -> Dict[int, CpuLocation]:
+    """Get the package, the NUMA node and the core of each CPU of the provided host.
+
+    Args:
+        comm_layer (CommunicationLayer): communication layer of the provided host.
+
+    Returns:
+        Dict[int, CpuLocation]: the location of each CPU.
+    """
+    lscpu_output = comm_layer.shell(
+        command="lscpu -p=CPU,CORE,SOCKET,NODE",
+        print_input=False,
+        print_output=False,
+    )
+    return parse_lscpu_topology(lscpu_output=lscpu_output)
+
+
+def _smt_indexes(topology: Dict[int, CpuLocation]) -> Dict[int, int]:
+    # rank of each CPU among the SMT siblings of its core (0 for the first hyperthread)
+    siblings: Dict[CpuLocation, List[int]] = {}
+    for cpu in sorted(topology):
+        siblings.setdefault(topology[cpu], []).append(cpu)
+    return {cpu: cpus.index(cpu) for cpus in siblings.values() for cpu in cpus}
+
+
+def compact_cpu_order(topology: Dict[int, CpuLocation]) -> List[int]:
+    """Order the CPUs to fill the cores of a NUMA node before moving to the next one, the SMT
+    siblings of the cores coming after all the first hyperthreads.
+
+    Args:
+        topology (Dict[int, CpuLocation]): the location of each CPU.
+
+    Returns:
+        List[int]: the CPUs in the compact order.
+    """
+    smt_index = _smt_indexes(topology=topology)
+    return sorted(
+        topology,
+        key=lambda cpu: (smt_index[cpu], topology[cpu].node, topology[cpu], cpu),
+    )
+
+
+def smt_cpu_order(topology: Dict[int, CpuLocation]) -> List[int]:
+    """Order the CPUs to fill the SMT siblings of a core before moving to the next core, the cores
+    of a NUMA node before the ones of the next node.
+
+    Args:
+        topology (Dict[int, CpuLocation]): the location of each CPU.
+
+    Returns:
+        List[int]: the CPUs in the SMT order.
+    """
+    smt_index = _smt_indexes(topology=topology)
+    return sorted(topology, key=lambda cpu: (topology[cpu].node, topology[cpu], smt_index[cpu]))
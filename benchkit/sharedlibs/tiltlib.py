@@ -7,7 +7,7 @@ Tilt shared library for drop-in replacement of pthread_mutex_t type and associat
 
 import pathlib
 import re
-from typing import List, Optional, Tuple
+from typing import Dict, List, Optional, Tuple
 
 from benchkit.sharedlibs import (
     EnvironmentVariables,
@@ -22,8 +22,17 @@ from benchkit.utils.types import PathType
 class TiltLib(FromSourceSharedLib):
     """
     Tilt shared library for drop-in replacement of pthread_mutex_t type and associated functions
+
+    The sources are a CMake project building the library libtilt-<lock>.so of a lock, which
+    cmake_definitions selects along with its atomics and LSE setting: the CMake options depend on
+    the sources, so subclasses define them (see tutorials/libvsync-locks/kit/vsynctilt.py for an
+    example). All the locks are built in the same build directory, where they are kept side by
+    side.
     """
 
+    _lib_name = "libtilt"
+    _supported_atomics = ("a64", "c11", "blt")
+
     class LibTiltNotFoundError(Exception):
         """Error raised when tilt library is not found."""
 
@@ -33,6 +42,7 @@ class TiltLib(FromSourceSharedLib):
         debug_mode: bool,
     ) -> None:
         super().__init__(src_path=src_path, debug_mode=debug_mode)
+        self._built_locks: Dict[str, Tuple[Optional[str], bool]] = {}
 
     def dependencies(self) -> List[PackageDependency]:
         return super().dependencies()
@@ -44,28 +54,100 @@ class TiltLib(FromSourceSharedLib):
         """
         Clean the library build.
         """
+        if self.platform.comm.isdir(self.build_dir):
+            self.platform.comm.remove(path=self.build_dir, recursive=True)
+        self._built_locks = {}
+
+    def cmake_definitions(
+        self,
+        lock: str,
+        atomics: Optional[str],
+        use_lse: bool,
+    ) -> Dict[str, str]:
+        """
+        Return the CMake definitions configuring the sources to build the library of a lock.
+
+        Args:
+            lock (str): the name of the lock to build.
+            atomics (Optional[str]): the atomics of the lock, None for the default of the target.
+            use_lse (bool): whether to use LSE instructions on Armv8.
+
+        Raises:
+            NotImplementedError: the options of the sources are only known by the subclasses.
+
+        Returns:
+            Dict[str, str]: the value of each CMake variable (passed as -D<name>=<value>).
+        """
         raise NotImplementedError
 
     def build_single_lock(
         self,
         lock: str,
-        atomics: str,
-        use_lse: bool,
+        atomics: Optional[str] = None,
+        use_lse: bool = False,
     ) -> None:
         """
         Build the library for the given lock.
 
         Args:
             lock (str):
-                the name of the lock to build.
-            atomics (str):
+                the name of the lock to build. The empty string is the baseline (the pthread
+                mutexes of the C library), for which nothing is built.
+            atomics (Optional[str], optional):
                 what atomics the lock is supposed to used.
                 Supported: a64 (for armv8), c11 (for std atomic), blt (for builtins).
-            use_lse (bool):
-                whether to use LSE instructions on Armv8.
-                TODO: not supported for now.
+                None uses the default atomics of the target. Defaults to None.
+            use_lse (bool, optional):
+                whether to use LSE instructions on Armv8. Defaults to False.
+
+        Raises:
+            ValueError:
+                if the atomics are not supported, or if the lock was already built with other
+                atomics or LSE setting (the library path of a lock does not depend on them).
+            self.LibTiltNotFoundError: if the build did not produce the library of the lock.
+            NotImplementedError: if cmake_definitions is not defined for the sources.
         """
-        raise NotImplementedError
+        if not lock:  # baseline
+            return
+        if atomics is not None and atomics not in self._supported_atomics:
+            raise ValueError(
+                f'Unsupported atomics for tilt: "{atomics}" (expected one of '
+                f'{", ".join(self._supported_atomics)})'
+            )
+
+        variant = (atomics, use_lse)
+        built_variant = self._built_locks.get(lock)
+        if built_variant == variant:
+            return
+        if built_variant is not None:
+            raise ValueError(
+                f'Lock "{lock}" is already built with atomics={built_variant[0]} and '
+                f"use_lse={built_variant[1]}: a campaign can only use one variant of each lock"
+            )
+
+        definitions = self.cmake_definitions(lock=lock, atomics=atomics, use_lse=use_lse)
+        cmake_build_type = "Debug" if self.must_debug() else "Release"
+        self.platform.comm.makedirs(path=self.build_dir, exist_ok=True)
+        self.platform.comm.shell(
+            command=["cmake", f"-DCMAKE_BUILD_TYPE={cmake_build_type}"]
+            + [f"-D{name}={value}" for name, value in definitions.items()]
+            + [str(self.src_path)],
+            current_dir=self.build_dir,
+            output_is_log=True,
+        )
+        self.platform.comm.shell(
+            command=["make", f"-j{self.platform.nb_cpus()}"],
+            current_dir=self.build_dir,
+            output_is_log=True,
+        )
+
+        self.check_path_for_lock(
+            lock=lock,
+            use_lse=use_lse,
+            atomics=atomics,
+            lib_name=self._lib_name,
+        )
+        self._built_locks[lock] = variant
 
     def get_compiler(self) -> str:
         """
@@ -74,10 +156,11 @@ class TiltLib(FromSourceSharedLib):
         Returns:
             str: the compiler used to build the tilt library.
         """
-        cmake_logpath = self.build_dir / "CMakeFiles/CMakeOutput.log"
-        with open(cmake_logpath, "r") as cmake_logfile:
-            for line in cmake_logfile:
-                match = re.match(r"Compiler: (.*)\n", line)
+        # the cache is written by all CMake versions, unlike CMakeFiles/CMakeOutput.log
+        cmake_cachepath = self.build_dir / "CMakeCache.txt"
+        with open(cmake_cachepath, "r") as cmake_cachefile:
+            for line in cmake_cachefile:
+                match = re.match(r"CMAKE_C_COMPILER:\w+=(.*)\n", line)
                 if match is not None:
                     break
         compiler = match.groups()[0].strip()
@@ -149,7 +232,7 @@ class TiltLib(FromSourceSharedLib):
         lock: str,
         use_lse: bool,
         atomics: str,
-        lib_name: str,
+        lib_name: str = _lib_name,
         **kwargs,
     ) -> Tuple[LdPreloadLibraries, EnvironmentVariables]:
         ld_preloads, other_env_vars = super().preload(
@@ -0,0 +1,224 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Content-addressed cache of benchmark builds.
+
+Each variant of a benchmark is built in its own directory, named after a hash of everything that
+determines the build: the content of the source tree, the build variables and the toolchain
+(compiler versions and flags). Variants are kept side by side, so that re-running or extending a
+campaign, or running another campaign on the same sources, reuses the builds that already exist
+instead of compiling them again.
+"""
+
+import hashlib
+import json
+import os
+import pathlib
+import shutil
+from typing import Any, Dict, Iterable, List, Optional
+
+from benchkit.platforms import Platform
+from benchkit.utils.types import PathType
+
+# Environment variables that change what the build systems compile.
+TOOLCHAIN_ENV_VARS = ("CC", "CXX", "CFLAGS", "CXXFLAGS", "CPPFLAGS", "LDFLAGS")
+
+_MARKER_FILENAME = "benchkit-build.json"
+
+
+def hash_source_tree(
+    source_paths: Iterable[PathType],
+    excluded_dirnames: Iterable[str] = (".git",),
+) -> str:
+    """
+    Hash the content of the given files and directories (recursively, following symbolic links),
+    along with the relative path of each file, independently of the modification times.
+
+    Args:
+        source_paths (Iterable[PathType]):
+            files and directories to hash.
+        excluded_dirnames (Iterable[str], optional):
+            names of the directories to skip, e.g. the build directories that live in the source
+            tree. Defaults to (".git",).
+
+    Returns:
+        str: the hexadecimal SHA-256 digest of the source tree.
+    """
+    excluded = set(excluded_dirnames)
+    digest = hashlib.sha256()
+
+    def hash_file(path: pathlib.Path, name: str) -> None:
+        digest.update(name.encode() + b"\0")
+        with open(path, "rb") as source_file:
+            for chunk in iter(lambda: source_file.read(1 << 20), b""):
+                digest.update(chunk)
+        digest.update(b"\0")
+
+    for source_path in source_paths:
+        root = pathlib.Path(source_path)
+        if root.is_file():
+            hash_file(path=root, name=root.name)
+            continue
+        for dirpath, dirnames, filenames in os.walk(root, followlinks=True):
+            dirnames[:] = sorted(d for d in dirnames if d not in excluded)
+            for filename in sorted(filenames):
+                path = pathlib.Path(dirpath) / filename
+                if path.is_file():
+                    hash_file(path=path, name=str(root.name / path.relative_to(root)))
+    return digest.hexdigest()
+
+
+def toolchain_fingerprint(
+    platform: Platform,
+    commands: Iterable[str],
+) -> Dict[str, str]:
+    """
+    Describe the toolchain used to build a benchmark: the version of each of the given commands
+    (e.g. the compilers and the build system) and the toolchain environment variables, both as
+    seen on the platform (e.g. with the environment of a remote host).
+
+    Args:
+        platform (Platform):
+            platform on which the benchmark is built.
+        commands (Iterable[str]):
+            commands that support --version, e.g. ["cc", "cmake"].
+
+    Returns:
+        Dict[str, str]: the toolchain description, to include in the key of the builds.
+    """
+    result = {}
+    for command in commands:
+        result[command] = platform.comm.shell(
+            command=[command, "--version"],
+            print_input=False,
+            print_output=False,
+        ).strip()
+    environment = platform.comm.shell(
+        command=["env"],
+        print_input=False,
+        print_output=False,
+    )
+    env_values = dict(line.split("=", 1) for line in environment.splitlines() if "=" in line)
+    for env_var in TOOLCHAIN_ENV_VARS:
+        result[env_var] = env_values.get(env_var, "")
+    return result
+
+
+class BuildCache:
+    """
+    Directory holding one build directory per variant of a benchmark.
+
+    A build directory becomes a cache entry once the build succeeded and mark_built() recorded it;
+    a build directory without the record (e.g. an interrupted build) is started over.
+    """
+
+    def __init__(self, cache_dir: PathType) -> None:
+        self._cache_dir = pathlib.Path(cache_dir)
+
+    @staticmethod
+    def key(
+        source_hash: str,
+        build_variables: Dict[str, Any],
+        toolchain: Dict[str, str],
+    ) -> str:
+        """
+        Compute the key of a variant.
+
+        Args:
+            source_hash (str):
+                hash of the source tree, see hash_source_tree.
+            build_variables (Dict[str, Any]):
+                build variables of the variant (including the ones with default values, so that
+                the key does not change when a default value is given explicitly).
+            toolchain (Dict[str, str]):
+                description of the toolchain, see toolchain_fingerprint.
+
+        Returns:
+            str: the key of the variant.
+        """
+        content = json.dumps(
+            {"source": source_hash, "build_variables": build_variables, "toolchain": toolchain},
+            sort_keys=True,
+            default=str,
+        )
+        return hashlib.sha256(content.encode()).hexdigest()[:16]
+
+    def build_dir(self, key: str) -> pathlib.Path:
+        """
+        Return the build directory of a variant, created if needed.
+
+        Args:
+            key (str): key of the variant.
+
+        Returns:
+            pathlib.Path: the path to the build directory of the variant.
+        """
+        result = self._cache_dir / key
+        result.mkdir(parents=True, exist_ok=True)
+        return result
+
+    def is_built(self, key: str) -> bool:
+        """
+        Return whether the variant was successfully built.
+
+        Args:
+            key (str): key of the variant.
+
+        Returns:
+            bool: whether the variant is in the cache.
+        """
+        return (self._cache_dir / key / _MARKER_FILENAME).is_file()
+
+    def mark_built(self, key: str, description: Dict[str, Any]) -> None:
+        """
+        Record that the variant was successfully built.
+
+        Args:
+            key (str): key of the variant.
+            description (Dict[str, Any]):
+                what the variant was built from, stored along with the build for reference.
+        """
+        marker_path = self.build_dir(key) / _MARKER_FILENAME
+        tmp_path = marker_path.with_suffix(".tmp")
+        tmp_path.write_text(json.dumps(description, indent=4, sort_keys=True, default=str) + "\n")
+        tmp_path.replace(marker_path)
+
+    def start_build(self, key: str) -> pathlib.Path:
+        """
+        Return an empty build directory for the variant, removing any previous incomplete build.
+
+        Args:
+            key (str): key of the variant.
+
+        Returns:
+            pathlib.Path: the path to the (empty) build directory of the variant.
+        """
+        build_dir = self._cache_dir / key
+        if build_dir.is_dir():
+            shutil.rmtree(build_dir)
+        return self.build_dir(key)
+
+    def keys(self) -> List[str]:
+        """
+        Return the keys of the variants in the cache.
+
+        Returns:
+            List[str]: the keys of the successfully built variants.
+        """
+        if not self._cache_dir.is_dir():
+            return []
+        return sorted(p.name for p in self._cache_dir.iterdir() if self.is_built(p.name))
+
+    def description(self, key: str) -> Optional[Dict[str, Any]]:
+        """
+        Return what the variant was built from, as given to mark_built.
+
+        Args:
+            key (str): key of the variant.
+
+        Returns:
+            Optional[Dict[str, Any]]: the description of the variant, None if it is not built.
+        """
+        if not self.is_built(key):
+            return None
+        return json.loads((self._cache_dir / key / _MARKER_FILENAME).read_text())
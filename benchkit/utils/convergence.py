@@ -0,0 +1,158 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Statistical convergence of the runs of a benchmark configuration, to stop repeating a
+configuration once the confidence interval of the mean of a metric is narrow enough, instead of
+running a fixed number of times every configuration, stable or noisy.
+"""
+
+import math
+import statistics
+from dataclasses import dataclass
+from typing import Sequence
+
+
+def _beta_continued_fraction(a: float, b: float, x: float) -> float:
+    # continued fraction of the incomplete beta function (modified Lentz's method)
+    tiny = 1e-300
+    c = 1.0
+    d = 1.0 - (a + b) * x / (a + 1.0)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    result = d
+    for m in range(1, 1000):
+        for numerator in [
+            m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m)),
+            -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1)),
+        ]:
+            d = 1.0 + numerator * d
+            d = 1.0 / (d if abs(d) > tiny else tiny)
+            c = 1.0 + numerator / c
+            c = c if abs(c) > tiny else tiny
+            result *= c * d
+        if abs(c * d - 1.0) < 1e-15:
+            break
+    return result
+
+
+def _regularized_incomplete_beta(a: float, b: float, x: float) -> float:
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    log_front = (
+        math.lgamma(a + b)
+        - math.lgamma(a)
+        - math.lgamma(b)
+        + a * math.log(x)
+        + b * math.log(1.0 - x)
+    )
+    front = math.exp(log_front)
+    if x < (a + 1.0) / (a + b + 2.0):
+        return front * _beta_continued_fraction(a, b, x) / a
+    return 1.0 - front * _beta_continued_fraction(b, a, 1.0 - x) / b
+
+
+def student_t_cdf(t: float, df: int) -> float:
+    """
+    Return the cumulative distribution function of the Student's t-distribution.
+
+    Args:
+        t (float): the value at which to evaluate the function.
+        df (int): the number of degrees of freedom.
+
+    Returns:
+        float: the probability that a variable of the distribution is lower than t.
+    """
+    tail = 0.5 * _regularized_incomplete_beta(df / 2.0, 0.5, df / (df + t * t))
+    return 1.0 - tail if t > 0 else tail
+
+
+def student_t_quantile(p: float, df: int) -> float:
+    """
+    Return the quantile of the Student's t-distribution, e.g. 12.706 for p=0.975 and df=1.
+
+    Args:
+        p (float): the probability, in ]0.5, 1[.
+        df (int): the number of degrees of freedom.
+
+    Returns:
+        float: the value t such that student_t_cdf(t, df) = p.
+    """
+    low, high = 0.0, 1.0
+    while student_t_cdf(high, df) < p:
+        low, high = high, 2.0 * high
+    for _ in range(100):
+        middle = (low + high) / 2.0
+        if student_t_cdf(middle, df) < p:
+            low = middle
+        else:
+            high = middle
+    return (low + high) / 2.0
+
+
+@dataclass(frozen=True)
+class ConvergenceCriterion:
+    """
+    Criterion to stop repeating the runs of a configuration: the half-width of the confidence
+    interval of the mean of a metric, relative to the mean, falls below a threshold.
+
+    Attributes:
+        metric (str): the result column whose mean must converge, e.g. "global_count".
+        relative_ci (float):
+            the relative half-width of the confidence interval to reach, e.g. 0.02 for a mean
+            known within +/- 2%.
+        confidence (float): the confidence level of the interval. Defaults to 0.95.
+        min_runs (int): the number of runs before which the convergence is not checked.
+            Defaults to 3.
+    """
+
+    metric: str
+    relative_ci: float
+    confidence: float = 0.95
+    min_runs: int = 3
+
+    def __post_init__(self) -> None:
+        if self.relative_ci <= 0:
+            raise ValueError(f"The relative confidence interval must be positive: {self}")
+        if not 0 < self.confidence < 1:
+            raise ValueError(f"The confidence level must be in ]0, 1[: {self}")
+        if self.min_runs < 2:
+            raise ValueError(f"At least 2 runs are needed to estimate the variance: {self}")
+
+    def relative_half_width(self, values: Sequence[float]) -> float:
+        """
+        Return the half-width of the confidence interval of the mean of the values (Student's
+        t-interval), relative to the mean.
+
+        Args:
+            values (Sequence[float]): the values of the metric, one per run.
+
+        Returns:
+            float: the relative half-width, infinite when it cannot be estimated (less than two
+                   values, or a zero mean with a non-zero variance).
+        """
+        if len(values) < 2:
+            return math.inf
+        stdev = statistics.stdev(values)
+        if stdev == 0:
+            return 0.0
+        mean = statistics.fmean(values)
+        if mean == 0:
+            return math.inf
+        t_value = student_t_quantile(p=0.5 + self.confidence / 2, df=len(values) - 1)
+        return t_value * stdev / math.sqrt(len(values)) / abs(mean)
+
+    def is_converged(self, values: Sequence[float]) -> bool:
+        """
+        Return whether the runs done so far give a narrow enough confidence interval.
+
+        Args:
+            values (Sequence[float]): the values of the metric, one per run.
+
+        Returns:
+            bool: whether the configuration needs no more runs.
+        """
+        return (
+            len(values) >= self.min_runs
+            and self.relative_half_width(values=values) <= self.relative_ci
+        )
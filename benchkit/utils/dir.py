@@ -250,3 +250,16 @@ def caller_dir() -> pathlib.Path:
     caller_filepath = caller_file_abs_path()
     caller_parent = caller_filepath.parent.resolve()
     return caller_parent
+
+
+def benchkit_include_dir() -> pathlib.Path:
+    """
+    Return the include directory of the header-only harness for native benchmarks, to add to the
+    include path of their build (e.g. -I<dir>, then #include <benchkit/harness.h>).
+    The directory is on the host: a benchmark built on a remote platform has to copy it over.
+
+    Returns:
+        pathlib.Path: the absolute path of the benchkit include directory.
+    """
+    result = (pathlib.Path(__file__).parent.parent / "include").resolve()
+    return result
@@ -0,0 +1,275 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Columnar output of the results of a campaign, alongside the CSV result file: a Parquet dataset
+(a directory of Parquet files, the continued executions of the campaign adding files) written as
+the campaign progresses, so that the charts can later read only the columns they plot.
+
+The header of the CSV file (the "# key: value" comment lines) is stored as metadata of each
+Parquet file. This module requires pyarrow, which is only imported when a sink is created or a
+dataset is read.
+"""
+
+import importlib
+import os
+import pathlib
+import re
+from typing import Any, Dict, Iterable, List, Optional
+
+from benchkit.utils.types import PathType
+
+PARQUET_SUFFIX = ".parquet"
+
+
+def _import_pyarrow():
+    try:
+        pyarrow = importlib.import_module("pyarrow")
+        importlib.import_module("pyarrow.parquet")
+    except ModuleNotFoundError as err:
+        raise ModuleNotFoundError(
+            "The Parquet output of the results requires pyarrow (pip install pyarrow)."
+        ) from err
+    return pyarrow
+
+
+def parquet_dataset_path(csv_output_path: PathType) -> pathlib.Path:
+    """
+    Return the path of the Parquet dataset of the given CSV result file.
+
+    Args:
+        csv_output_path (PathType): path of the CSV result file.
+
+    Returns:
+        pathlib.Path: path of the dataset directory, the CSV path with the ".parquet" suffix.
+    """
+    return pathlib.Path(csv_output_path).with_suffix(PARQUET_SUFFIX)
+
+
+def is_parquet_path(pathname: PathType) -> bool:
+    """
+    Return whether the given path is a Parquet file or dataset (rather than a CSV file).
+
+    Args:
+        pathname (PathType): path of the results.
+
+    Returns:
+        bool: whether the path has the ".parquet" suffix.
+    """
+    return pathlib.Path(pathname).suffix == PARQUET_SUFFIX
+
+
+def comment_metadata(comments: str) -> Dict[str, str]:
+    """
+    Return the "key: value" pairs of the comment lines of a CSV result file header.
+
+    Args:
+        comments (str): the comment lines, e.g. "# nb_runs: 3".
+
+    Returns:
+        Dict[str, str]: the values of the header, by key.
+    """
+    result = {}
+    for line in comments.splitlines():
+        m = re.match(pattern=r"^#\s*(?P<key>[^:#]+?): (?P<value>.*)$", string=line)
+        if m is not None:
+            result[m.group("key")] = m.group("value").strip()
+    return result
+
+
+def _dataset_files(pathname: PathType) -> List[pathlib.Path]:
+    path = pathlib.Path(pathname)
+    if not path.is_dir():
+        return [path]
+    return sorted(path.glob(f"*{PARQUET_SUFFIX}"))
+
+
+def read_metadata(pathname: PathType) -> Dict[str, str]:
+    """
+    Return the header metadata of a Parquet file, or of the first file of a Parquet dataset.
+
+    Args:
+        pathname (PathType): path of the Parquet file or dataset.
+
+    Returns:
+        Dict[str, str]: the header values, by key.
+    """
+    pyarrow = _import_pyarrow()
+    files = _dataset_files(pathname=pathname)
+    if not files:
+        return {}
+    metadata = pyarrow.parquet.read_schema(files[0]).metadata or {}
+    return {key.decode(): value.decode() for key, value in metadata.items()}
+
+
+def read_columns(pathname: PathType, columns: Optional[Iterable[str]] = None):
+    """
+    Read the given columns of a Parquet file or dataset into a pandas dataframe. Only these
+    columns are read from the files. The files may have different columns (e.g. the ones of a
+    continued campaign), the values missing from a file being NaN.
+
+    Args:
+        pathname (PathType): path of the Parquet file or dataset.
+        columns (Optional[Iterable[str]], optional):
+            the columns to read (the ones that do not exist are ignored), or None for all of them.
+            Defaults to None.
+
+    Returns:
+        pandas.DataFrame: the dataframe holding the results.
+    """
+    pyarrow = _import_pyarrow()
+    pandas = importlib.import_module("pandas")
+    if columns is not None:
+        columns = list(dict.fromkeys(columns))
+
+    frames = []
+    names = {}
+    for path in _dataset_files(pathname=pathname):
+        file_names = pyarrow.parquet.read_schema(path).names
+        file_columns = file_names if columns is None else [c for c in columns if c in file_names]
+        names.update(dict.fromkeys(file_columns))
+        frames.append(pyarrow.parquet.read_table(path, columns=file_columns).to_pandas())
+    if not frames:
+        return pandas.DataFrame()
+
+    result = pandas.concat(frames, ignore_index=True)
+    ordered_names = list(names) if columns is None else [c for c in columns if c in names]
+    return result[ordered_names]
+
+
+class ParquetSink:
+    """
+    Writer of the result lines of a campaign into a Parquet dataset, one file (holding a single
+    row group) every row_group_size lines.
+
+    Each file is written under a temporary name, then renamed, so that the dataset only holds
+    complete files: a campaign that stops (e.g. killed) loses the lines not flushed yet, and the
+    next sink of the dataset removes its incomplete file. The schema of each file is the one of
+    its lines, where the thread_<k> columns (if any) are completed up to the maximal number of
+    threads, as in the header of the CSV file; the columns may thus change from a file to the
+    next one.
+    """
+
+    _tmp_suffix = ".tmp"
+
+    def __init__(
+        self,
+        dataset_path: PathType,
+        metadata: Dict[str, str],
+        row_group_size: int,
+        nb_thread_columns: int = 0,
+    ) -> None:
+        """
+        Create the sink, the files of the execution being numbered after the ones of the dataset.
+
+        Args:
+            dataset_path (PathType): path of the dataset directory, created if needed.
+            metadata (Dict[str, str]): the header metadata to store in each file.
+            row_group_size (int): number of result lines written in each file.
+            nb_thread_columns (int, optional):
+                number of thread_<k> columns of the schema, when the results have some.
+                Defaults to 0.
+
+        Raises:
+            ValueError: if the row group size is not positive.
+        """
+        if row_group_size <= 0:
+            raise ValueError(f"The row group size must be positive: {row_group_size}")
+        self._pa = _import_pyarrow()
+
+        self.path = pathlib.Path(dataset_path)
+        self.path.mkdir(parents=True, exist_ok=True)
+        for tmp_path in self.path.glob(f"*{self._tmp_suffix}"):  # left by a stopped campaign
+            tmp_path.unlink()
+        executions = [
+            int(m.group("execution"))
+            for m in (
+                re.match(r"^part-(?P<execution>[0-9]+)-", path.name)
+                for path in self.path.glob(f"part-*{PARQUET_SUFFIX}")
+            )
+            if m is not None
+        ]
+        self._execution = max(executions, default=-1) + 1
+
+        self._metadata = dict(metadata)
+        self._row_group_size = row_group_size
+        self._nb_thread_columns = nb_thread_columns
+        self._rows: List[Dict[str, Any]] = []
+        self._nb_files = 0
+
+    def append(self, row: Dict[str, Any]) -> None:
+        """
+        Append a result line, written with the next file.
+
+        Args:
+            row (Dict[str, Any]): the result line, by column.
+        """
+        self._rows.append(dict(row))
+        if len(self._rows) >= self._row_group_size:
+            self.flush()
+
+    def flush(self) -> None:
+        """Write the pending result lines in a new file of the dataset."""
+        if not self._rows:
+            return
+        table = self._table(rows=self._rows)
+        name = f"part-{self._execution:04}-{self._nb_files:05}{PARQUET_SUFFIX}"
+        tmp_path = self.path / f"{name}{self._tmp_suffix}"
+        self._pa.parquet.write_table(table, f"{tmp_path}")
+        os.replace(tmp_path, self.path / name)
+        self._nb_files += 1
+        self._rows = []
+
+    def close(self) -> None:
+        """Write the pending result lines."""
+        self.flush()
+
+    def _table(self, rows: List[Dict[str, Any]]):
+        pa = self._pa
+        names = list(dict.fromkeys(name for row in rows for name in row))
+        table = pa.table({name: self._column_values(rows=rows, name=name) for name in names})
+        schema = self._schema(schema=table.schema)
+        arrays = [
+            (
+                table.column(field.name).cast(field.type)
+                if field.name in names
+                else pa.nulls(len(rows), type=field.type)
+            )
+            for field in schema
+        ]
+        return pa.Table.from_arrays(arrays, schema=schema)
+
+    def _schema(self, schema):
+        pa = self._pa
+        fields = list(schema)
+        names = [field.name for field in fields]
+        thread_type = pa.int64()
+        if "thread_0" in names and not pa.types.is_null(schema.field("thread_0").type):
+            thread_type = schema.field("thread_0").type
+        if any(name.startswith("thread_") for name in names):
+            fields.extend(
+                pa.field(f"thread_{k}", thread_type)
+                for k in range(self._nb_thread_columns)
+                if f"thread_{k}" not in names
+            )
+
+        # the columns without any value in the file get a type able to hold any value
+        result = []
+        for field in fields:
+            if pa.types.is_null(field.type):
+                field_type = thread_type if field.name.startswith("thread_") else pa.string()
+                field = pa.field(field.name, field_type)
+            result.append(field)
+
+        metadata = {k: f"{v}" for k, v in self._metadata.items()}
+        return pa.schema(result, metadata=metadata)
+
+    @staticmethod
+    def _column_values(rows: List[Dict[str, Any]], name: str) -> List[Any]:
+        # the values are scalars, the other ones (e.g. lists of CPUs) are converted as in the CSV
+        values = [row.get(name) for row in rows]
+        values = [
+            v if v is None or isinstance(v, (bool, int, float, str)) else f"{v}" for v in values
+        ]
+        if any(isinstance(v, str) for v in values):
+            values = [v if v is None else f"{v}" for v in values]
+        return values
@@ -0,0 +1,122 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Partitions of the CPUs of a platform, on which independent benchmark runs execute concurrently,
+each confined to its own partition (e.g. its own NUMA node) so that they do not disturb each other.
+"""
+
+from dataclasses import dataclass
+from typing import Iterable, List, Optional, Tuple
+
+from benchkit.commandwrappers.numactl import NumactlWrap
+from benchkit.platforms import Platform
+
+
+@dataclass(frozen=True)
+class RunPartition:
+    """
+    Set of CPUs (and optionally the NUMA node holding them) reserved for one run at a time.
+
+    Attributes:
+        index (int): index of the partition, unique among the partitions of a campaign.
+        cpus (Tuple[int, ...]): the CPUs of the partition.
+        numa_node (Optional[int]):
+            the NUMA node of the partition, whose memory the runs allocate from, or None when the
+            partition is an arbitrary set of CPUs (the memory is then allocated locally).
+    """
+
+    index: int
+    cpus: Tuple[int, ...]
+    numa_node: Optional[int] = None
+
+    def command_prefix(self) -> List[str]:
+        """
+        Return the prefix confining a command to the partition, with numactl.
+
+        Returns:
+            List[str]: the command prefix.
+        """
+        if self.numa_node is not None:
+            wrapper = NumactlWrap(
+                local_alloc=False,
+                interleave_nodes=None,
+                cpu_nodes=[self.numa_node],
+                membind_nodes=[self.numa_node],
+            )
+        else:
+            wrapper = NumactlWrap(
+                local_alloc=True,
+                interleave_nodes=None,
+                physical_cpus=self.cpus,
+            )
+        return wrapper.command_prefix()
+
+
+def numa_partitions(platform: Platform) -> List[RunPartition]:
+    """
+    Return one partition per NUMA node of the platform.
+
+    Args:
+        platform (Platform): the platform to partition.
+
+    Returns:
+        List[RunPartition]: the partitions, in the order of the NUMA nodes.
+    """
+    return [
+        RunPartition(index=node, cpus=tuple(platform.numa_node_cpus(node=node)), numa_node=node)
+        for node in range(platform.nb_numa_nodes())
+    ]
+
+
+def cpu_partitions(cpu_lists: Iterable[Iterable[int]]) -> List[RunPartition]:
+    """
+    Return partitions made of the given sets of CPUs, e.g. the CPUs sharing a last-level cache.
+
+    Args:
+        cpu_lists (Iterable[Iterable[int]]): the CPUs of each partition.
+
+    Raises:
+        ValueError: if a partition is empty or if two partitions share a CPU.
+
+    Returns:
+        List[RunPartition]: the partitions, in the given order.
+    """
+    result = []
+    seen_cpus = set()
+    for index, cpu_list in enumerate(cpu_lists):
+        cpus = tuple(cpu_list)
+        if not cpus or seen_cpus.intersection(cpus):
+            raise ValueError(f"Partitions must be non-empty and disjoint: {cpus}")
+        seen_cpus.update(cpus)
+        result.append(RunPartition(index=index, cpus=cpus))
+    return result
+
+
+def get_run_partitions(
+    platform: Platform,
+    spec: Optional[str | Iterable[Iterable[int]]],
+) -> List[RunPartition]:
+    """
+    Return the partitions described by the given specification.
+
+    Args:
+        platform (Platform): the platform to partition.
+        spec (Optional[str | Iterable[Iterable[int]]]):
+            "numa" for one partition per NUMA node, the CPUs of each partition, or None for no
+            partition (the runs are then sequential).
+
+    Raises:
+        ValueError: if the specification is not recognized.
+
+    Returns:
+        List[RunPartition]: the partitions, empty if spec is None.
+    """
+    match spec:
+        case None:
+            return []
+        case "numa":
+            return numa_partitions(platform=platform)
+        case str():
+            raise ValueError(f"Unknown partitioning of the platform: {spec}")
+        case _:
+            return cpu_partitions(cpu_lists=spec)
@@ -0,0 +1,78 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Hashed index of the records already stored in a result file, to look up whether a record has
+already been run when continuing a campaign.
+"""
+
+from typing import Dict, Iterable, List, Optional, Set, Tuple
+
+
+class RecordIndex:
+    """
+    Index of cached records (rows of a result CSV file, all values as strings).
+
+    A record to run matches a cached record when they have the same values on the columns of the
+    record that exist in the cached records; the other columns of the record (e.g. variables added
+    since the cached records were produced) are not compared. One hash table is built, in a single
+    pass over the cached records, for each distinct set of compared columns (usually a single one
+    per campaign), so that each lookup then takes a constant time.
+    """
+
+    def __init__(self, records: Iterable[Dict[str, str]]) -> None:
+        self._records: List[Dict[str, str]] = list(records)
+        self._columns: Set[str] = set().union(*self._records)
+        self._indexes: Dict[Tuple[str, ...], Dict[Tuple[str, ...], Dict[str, str]]] = {}
+
+    def __len__(self) -> int:
+        return len(self._records)
+
+    def contains(
+        self,
+        record: Dict[str, str],
+        columns: Iterable[str],
+    ) -> bool:
+        """
+        Return whether the index holds a record with the same values as the given record on the
+        given columns (the ones that do not exist in the cached records are ignored).
+
+        Args:
+            record (Dict[str, str]):
+                the record to look up, its values converted to strings as in the result file.
+            columns (Iterable[str]):
+                the columns identifying a record (e.g. its parameters and its run number).
+
+        Returns:
+            bool: whether the record is in the index.
+        """
+        return self.find(record=record, columns=columns) is not None
+
+    def find(
+        self,
+        record: Dict[str, str],
+        columns: Iterable[str],
+    ) -> Optional[Dict[str, str]]:
+        """
+        Return the first cached record with the same values as the given record on the given
+        columns (the ones that do not exist in the cached records are ignored), e.g. to read the
+        results of a run that has already been done.
+
+        Args:
+            record (Dict[str, str]):
+                the record to look up, its values converted to strings as in the result file.
+            columns (Iterable[str]):
+                the columns identifying a record (e.g. its parameters and its run number).
+
+        Returns:
+            Optional[Dict[str, str]]: the cached record, or None if there is none.
+        """
+        if not self._records:
+            return None
+        key_columns = tuple(sorted(c for c in set(columns) if c in self._columns and c in record))
+        index = self._indexes.get(key_columns)
+        if index is None:
+            index = {}
+            for cached_record in self._records:
+                index.setdefault(tuple(cached_record.get(c) for c in key_columns), cached_record)
+            self._indexes[key_columns] = index
+        return index.get(tuple(record[c] for c in key_columns))
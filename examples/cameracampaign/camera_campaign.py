@@ -3,7 +3,7 @@ from typing import Any, Dict, Iterable, List, Optional
 from benchkit.benchmark import Benchmark, CommandAttachment, PostRunHook, PreRunHook
 from benchkit.campaign import CampaignCartesianProduct
 from benchkit.commandwrappers import CommandWrapper
-from benchkit.commandwrappers.perf import PerfStatWrap
+from benchkit.commandwrappers.perf import PerfC2CWrap, PerfStatWrap
 from benchkit.commandwrappers.strace import StraceWrap
 from benchkit.communication.docker import DockerCommLayer
 from benchkit.platforms import Platform, get_remote_platform, get_current_platform
@@ -19,6 +19,7 @@ import re
 DOCKER = True
 REMOTE = False
 REMOTE_HOST = "kr260"
+PERF_C2C = False  # find the contended cache lines with perf c2c instead of counting with perf stat
 NB_RUNS = 3
 
 
@@ -48,34 +49,107 @@ class CameraOCCBench(Benchmark):
         self._src_dir = src_dir
         self._bench_src_path = pathlib.Path(src_dir)
 
-    def prebuild_bench(self, **kwargs):
+    def build_bench(  # pylint: disable=arguments-differ
+        self,
+        build_type: str = "Release",
+        march: str = "",
+        lto: bool = False,
+        pgo: bool = False,
+        pgo_replay_file: str = "",
+        pgo_training_seconds: int = 1,
+        **kwargs,
+    ) -> None:
+        """Build CameraProcessing with the given optimization profile.
+
+        With PGO, an instrumented build first replays pgo_replay_file as fast as possible with
+        every kernel and implementation supported by the target, then the benchmark is rebuilt
+        using the collected profiles.
+        """
         build_dir = (self._src_dir / "build").resolve()
         self.platform.comm.makedirs(path=build_dir, exist_ok=True)
 
-        cmake_command = ['cmake', str(self._src_dir), '-B', str(build_dir)]
+        cmake_command = [
+            "cmake",
+            str(self._src_dir),
+            "-B",
+            str(build_dir),
+            f"-DCMAKE_BUILD_TYPE={build_type}",
+            f"-DCAMERA_MARCH={march}",
+            f"-DCAMERA_LTO={'ON' if lto else 'OFF'}",
+        ]
+
+        if not pgo:
+            self._cmake_build(cmake_command=cmake_command + ["-DCAMERA_PGO=off"])
+            return
+
+        if not pgo_replay_file:
+            raise ValueError("PGO requires a recording to train on (pgo_replay_file)")
+        replay_path = pathlib.Path(pgo_replay_file).resolve()
+        pgo_dir = build_dir / "pgo"
+        if self.platform.comm.isdir(pgo_dir):
+            self.platform.comm.remove(path=pgo_dir, recursive=True)
+        self._cmake_build(
+            cmake_command=cmake_command + ["-DCAMERA_PGO=generate", f"-DCAMERA_PGO_DIR={pgo_dir}"]
+        )
+        for kernel in ["range", "threshold", "deproject", "decimate2", "decimate4"]:
+            for kernel_impl in ["scalar", "eigen", "sse", "avx2", "neon"]:
+                # implementations not supported by the target exit with an error right away
+                self.platform.comm.shell(
+                    command=[
+                        "./CameraProcessing",
+                        f"{pgo_training_seconds}",
+                        "--replay",
+                        f"{replay_path}",
+                        "--replay-rate",
+                        "max",
+                        "--kernel",
+                        kernel,
+                        "--impl",
+                        kernel_impl,
+                    ],
+                    current_dir=build_dir,
+                    print_output=False,
+                    ignore_ret_codes=(1,),
+                )
+        self._cmake_build(
+            cmake_command=cmake_command + ["-DCAMERA_PGO=use", f"-DCAMERA_PGO_DIR={pgo_dir}"]
+        )
+
+    def _cmake_build(self, cmake_command: List[str]) -> None:
+        build_dir = (self._src_dir / "build").resolve()
         print(f"Running CMake: {' '.join(cmake_command)}")
         self.platform.comm.shell(
             command=cmake_command,
             current_dir=build_dir,
             output_is_log=True,
         )
-        self.platform.comm.shell(command=cmake_command, current_dir=build_dir)
 
-        make_command = ['make']
+        make_command = ["make"]
         print(f"Running Make: {' '.join(make_command)}")
         self.platform.comm.shell(
             command=make_command,
             current_dir=build_dir,
             output_is_log=True,
         )
-        self.platform.comm.shell(command=make_command, current_dir=build_dir)
-
-    def build_bench(self, **kwargs) -> None:
-        pass
 
     def single_run(
         self,
         duration_seconds: int,
+        mode: str = "serial",
+        queue_depth: int = 8,
+        nb_workers: int = 1,
+        kernel: str = "range",
+        kernel_impl: str = "scalar",
+        intrinsics_lookup: str = "cached",
+        output_buffers: str = "pool",
+        replay_file: str = "",
+        replay_rate: str = "recorded",
+        width: int = 640,
+        height: int = 480,
+        fps: int = 90,
+        streams: str = "depth",
+        capture: str = "wait",
+        frame_queue_capacity: int = 1,
         **kwargs,
     ) -> str:
         environment = self._preload_env(
@@ -85,7 +159,34 @@ class CameraOCCBench(Benchmark):
         run_command = [
             "./CameraProcessing",
             f"{duration_seconds}",
+            "--mode",
+            f"{mode}",
+            "--kernel",
+            f"{kernel}",
+            "--impl",
+            f"{kernel_impl}",
+            "--intrinsics",
+            f"{intrinsics_lookup}",
+            "--buffers",
+            f"{output_buffers}",
+            "--width",
+            f"{width}",
+            "--height",
+            f"{height}",
+            "--fps",
+            f"{fps}",
+            "--streams",
+            f"{streams}",
+            "--capture",
+            f"{capture}",
         ]
+        if capture == "callback":
+            run_command.extend(["--frame-queue", f"{frame_queue_capacity}"])
+        if replay_file:
+            replay_path = pathlib.Path(replay_file).resolve()
+            run_command.extend(["--replay", f"{replay_path}", "--replay-rate", f"{replay_rate}"])
+        if mode == "pipeline":
+            run_command.extend(["--queue-depth", f"{queue_depth}", "--workers", f"{nb_workers}"])
         wrapped_run_command, wrapped_environment = self._wrap_command(
             run_command=run_command,
             environment=environment,
@@ -113,7 +214,7 @@ class CameraOCCBench(Benchmark):
         record_data_dir: PathType,
         **kwargs,
     ):
-        benchmark_duration_seconds = int(run_variables["benchmark duration seconds"])# TODO?
+        benchmark_duration_seconds = int(run_variables["duration_seconds"])
         match = re.search(r"Final counter value: (\d+)", command_output)
         if match:
             # Extract the number from the matched group and convert it to an integer
@@ -122,14 +223,79 @@ class CameraOCCBench(Benchmark):
             # Calculate the result by dividing the final counter value by the duration
             result_per_second = final_counter_value / benchmark_duration_seconds
             output = {"throughput": result_per_second}
+
+            # Pipeline mode: frames delivered by the camera and dropped because the queue was full
+            for key, pattern in [
+                ("captured_frames", r"Captured frames: (\d+)"),
+                ("queue_full_drops", r"Queue full drops: (\d+)"),
+                ("camera_dropped_frames", r"Camera dropped frames: (\d+)"),
+            ]:
+                match = re.search(pattern, command_output)
+                if match:
+                    output[key] = int(match.group(1))
+
+            # Callback capture: frames pushed into, taken out of and dropped from the frame queue
+            match = re.search(
+                r"Frame queue: enqueued=(\d+) processed=(\d+) dropped=(\d+)", command_output
+            )
+            if match:
+                output["frame_queue_enqueued"] = int(match.group(1))
+                output["frame_queue_processed"] = int(match.group(2))
+                output["frame_queue_dropped"] = int(match.group(3))
+
+            # Per-stage latency percentiles, e.g. "wait_for_frames_p99_ns"
+            for stage, p50, p99, pmax in re.findall(
+                r"Stage (\w+): p50_ns=(\d+) p99_ns=(\d+) max_ns=(\d+)", command_output
+            ):
+                output[f"{stage}_p50_ns"] = int(p50)
+                output[f"{stage}_p99_ns"] = int(p99)
+                output[f"{stage}_max_ns"] = int(pmax)
+
+            # Inter-frame interval from the camera hardware timestamps
+            float_pattern = r"([\d.e+-]+)"
+            match = re.search(
+                rf"Interframe: mean_us={float_pattern} jitter_us={float_pattern}", command_output
+            )
+            if match:
+                output["interframe_mean_us"] = float(match.group(1))
+                output["interframe_jitter_us"] = float(match.group(2))
+
+            # Frames received and achieved frame rate per captured stream, e.g. "color_fps"
+            for stream, frames, fps in re.findall(
+                rf"Stream (\w+): frames=(\d+) fps={float_pattern}", command_output
+            ):
+                output[f"{stream}_frames"] = int(frames)
+                output[f"{stream}_fps"] = float(fps)
             return output
 
     def get_build_var_names(self) -> List[str]:
-        return []
+        return [
+            "build_type",
+            "march",
+            "lto",
+            "pgo",
+            "pgo_replay_file",
+            "pgo_training_seconds",
+        ]
 
     def get_run_var_names(self) -> List[str]:
         return [
             "duration_seconds",
+            "mode",
+            "queue_depth",
+            "nb_workers",
+            "kernel",
+            "kernel_impl",
+            "intrinsics_lookup",
+            "output_buffers",
+            "replay_file",
+            "replay_rate",
+            "width",
+            "height",
+            "fps",
+            "streams",
+            "capture",
+            "frame_queue_capacity",
         ]
 
     @property
@@ -195,6 +361,7 @@ def get_docker_platform(
 
 def main() -> None:
     command_wrappers = []
+    post_run_hooks = []
 
     if REMOTE:
         bench_src_path = caller_dir()  # TODO
@@ -216,8 +383,13 @@ def main() -> None:
         extend_wrappers = True
 
     if extend_wrappers:
-        events = ['branch-misses', 'cache-misses', 'cpu-cycles']
-        command_wrappers.append(PerfStatWrap(events=events))
+        if PERF_C2C:
+            perf_c2c_wrapper = PerfC2CWrap(all_user=True)
+            command_wrappers.append(perf_c2c_wrapper)
+            post_run_hooks.append(perf_c2c_wrapper.post_run_hook_update_results)
+        else:
+            events = ['branch-misses', 'cache-misses', 'cpu-cycles']
+            command_wrappers.append(PerfStatWrap(events=events))
         command_wrappers.append(StraceWrap())
 
     campaign = CampaignCartesianProduct(
@@ -225,6 +397,7 @@ def main() -> None:
         benchmark=CameraOCCBench(
             src_dir=bench_src_path,
             command_wrappers=command_wrappers,
+            post_run_hooks=post_run_hooks,
             platform=platform,
         ),
         nb_runs=NB_RUNS,
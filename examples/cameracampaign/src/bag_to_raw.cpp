@@ -0,0 +1,63 @@
+#include <librealsense2/rs.hpp>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "raw_recording.hpp"
+using namespace std;
+
+// Converts the depth stream of a rosbag recording into a raw Z16 recording, which
+// CameraProcessing can replay from memory without going through the librealsense playback.
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        cerr << "Usage: " << argv[0] << " <input.bag> <output.z16>" << endl;
+        return 1;
+    }
+
+    try {
+        rs2::pipeline pipe;
+        rs2::config cfg;
+        cfg.enable_device_from_file(argv[1], false);
+        cfg.enable_stream(RS2_STREAM_DEPTH);
+        rs2::pipeline_profile pipeline_profile = pipe.start(cfg);
+        // read the recording as fast as the conversion goes, without dropping frames
+        pipeline_profile.get_device().as<rs2::playback>().set_real_time(false);
+
+        const rs2::video_stream_profile depth_stream =
+            pipeline_profile.get_stream(RS2_STREAM_DEPTH).as<rs2::video_stream_profile>();
+        const rs2_intrinsics intrinsics = depth_stream.get_intrinsics();
+        RawRecordingHeader header = {};
+        header.width = (uint32_t)intrinsics.width;
+        header.height = (uint32_t)intrinsics.height;
+        header.fps = (uint32_t)depth_stream.fps();
+        header.fx = intrinsics.fx;
+        header.fy = intrinsics.fy;
+        header.ppx = intrinsics.ppx;
+        header.ppy = intrinsics.ppy;
+        header.depth_units =
+            pipeline_profile.get_device().first<rs2::depth_sensor>().get_depth_scale();
+
+        RawRecordingWriter writer(argv[2], header);
+        int nb_frames = 0;
+        rs2::frameset frames;
+        // the playback stops delivering frames at the end of the recording
+        while (pipe.try_wait_for_frames(&frames, 1000)) {
+            rs2::depth_frame depth_frame = frames.get_depth_frame();
+            if (!depth_frame) {
+                continue;
+            }
+            writer.write_frame(depth_frame.get_frame_number(), depth_frame.get_timestamp(),
+                               (const uint16_t*)depth_frame.get_data(),
+                               depth_frame.get_stride_in_bytes() / (int)sizeof(uint16_t));
+            nb_frames++;
+        }
+        writer.close();
+        pipe.stop();
+
+        cout << "Converted frames: " << nb_frames << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
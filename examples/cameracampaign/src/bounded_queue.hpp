@@ -0,0 +1,96 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free multi-producer multi-consumer queue (D. Vyukov's algorithm).
+// Each slot carries a sequence number telling whether it is ready to be written (sequence equal
+// to the enqueue position) or read (sequence equal to the dequeue position + 1), so producers and
+// consumers only contend on their own position counter.
+// The elements are moved in and out of the slots: queueing an rs2::frame only moves its reference
+// to the librealsense buffer, the frame data itself is never copied.
+template <typename T>
+class BoundedQueue {
+public:
+    // The capacity is rounded up to the next power of two.
+    explicit BoundedQueue(size_t capacity)
+        : _mask(round_up_pow2(capacity) - 1), _slots(_mask + 1), _enqueue_pos(0), _dequeue_pos(0) {
+        for (size_t i = 0; i <= _mask; ++i) {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    size_t capacity() const { return _mask + 1; }
+
+    // Returns false (and leaves value untouched) if the queue is full.
+    bool try_push(T& value) {
+        size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = _slots[pos & _mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = (std::ptrdiff_t)sequence - (std::ptrdiff_t)pos;
+            if (diff == 0) {
+                if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Returns false if the queue is empty.
+    bool try_pop(T& value) {
+        size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = _slots[pos & _mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = (std::ptrdiff_t)sequence - (std::ptrdiff_t)(pos + 1);
+            if (diff == 0) {
+                if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = std::move(slot.value);
+                    slot.value = T();
+                    slot.sequence.store(pos + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t cache_line_size = 64;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t round_up_pow2(size_t n) {
+        size_t result = 1;
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t _mask;
+    std::vector<Slot> _slots;
+    alignas(cache_line_size) std::atomic<size_t> _enqueue_pos;
+    alignas(cache_line_size) std::atomic<size_t> _dequeue_pos;
+};
+
+#endif  // BOUNDED_QUEUE_HPP
@@ -0,0 +1,42 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "bounded_queue.hpp"
+
+// Fixed set of preallocated buffers shared by the processing threads.
+// The free buffers are kept in a lock-free queue, so acquiring and releasing a buffer never
+// allocates nor takes a lock.
+template <typename T>
+class BufferPool {
+public:
+    // init is called once on each buffer, e.g. to size it.
+    template <typename Init>
+    BufferPool(size_t nb_buffers, Init init) : _buffers(nb_buffers), _free(nb_buffers) {
+        for (T& buffer : _buffers) {
+            init(buffer);
+            T* free_buffer = &buffer;
+            _free.try_push(free_buffer);
+        }
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Returns nullptr if all the buffers are in use.
+    T* acquire() {
+        T* buffer = nullptr;
+        _free.try_pop(buffer);
+        return buffer;
+    }
+
+    void release(T* buffer) { _free.try_push(buffer); }
+
+private:
+    std::vector<T> _buffers;
+    BoundedQueue<T*> _free;
+};
+
+#endif  // BUFFER_POOL_HPP
@@ -2,48 +2,839 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
 #include <Eigen/Core>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <getopt.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "buffer_pool.hpp"
+#include "depth_kernels.hpp"
+#include "frame_stats.hpp"
+#include "raw_recording.hpp"
 using namespace std;
 
-int main(int argc, char** argv) {
-    
-    if (argc != 2) {
-        cerr << "Usage: " << argv[0] << " <duration_in_seconds>" << endl;
-        return 1;
+// Streams captured by the pipeline; the depth stream is always captured.
+enum StreamKind {
+    stream_depth,
+    stream_color,
+    stream_infrared,
+    stream_aligned,  // depth aligned to the color stream, processed instead of the raw depth
+    nb_stream_kinds,
+};
+
+static const char* const stream_names[nb_stream_kinds] = {
+    "depth",
+    "color",
+    "infrared",
+    "aligned",
+};
+
+struct Options {
+    int duration_seconds = 0;
+    int width = 640;  // resolution and frame rate of the video streams
+    int height = 480;
+    int fps = 90;
+    unsigned streams = 1u << stream_depth;  // bit set of the captured StreamKind
+    string mode = "serial";  // "serial" or "pipeline"
+    size_t queue_depth = 8;  // pipeline mode: capacity of the capture -> workers queue
+    size_t nb_workers = 1;   // pipeline mode: number of processing threads
+    DepthKernel kernel = DepthKernel::range;
+    KernelImpl impl = KernelImpl::scalar;
+    bool cache_intrinsics = true;  // look the intrinsics up only when the stream profile changes
+    bool pool_buffers = true;      // take the kernel outputs from a preallocated pool
+    string replay_file;            // recording replayed instead of the camera (.bag or raw Z16)
+    bool replay_recorded_rate = true;  // replay at the recorded rate, or as fast as possible
+    bool capture_callback = false;  // frames pushed by a callback into a frame queue, or waited for
+    unsigned frame_queue_capacity = 1;  // callback capture: frame queue capacity (rs2 default)
+};
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " <duration_in_seconds>"
+         << " [--mode serial|pipeline] [--queue-depth <n>] [--workers <n>]"
+         << " [--kernel range|threshold|deproject|decimate2|decimate4]"
+         << " [--impl scalar|eigen|sse|avx2|neon]"
+         << " [--intrinsics frame|cached] [--buffers alloc|pool]"
+         << " [--replay <file.bag|file.z16>] [--replay-rate recorded|max]"
+         << " [--width <n>] [--height <n>] [--fps <n>]"
+         << " [--streams depth[,color][,infrared][,aligned]]"
+         << " [--capture wait|callback] [--frame-queue <n>]" << endl;
+}
+
+static bool has_stream(const Options& options, StreamKind kind) {
+    return (options.streams & (1u << kind)) != 0;
+}
+
+// Parses a comma-separated list of stream names.
+static bool parse_streams(const string& list, unsigned& streams) {
+    streams = 1u << stream_depth;
+    size_t start = 0;
+    while (start <= list.size()) {
+        const size_t end = min(list.find(',', start), list.size());
+        const string name = list.substr(start, end - start);
+        int kind = 0;
+        while (kind < nb_stream_kinds && name != stream_names[kind]) {
+            kind++;
+        }
+        if (kind == nb_stream_kinds) {
+            return false;
+        }
+        streams |= 1u << kind;
+        start = end + 1;
+    }
+    // the alignment needs the color stream
+    if ((streams & (1u << stream_aligned)) != 0) {
+        streams |= 1u << stream_color;
+    }
+    return true;
+}
+
+static bool parse_options(int argc, char** argv, Options& options) {
+    static const struct option long_options[] = {
+        {"mode", required_argument, nullptr, 'm'},
+        {"queue-depth", required_argument, nullptr, 'q'},
+        {"workers", required_argument, nullptr, 'w'},
+        {"kernel", required_argument, nullptr, 'k'},
+        {"impl", required_argument, nullptr, 'i'},
+        {"intrinsics", required_argument, nullptr, 'n'},
+        {"buffers", required_argument, nullptr, 'b'},
+        {"replay", required_argument, nullptr, 'f'},
+        {"replay-rate", required_argument, nullptr, 'r'},
+        {"width", required_argument, nullptr, 'W'},
+        {"height", required_argument, nullptr, 'H'},
+        {"fps", required_argument, nullptr, 'F'},
+        {"streams", required_argument, nullptr, 's'},
+        {"capture", required_argument, nullptr, 'c'},
+        {"frame-queue", required_argument, nullptr, 'Q'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    int opt;
+    string intrinsics = "cached";
+    string buffers = "pool";
+    string replay_rate = "recorded";
+    string capture = "wait";
+    const char* short_options = "m:q:w:k:i:n:b:f:r:W:H:F:s:c:Q:";
+    while ((opt = getopt_long(argc, argv, short_options, long_options, nullptr)) != -1) {
+        switch (opt) {
+        case 'm':
+            options.mode = optarg;
+            break;
+        case 'q':
+            options.queue_depth = stoul(optarg);
+            break;
+        case 'w':
+            options.nb_workers = stoul(optarg);
+            break;
+        case 'k':
+            if (!parse_depth_kernel(optarg, options.kernel)) {
+                cerr << "Unknown kernel: " << optarg << endl;
+                return false;
+            }
+            break;
+        case 'i':
+            if (!parse_kernel_impl(optarg, options.impl)) {
+                cerr << "Unknown kernel implementation: " << optarg << endl;
+                return false;
+            }
+            break;
+        case 'n':
+            intrinsics = optarg;
+            break;
+        case 'b':
+            buffers = optarg;
+            break;
+        case 'f':
+            options.replay_file = optarg;
+            break;
+        case 'r':
+            replay_rate = optarg;
+            break;
+        case 'W':
+            options.width = stoi(optarg);
+            break;
+        case 'H':
+            options.height = stoi(optarg);
+            break;
+        case 'F':
+            options.fps = stoi(optarg);
+            break;
+        case 's':
+            if (!parse_streams(optarg, options.streams)) {
+                cerr << "Unknown stream in: " << optarg << endl;
+                return false;
+            }
+            break;
+        case 'c':
+            capture = optarg;
+            break;
+        case 'Q':
+            options.frame_queue_capacity = stoul(optarg);
+            break;
+        default:
+            return false;
+        }
+    }
+    if (optind != argc - 1) {
+        return false;
+    }
+    options.duration_seconds = stoi(argv[optind]);
+    if (!kernel_impl_supported(options.impl)) {
+        cerr << "Kernel implementation not supported on this CPU" << endl;
+        return false;
+    }
+
+    options.cache_intrinsics = intrinsics == "cached";
+    options.pool_buffers = buffers == "pool";
+    options.replay_recorded_rate = replay_rate == "recorded";
+    options.capture_callback = capture == "callback";
+
+    return (options.mode == "serial" || options.mode == "pipeline") && options.queue_depth > 0 &&
+           options.nb_workers > 0 && options.width > 0 && options.height > 0 && options.fps > 0 &&
+           (intrinsics == "frame" || intrinsics == "cached") &&
+           (buffers == "alloc" || buffers == "pool") &&
+           (replay_rate == "recorded" || replay_rate == "max") &&
+           (capture == "wait" || capture == "callback") && options.frame_queue_capacity > 0;
+}
+
+// Frame rate assumed to size the statistics when replaying as fast as possible.
+static const int max_replay_fps = 10000;
+
+// Statistics of the thread(s) processing the frames.
+struct ProcessingStats {
+    explicit ProcessingStats(size_t capacity)
+        : lookup("lookup", capacity),
+          wrap("wrap", capacity),
+          buffer("buffer", capacity),
+          process("process", capacity) {}
+
+    StageLatency lookup;   // profile and intrinsics lookup
+    StageLatency wrap;     // cv::Mat wrapping of the depth buffer
+    StageLatency buffer;   // acquisition of the output buffer
+    StageLatency process;  // processing stage
+    int processed = 0;
+    uint64_t checksum = 0;
+};
+
+// Statistics of the capturing thread.
+struct CaptureStats {
+    explicit CaptureStats(size_t capacity)
+        : wait("wait_for_frames", capacity), timeline(capacity) {}
+
+    StageLatency wait;
+    FrameTimeline timeline;
+};
+
+// Intrinsics and depth units of the depth stream, with the profile they were looked up for.
+struct IntrinsicsCache {
+    int profile_id = -1;
+    DepthIntrinsics intrinsics = {};
+};
+
+// Depth stream delivered by a frame source.
+struct DepthStream {
+    int width = 0;
+    int height = 0;
+    int fps = 0;
+    IntrinsicsCache intrinsics;
+};
+
+// Depth frame handed over to the processing.
+struct DepthFrame {
+    rs2::frame frame;  // librealsense frame owning the buffer, empty for raw recordings
+    DepthView depth = {};
+    unsigned long long frame_number = 0;
+    double timestamp_ms = 0.0;
+};
+
+// Number of samples to preallocate for a run, with one second of margin.
+static size_t max_frames(const Options& options, const DepthStream& stream) {
+    const bool max_rate = !options.replay_file.empty() && !options.replay_recorded_rate;
+    return (size_t)(options.duration_seconds + 1) * (max_rate ? max_replay_fps : stream.fps);
+}
+
+static DepthIntrinsics to_depth_intrinsics(const rs2_intrinsics& intrinsics, float depth_units) {
+    return {intrinsics.fx, intrinsics.fy, intrinsics.ppx, intrinsics.ppy, depth_units};
+}
+
+// Cache filled once after the pipeline starts, from the active profile of the processed stream.
+static IntrinsicsCache make_intrinsics_cache(const rs2::pipeline_profile& pipeline_profile,
+                                             rs2_stream stream) {
+    const rs2::video_stream_profile depth_stream =
+        pipeline_profile.get_stream(stream).as<rs2::video_stream_profile>();
+    const float depth_units =
+        pipeline_profile.get_device().first<rs2::depth_sensor>().get_depth_scale();
+
+    IntrinsicsCache cache;
+    cache.profile_id = depth_stream.unique_id();
+    cache.intrinsics = to_depth_intrinsics(depth_stream.get_intrinsics(), depth_units);
+    return cache;
+}
+
+// State of one processing thread.
+struct ProcessingContext {
+    const Options& options;
+    DepthProcessor processor;
+    IntrinsicsCache intrinsics;
+    BufferPool<DepthOutput>& buffers;
+    ProcessingStats& stats;
+};
+
+// Source of the depth frames.
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    const DepthStream& stream() const { return _stream; }
+
+    // Blocks until the next frame is delivered; returns false if it holds no depth frame.
+    virtual bool wait_for_frame(DepthFrame& frame) = 0;
+
+    // Stops delivering frames, at the end of the capture.
+    virtual void stop() {}
+
+    // Prints "Stream <name>: frames=<n> fps=<v>" for each captured stream, fps being the achieved
+    // frame rate over the given capture duration.
+    virtual void print_streams(ostream& os, double elapsed_seconds) {
+        for (int kind = 0; kind < nb_stream_kinds; ++kind) {
+            if (captures((StreamKind)kind)) {
+                const double fps = elapsed_seconds > 0.0 ? _frames[kind] / elapsed_seconds : 0.0;
+                os << "Stream " << stream_names[kind] << ": frames=" << _frames[kind]
+                   << " fps=" << fps << endl;
+            }
+        }
+    }
+
+protected:
+    bool captures(StreamKind kind) const { return (_streams & (1u << kind)) != 0; }
+
+    DepthStream _stream;
+    unsigned _streams = 1u << stream_depth;
+    uint64_t _frames[nb_stream_kinds] = {};  // frames received per stream
+};
+
+// Live camera, or rosbag recording played in a loop by the librealsense playback device.
+// All the video streams share the resolution and frame rate of the options; recordings are played
+// with their own.
+// With callback capture, librealsense pushes the frames from its own thread into a frame queue, so
+// that slow processing shows up as frames dropped from that queue (the oldest one is dropped when
+// it is full) instead of being hidden in the blocking wait.
+class PipelineSource : public FrameSource {
+public:
+    explicit PipelineSource(const Options& options)
+        : _align(RS2_STREAM_COLOR),
+          _callback(options.capture_callback),
+          _queue(options.frame_queue_capacity) {
+        _streams = options.streams;
+        const bool live = options.replay_file.empty();
+        const int width = options.width;
+        const int height = options.height;
+        const int fps = options.fps;
+
+        rs2::config cfg;
+        if (!live) {
+            cfg.enable_device_from_file(options.replay_file, true);
+        }
+        if (live) {
+            cfg.enable_stream(RS2_STREAM_DEPTH, width, height, RS2_FORMAT_Z16, fps);
+        } else {
+            cfg.enable_stream(RS2_STREAM_DEPTH);
+        }
+        if (has_stream(options, stream_color)) {
+            if (live) {
+                cfg.enable_stream(RS2_STREAM_COLOR, width, height, RS2_FORMAT_RGB8, fps);
+            } else {
+                cfg.enable_stream(RS2_STREAM_COLOR);
+            }
+        }
+        if (has_stream(options, stream_infrared)) {
+            if (live) {
+                cfg.enable_stream(RS2_STREAM_INFRARED, 1, width, height, RS2_FORMAT_Y8, fps);
+            } else {
+                cfg.enable_stream(RS2_STREAM_INFRARED);
+            }
+        }
+        rs2::pipeline_profile pipeline_profile;
+        if (_callback) {
+            pipeline_profile = _pipe.start(cfg, [this](const rs2::frame& frame) {
+                _enqueued.fetch_add(1, memory_order_relaxed);
+                _queue.enqueue(frame);
+            });
+        } else {
+            pipeline_profile = _pipe.start(cfg);
+        }
+        _running = true;
+        if (!live) {
+            // out of real time, the playback delivers each frame once the previous one is read
+            pipeline_profile.get_device().as<rs2::playback>().set_real_time(
+                options.replay_recorded_rate);
+        }
+
+        // the aligned depth has the geometry of the color stream
+        const rs2_stream processed_stream =
+            has_stream(options, stream_aligned) ? RS2_STREAM_COLOR : RS2_STREAM_DEPTH;
+        const rs2::video_stream_profile processed_profile =
+            pipeline_profile.get_stream(processed_stream).as<rs2::video_stream_profile>();
+        _stream.width = processed_profile.width();
+        _stream.height = processed_profile.height();
+        _stream.fps = processed_profile.fps();
+        _stream.intrinsics = make_intrinsics_cache(pipeline_profile, processed_stream);
+        if (captures(stream_aligned)) {
+            _align_latency.reset(new StageLatency("align", max_frames(options, _stream)));
+        }
+    }
+
+    ~PipelineSource() override { stop(); }
+
+    bool wait_for_frame(DepthFrame& frame) override {
+        rs2::frameset frames;
+        if (_callback) {
+            rs2::frame queued = _queue.wait_for_frame();
+            _dequeued++;
+            if (!queued.is<rs2::frameset>()) {
+                // with the depth stream alone, the callback receives single frames
+                count_frame(stream_depth, queued);
+                return to_depth_frame(queued.as<rs2::depth_frame>(), frame);
+            }
+            frames = queued.as<rs2::frameset>();
+        } else {
+            frames = _pipe.wait_for_frames();
+        }
+        count_frame(stream_depth, frames.get_depth_frame());
+        if (captures(stream_color)) {
+            count_frame(stream_color, frames.get_color_frame());
+        }
+        if (captures(stream_infrared)) {
+            count_frame(stream_infrared, frames.get_infrared_frame());
+        }
+        if (captures(stream_aligned)) {
+            const uint64_t align_start = now_ns();
+            frames = _align.process(frames);
+            _align_latency->record(now_ns() - align_start);
+            count_frame(stream_aligned, frames.get_depth_frame());
+        }
+
+        return to_depth_frame(frames.get_depth_frame(), frame);
+    }
+
+    // Also drains the frame queue, to tell the frames dropped from those left unprocessed.
+    void stop() override {
+        if (!_running) {
+            return;
+        }
+        _pipe.stop();
+        _running = false;
+        rs2::frame queued;
+        while (_callback && _queue.poll_for_frame(&queued)) {
+            _left_in_queue++;
+        }
+    }
+
+    // Also prints the alignment as the "align" stage, when the depth is aligned.
+    void print_streams(ostream& os, double elapsed_seconds) override {
+        FrameSource::print_streams(os, elapsed_seconds);
+        if (_align_latency) {
+            _align_latency->print(os);
+        }
+        if (_callback) {
+            const uint64_t enqueued = _enqueued.load();
+            os << "Frame queue: enqueued=" << enqueued << " processed=" << _dequeued
+               << " dropped=" << enqueued - _dequeued - _left_in_queue << endl;
+        }
+    }
+
+private:
+    static bool to_depth_frame(const rs2::depth_frame& depth_frame, DepthFrame& frame) {
+        if (!depth_frame) {
+            return false;
+        }
+        frame.depth = {(const uint16_t*)depth_frame.get_data(), depth_frame.get_width(),
+                       depth_frame.get_height(),
+                       depth_frame.get_stride_in_bytes() / (int)sizeof(uint16_t)};
+        frame.frame_number = depth_frame.get_frame_number();
+        frame.timestamp_ms = depth_frame.get_timestamp();
+        frame.frame = depth_frame;
+        return true;
     }
-    int duration_seconds = stoi(argv[1]);
 
+    void count_frame(StreamKind kind, const rs2::frame& frame) {
+        if (frame) {
+            _frames[kind]++;
+        }
+    }
+
+    rs2::pipeline _pipe;
+    rs2::align _align;
+    unique_ptr<StageLatency> _align_latency;  // time spent aligning the depth to the color
+    bool _running = false;
+
+    // callback capture
+    bool _callback;
+    rs2::frame_queue _queue;
+    atomic<uint64_t> _enqueued{0};  // frames pushed by the callback
+    uint64_t _dequeued = 0;         // frames taken out of the queue for processing
+    uint64_t _left_in_queue = 0;    // frames still queued when the capture stopped
+};
+
+// Raw Z16 recording played in a loop straight from its memory mapping, either paced by the
+// recorded timestamps or as fast as the frames are consumed.
+class RawReplaySource : public FrameSource {
+public:
+    explicit RawReplaySource(const Options& options)
+        : _recording(options.replay_file), _recorded_rate(options.replay_recorded_rate) {
+        if (options.streams != 1u << stream_depth) {
+            throw runtime_error("Raw recordings only hold the depth stream");
+        }
+        if (options.capture_callback) {
+            throw runtime_error("Raw recordings are not replayed through librealsense callbacks");
+        }
+        const RawRecordingHeader& header = _recording.header();
+        _stream.width = (int)header.width;
+        _stream.height = (int)header.height;
+        _stream.fps = (int)header.fps;
+        _stream.intrinsics.intrinsics = {header.fx, header.fy, header.ppx, header.ppy,
+                                         header.depth_units};
+
+        // one pass over the recording lasts until the end of its last frame
+        _first_timestamp_ms = _recording.frame_header(0).timestamp_ms;
+        const double last_timestamp_ms =
+            _recording.frame_header(_recording.nb_frames() - 1).timestamp_ms;
+        _loop_ms = last_timestamp_ms - _first_timestamp_ms +
+                   (header.fps > 0 ? 1000.0 / header.fps : 0.0);
+    }
+
+    bool wait_for_frame(DepthFrame& frame) override {
+        if (_next == _recording.nb_frames()) {
+            _next = 0;
+            _nb_loops++;
+        }
+        const RawFrameHeader& header = _recording.frame_header(_next);
+        if (_recorded_rate) {
+            if (_start_ns == 0) {
+                _start_ns = now_ns();
+            }
+            const double offset_ms =
+                header.timestamp_ms - _first_timestamp_ms + (double)_nb_loops * _loop_ms;
+            const uint64_t due_ns = _start_ns + (uint64_t)(std::max(offset_ms, 0.0) * 1e6);
+            const uint64_t now = now_ns();
+            if (due_ns > now) {
+                this_thread::sleep_for(chrono::nanoseconds(due_ns - now));
+            }
+        }
+
+        frame.frame = rs2::frame();
+        frame.depth = {_recording.frame_data(_next), _stream.width, _stream.height, _stream.width};
+        frame.frame_number = header.frame_number;
+        frame.timestamp_ms = header.timestamp_ms;
+        _frames[stream_depth]++;
+        _next++;
+        return true;
+    }
+
+private:
+    RawRecording _recording;
+    bool _recorded_rate;
+    double _first_timestamp_ms = 0.0;
+    double _loop_ms = 0.0;
+    size_t _next = 0;
+    uint64_t _nb_loops = 0;
+    uint64_t _start_ns = 0;  // time at which the replay started, set on the first frame
+};
+
+// Rosbag recordings go through the librealsense playback, other files are raw Z16 recordings.
+static unique_ptr<FrameSource> make_frame_source(const Options& options) {
+    const string& file = options.replay_file;
+    const string bag_extension = ".bag";
+    if (file.empty() || (file.size() >= bag_extension.size() &&
+                         file.compare(file.size() - bag_extension.size(), string::npos,
+                                      bag_extension) == 0)) {
+        return unique_ptr<FrameSource>(new PipelineSource(options));
+    }
+    return unique_ptr<FrameSource>(new RawReplaySource(options));
+}
+
+// Pool of kernel outputs shared by the processing threads, one buffer per thread.
+static BufferPool<DepthOutput> make_buffer_pool(const Options& options, const DepthStream& stream,
+                                                size_t nb_threads) {
+    const DepthProcessor processor(options.kernel, options.impl, stream.width, stream.height);
+    const size_t nb_buffers = options.pool_buffers ? nb_threads : 0;
+    return BufferPool<DepthOutput>(nb_buffers, [&processor](DepthOutput& output) {
+        processor.allocate_output(output);
+    });
+}
+
+// Without cache, each frame queries its profile and the intrinsics through the librealsense C
+// API (allocating the profile wrappers); with the cache, this only happens when the profile of
+// the frame differs from the cached one.
+static const DepthIntrinsics& lookup_intrinsics(const DepthFrame& frame,
+                                                ProcessingContext& context) {
+    IntrinsicsCache& cache = context.intrinsics;
+    if (!frame.frame) {
+        // raw recordings have a single profile, whose intrinsics come with the recording
+        return cache.intrinsics;
+    }
+    rs2::stream_profile depth_stream = frame.frame.get_profile();
+    if (context.options.cache_intrinsics && depth_stream.unique_id() == cache.profile_id) {
+        return cache.intrinsics;
+    }
+
+    rs2_intrinsics intrinsics = depth_stream.as<rs2::video_stream_profile>().get_intrinsics();
+    cache.profile_id = depth_stream.unique_id();
+    const float depth_units = frame.frame.as<rs2::depth_frame>().get_units();
+    cache.intrinsics = to_depth_intrinsics(intrinsics, depth_units);
+    return cache.intrinsics;
+}
+
+static void record_capture(const DepthFrame& frame, uint64_t wait_ns, CaptureStats& stats) {
+    stats.wait.record(wait_ns);
+    stats.timeline.record(frame.frame_number, frame.timestamp_ms);
+}
+
+// Processing of one frame: intrinsics lookup, cv::Mat wrap of the depth buffer (no copy), output
+// buffer acquisition and processing stage running the selected kernel (range: value range of the
+// image with OpenCV).
+static void process_frame(const DepthFrame& frame, ProcessingContext& context) {
+    const Options& options = context.options;
+    ProcessingStats& stats = context.stats;
+
+    const uint64_t lookup_start = now_ns();
+    const DepthIntrinsics& depth_intrinsics = lookup_intrinsics(frame, context);
+
+    const uint64_t wrap_start = now_ns();
+    const DepthView& depth = frame.depth;
+    cv::Mat current_image_depth(cv::Size(depth.width, depth.height), CV_16U, (void*)depth.data,
+                                (size_t)depth.stride * sizeof(uint16_t));
+
+    const uint64_t buffer_start = now_ns();
+    DepthOutput* output = options.pool_buffers ? context.buffers.acquire() : nullptr;
+    DepthOutput frame_output;
+    if (output == nullptr) {
+        context.processor.allocate_output(frame_output);
+        output = &frame_output;
+    }
+
+    const uint64_t process_start = now_ns();
+    uint64_t checksum;
+    if (options.kernel == DepthKernel::range) {
+        double min_depth = 0.0;
+        double max_depth = 0.0;
+        cv::minMaxIdx(current_image_depth, &min_depth, &max_depth);
+        checksum = (uint64_t)max_depth - (uint64_t)min_depth;
+    } else {
+        checksum = context.processor.run(depth, depth_intrinsics, *output);
+    }
+    const uint64_t process_end = now_ns();
+
+    if (output != &frame_output) {
+        context.buffers.release(output);
+    }
+
+    stats.lookup.record(wrap_start - lookup_start);
+    stats.wrap.record(buffer_start - wrap_start);
+    stats.buffer.record(process_start - buffer_start);
+    stats.process.record(process_end - process_start);
+    stats.checksum += checksum;
+    stats.processed++;
+}
+
+static void print_results(CaptureStats& capture_stats, ProcessingStats& processing_stats) {
+    cout << "Final counter value: " << processing_stats.processed << endl;
+    capture_stats.wait.print(cout);
+    processing_stats.lookup.print(cout);
+    processing_stats.wrap.print(cout);
+    processing_stats.buffer.print(cout);
+    processing_stats.process.print(cout);
+    capture_stats.timeline.print(cout);
+    cout << "Checksum: " << processing_stats.checksum << endl;
+}
+
+// Capture and process each frame in turn, on the calling thread.
+static int run_serial(FrameSource& source, const Options& options) {
     using namespace std::chrono;
-    
-    rs2::pipeline pipe;
-    rs2::config cfg;
-    cfg.enable_stream(RS2_STREAM_DEPTH, 640, 480, RS2_FORMAT_Z16, 90);
-    pipe.start(cfg);
-    
-    auto start_time = high_resolution_clock::now();
-    auto end_time = start_time + seconds(duration_seconds);
 
-    int frame_count = 0;
+    const DepthStream& stream = source.stream();
+    CaptureStats capture_stats(max_frames(options, stream));
+    ProcessingStats processing_stats(max_frames(options, stream));
+    BufferPool<DepthOutput> buffers = make_buffer_pool(options, stream, 1);
+    ProcessingContext context = {
+        options,
+        DepthProcessor(options.kernel, options.impl, stream.width, stream.height),
+        stream.intrinsics,
+        buffers,
+        processing_stats,
+    };
+
+    auto start_time = high_resolution_clock::now();
+    auto end_time = start_time + seconds(options.duration_seconds);
 
     while (high_resolution_clock::now() < end_time) {
-        auto start = std::chrono::high_resolution_clock::now();
-        rs2::frameset frames = pipe.wait_for_frames();
-        rs2::depth_frame depth_frame = frames.get_depth_frame();
-        if (!depth_frame) {
+        const uint64_t wait_start = now_ns();
+        DepthFrame frame;
+        const bool captured = source.wait_for_frame(frame);
+        const uint64_t wait_end = now_ns();
+        if (!captured) {
             cerr << "Error retrieving frames!" << endl;
             continue;
         }
+        record_capture(frame, wait_end - wait_start, capture_stats);
+
+        process_frame(frame, context);
+    }
+
+    const double elapsed_seconds =
+        duration<double>(high_resolution_clock::now() - start_time).count();
+    source.stop();
+
+    print_results(capture_stats, processing_stats);
+    source.print_streams(cout, elapsed_seconds);
+    return 0;
+}
+
+// Capture on the calling thread and hand the frames over to a pool of processing threads.
+// Only the frame references travel through the queue: the librealsense buffers stay alive until
+// the worker releases them, and are never copied. When the queue is full, the captured frame is
+// dropped (and its buffer returned to librealsense) rather than stalling the capture, except when
+// replaying as fast as possible: the capture then waits for the workers, to measure the
+// processing throughput.
+static int run_pipeline(FrameSource& source, const Options& options) {
+    using namespace std::chrono;
 
-        rs2::stream_profile depth_stream = depth_frame.get_profile();
-        rs2_intrinsics intrinsics = depth_stream.as<rs2::video_stream_profile>().get_intrinsics();
+    struct QueuedFrame {
+        DepthFrame frame;
+        uint64_t enqueue_ns = 0;
+    };
 
-        cv::Mat current_image_depth(cv::Size(depth_frame.get_width(), depth_frame.get_height()), CV_16U, (void*)depth_frame.get_data(), cv::Mat::AUTO_STEP);
+    struct alignas(64) WorkerStats {
+        explicit WorkerStats(size_t capacity) : processing(capacity), queue("queue", capacity) {}
 
-        frame_count++;
+        ProcessingStats processing;
+        StageLatency queue;  // time spent in the queue
+    };
+
+    BoundedQueue<QueuedFrame> queue(options.queue_depth);
+    const DepthStream& stream = source.stream();
+    BufferPool<DepthOutput> buffers = make_buffer_pool(options, stream, options.nb_workers);
+    atomic<bool> capture_done(false);
+    vector<WorkerStats> worker_stats;
+    worker_stats.reserve(options.nb_workers);
+    for (size_t k = 0; k < options.nb_workers; ++k) {
+        worker_stats.emplace_back(max_frames(options, stream));
+    }
+    vector<thread> workers;
 
+    for (size_t k = 0; k < options.nb_workers; ++k) {
+        workers.emplace_back([&, k]() {
+            WorkerStats& stats = worker_stats[k];
+            ProcessingContext context = {
+                options,
+                DepthProcessor(options.kernel, options.impl, stream.width, stream.height),
+                stream.intrinsics,
+                buffers,
+                stats.processing,
+            };
+            QueuedFrame queued;
+            auto process_queued = [&]() {
+                stats.queue.record(now_ns() - queued.enqueue_ns);
+                process_frame(queued.frame, context);
+                queued.frame = DepthFrame();
+            };
+            for (;;) {
+                if (queue.try_pop(queued)) {
+                    process_queued();
+                } else if (capture_done.load()) {
+                    // drain what was queued between the last failed pop and the end of capture
+                    while (queue.try_pop(queued)) {
+                        process_queued();
+                    }
+                    break;
+                } else {
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+
+    CaptureStats capture_stats(max_frames(options, stream));
+    int captured_count = 0;
+    int dropped_count = 0;
+    const bool wait_for_workers = !options.replay_file.empty() && !options.replay_recorded_rate;
+
+    auto start_time = high_resolution_clock::now();
+    auto end_time = start_time + seconds(options.duration_seconds);
+
+    while (high_resolution_clock::now() < end_time) {
+        const uint64_t wait_start = now_ns();
+        QueuedFrame queued;
+        const bool captured = source.wait_for_frame(queued.frame);
+        const uint64_t wait_end = now_ns();
+        if (!captured) {
+            cerr << "Error retrieving frames!" << endl;
+            continue;
+        }
+        record_capture(queued.frame, wait_end - wait_start, capture_stats);
+        captured_count++;
+
+        queued.enqueue_ns = now_ns();
+        while (!queue.try_push(queued)) {
+            if (!wait_for_workers) {
+                dropped_count++;
+                break;
+            }
+            this_thread::yield();
+        }
+    }
+
+    const double elapsed_seconds =
+        duration<double>(high_resolution_clock::now() - start_time).count();
+    source.stop();
+    capture_done.store(true);
+    ProcessingStats processing_stats(0);
+    StageLatency queue_latency("queue", 0);
+    for (size_t k = 0; k < options.nb_workers; ++k) {
+        workers[k].join();
+        ProcessingStats& stats = worker_stats[k].processing;
+        processing_stats.lookup.merge(stats.lookup);
+        processing_stats.wrap.merge(stats.wrap);
+        processing_stats.buffer.merge(stats.buffer);
+        processing_stats.process.merge(stats.process);
+        processing_stats.processed += stats.processed;
+        processing_stats.checksum += stats.checksum;
+        queue_latency.merge(worker_stats[k].queue);
+    }
+
+    print_results(capture_stats, processing_stats);
+    source.print_streams(cout, elapsed_seconds);
+    queue_latency.print(cout);
+    cout << "Captured frames: " << captured_count << endl;
+    cout << "Queue full drops: " << dropped_count << endl;
+    for (size_t k = 0; k < options.nb_workers; ++k) {
+        cout << "Worker " << k << " frames: " << worker_stats[k].processing.processed << endl;
     }
-    
-    cout << "Final counter value: " << frame_count << endl;
     return 0;
 }
 
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    unique_ptr<FrameSource> source;
+    try {
+        source = make_frame_source(options);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    if (options.mode == "pipeline") {
+        return run_pipeline(*source, options);
+    }
+    return run_serial(*source, options);
+}
@@ -0,0 +1,614 @@
+#include "depth_kernels.hpp"
+
+#include <Eigen/Core>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DEPTH_KERNELS_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define DEPTH_KERNELS_NEON 1
+#endif
+
+namespace {
+
+// Invalid (zero) depths are mapped to the largest value so that they never win a minimum.
+const uint16_t no_depth = 0xFFFF;
+
+struct Range {
+    uint16_t min;  // smallest non-zero value, no_depth if none
+    uint16_t max;
+};
+
+// Row kernels: each implementation processes one row of the image.
+typedef Range (*ThresholdRowFn)(const uint16_t* in, int width, uint16_t near, uint16_t far,
+                                uint16_t* out);
+typedef void (*DeprojectRowFn)(const uint16_t* in, int width, float units,
+                               const float* column_factors, float row_factor, float* x, float* y,
+                               float* z);
+// rows points to the factor input rows of one output row.
+typedef void (*DecimateRowFn)(const uint16_t* const* rows, int out_width, uint16_t* out);
+
+// ---------------------------------------------------------------------------------------------
+// Scalar
+
+Range threshold_row_scalar(const uint16_t* in, int width, uint16_t near, uint16_t far,
+                           uint16_t* out) {
+    Range range = {no_depth, 0};
+    for (int x = 0; x < width; ++x) {
+        const uint16_t d = in[x];
+        const uint16_t v = (d >= near && d <= far) ? d : 0;
+        out[x] = v;
+        if (v != 0) {
+            range.min = std::min(range.min, v);
+        }
+        range.max = std::max(range.max, v);
+    }
+    return range;
+}
+
+void deproject_row_scalar(const uint16_t* in, int width, float units, const float* column_factors,
+                          float row_factor, float* x, float* y, float* z) {
+    for (int u = 0; u < width; ++u) {
+        const float depth = (float)in[u] * units;
+        x[u] = column_factors[u] * depth;
+        y[u] = row_factor * depth;
+        z[u] = depth;
+    }
+}
+
+template <int factor>
+void decimate_row_scalar(const uint16_t* const* rows, int out_width, uint16_t* out) {
+    for (int ox = 0; ox < out_width; ++ox) {
+        uint16_t closest = no_depth;
+        for (int j = 0; j < factor; ++j) {
+            for (int i = 0; i < factor; ++i) {
+                const uint16_t d = rows[j][ox * factor + i];
+                closest = std::min(closest, d == 0 ? no_depth : d);
+            }
+        }
+        out[ox] = closest == no_depth ? 0 : closest;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Eigen
+
+typedef Eigen::Array<uint16_t, 1, Eigen::Dynamic> RowU16;
+typedef Eigen::Map<const RowU16> ConstRowU16Map;
+typedef Eigen::Map<RowU16> RowU16Map;
+typedef Eigen::Map<const Eigen::ArrayXf> ConstRowF32Map;
+typedef Eigen::Map<Eigen::ArrayXf> RowF32Map;
+
+Range threshold_row_eigen(const uint16_t* in, int width, uint16_t near, uint16_t far,
+                          uint16_t* out) {
+    const ConstRowU16Map d(in, width);
+    RowU16Map v(out, width);
+    v = (d >= near && d <= far).select(d, uint16_t(0));
+
+    Range range;
+    range.min = (v == 0).select(no_depth, v).minCoeff();
+    range.max = v.maxCoeff();
+    return range;
+}
+
+void deproject_row_eigen(const uint16_t* in, int width, float units, const float* column_factors,
+                         float row_factor, float* x, float* y, float* z) {
+    RowF32Map depth(z, width);
+    depth = ConstRowU16Map(in, width).cast<float>().transpose() * units;
+    RowF32Map(x, width) = ConstRowF32Map(column_factors, width) * depth;
+    RowF32Map(y, width) = depth * row_factor;
+}
+
+template <int factor>
+void decimate_row_eigen(const uint16_t* const* rows, int out_width, uint16_t* out) {
+    typedef Eigen::Map<const RowU16, 0, Eigen::InnerStride<factor>> StridedRow;
+    const int width = out_width * factor;
+
+    RowU16 closest = RowU16::Constant(width, no_depth);
+    for (int j = 0; j < factor; ++j) {
+        const ConstRowU16Map row(rows[j], width);
+        closest = closest.min((row == 0).select(no_depth, row));
+    }
+
+    RowU16Map result(out, out_width);
+    result = StridedRow(closest.data(), out_width);
+    for (int i = 1; i < factor; ++i) {
+        result = result.min(StridedRow(closest.data() + i, out_width));
+    }
+    result = (result == no_depth).select(uint16_t(0), result);
+}
+
+// ---------------------------------------------------------------------------------------------
+// SSE4.1 and AVX2
+
+#ifdef DEPTH_KERNELS_X86
+
+__attribute__((target("sse4.1"))) Range threshold_row_sse(const uint16_t* in, int width,
+                                                          uint16_t near, uint16_t far,
+                                                          uint16_t* out) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i near_v = _mm_set1_epi16((short)near);
+    const __m128i far_v = _mm_set1_epi16((short)far);
+    __m128i min_v = _mm_set1_epi16((short)no_depth);
+    __m128i max_v = zero;
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i d = _mm_loadu_si128((const __m128i*)(in + x));
+        const __m128i in_range = _mm_and_si128(_mm_cmpeq_epi16(_mm_max_epu16(d, near_v), d),
+                                               _mm_cmpeq_epi16(_mm_min_epu16(d, far_v), d));
+        const __m128i v = _mm_and_si128(d, in_range);
+        _mm_storeu_si128((__m128i*)(out + x), v);
+        max_v = _mm_max_epu16(max_v, v);
+        min_v = _mm_min_epu16(min_v, _mm_or_si128(v, _mm_cmpeq_epi16(v, zero)));
+    }
+
+    // minpos only finds minimums: the maximum is the complement of the minimum of the complements
+    const __m128i ones = _mm_set1_epi16(-1);
+    Range range;
+    range.min = (uint16_t)_mm_extract_epi16(_mm_minpos_epu16(min_v), 0);
+    range.max = (uint16_t)~_mm_extract_epi16(_mm_minpos_epu16(_mm_xor_si128(max_v, ones)), 0);
+    const Range tail = threshold_row_scalar(in + x, width - x, near, far, out + x);
+    range.min = std::min(range.min, tail.min);
+    range.max = std::max(range.max, tail.max);
+    return range;
+}
+
+__attribute__((target("sse4.1"))) void deproject_row_sse(const uint16_t* in, int width, float units,
+                                                         const float* column_factors,
+                                                         float row_factor, float* x, float* y,
+                                                         float* z) {
+    const __m128 units_v = _mm_set1_ps(units);
+    const __m128 row_v = _mm_set1_ps(row_factor);
+
+    int u = 0;
+    for (; u + 4 <= width; u += 4) {
+        const __m128i d = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(in + u)));
+        const __m128 depth = _mm_mul_ps(_mm_cvtepi32_ps(d), units_v);
+        _mm_storeu_ps(x + u, _mm_mul_ps(_mm_loadu_ps(column_factors + u), depth));
+        _mm_storeu_ps(y + u, _mm_mul_ps(row_v, depth));
+        _mm_storeu_ps(z + u, depth);
+    }
+    deproject_row_scalar(in + u, width - u, units, column_factors + u, row_factor, x + u, y + u,
+                         z + u);
+}
+
+// Element-wise minimum of the factor rows, invalid depths mapped to no_depth.
+template <int factor>
+__attribute__((target("sse4.1"))) inline __m128i vertical_min_sse(const uint16_t* const* rows,
+                                                                  int x) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i closest = _mm_set1_epi16((short)no_depth);
+    for (int j = 0; j < factor; ++j) {
+        const __m128i d = _mm_loadu_si128((const __m128i*)(rows[j] + x));
+        closest = _mm_min_epu16(closest, _mm_or_si128(d, _mm_cmpeq_epi16(d, zero)));
+    }
+    return closest;
+}
+
+// Map no_depth back to 0.
+__attribute__((target("sse4.1"))) inline __m128i restore_invalid_sse(__m128i v) {
+    return _mm_andnot_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16((short)no_depth)), v);
+}
+
+template <int factor>
+__attribute__((target("sse4.1"))) void decimate_row_sse(const uint16_t* const* rows, int out_width,
+                                                        uint16_t* out) {
+    const __m128i low16 = _mm_set1_epi32(0xFFFF);
+    int ox = 0;
+    if (factor == 2) {
+        // 16 input pixels -> 8 output pixels
+        for (; ox + 8 <= out_width; ox += 8) {
+            __m128i a = vertical_min_sse<factor>(rows, ox * 2);
+            __m128i b = vertical_min_sse<factor>(rows, ox * 2 + 8);
+            a = _mm_and_si128(_mm_min_epu16(a, _mm_srli_epi32(a, 16)), low16);
+            b = _mm_and_si128(_mm_min_epu16(b, _mm_srli_epi32(b, 16)), low16);
+            _mm_storeu_si128((__m128i*)(out + ox), restore_invalid_sse(_mm_packus_epi32(a, b)));
+        }
+    } else {
+        // 8 input pixels -> 2 output pixels
+        for (; ox + 2 <= out_width; ox += 2) {
+            __m128i v = vertical_min_sse<factor>(rows, ox * 4);
+            v = _mm_min_epu16(v, _mm_srli_epi32(v, 16));
+            v = restore_invalid_sse(_mm_min_epu16(v, _mm_srli_epi64(v, 32)));
+            out[ox] = (uint16_t)_mm_extract_epi16(v, 0);
+            out[ox + 1] = (uint16_t)_mm_extract_epi16(v, 4);
+        }
+    }
+
+    const uint16_t* tail_rows[factor];
+    for (int j = 0; j < factor; ++j) {
+        tail_rows[j] = rows[j] + ox * factor;
+    }
+    decimate_row_scalar<factor>(tail_rows, out_width - ox, out + ox);
+}
+
+__attribute__((target("avx2"))) Range threshold_row_avx2(const uint16_t* in, int width,
+                                                         uint16_t near, uint16_t far,
+                                                         uint16_t* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i near_v = _mm256_set1_epi16((short)near);
+    const __m256i far_v = _mm256_set1_epi16((short)far);
+    __m256i min_v = _mm256_set1_epi16((short)no_depth);
+    __m256i max_v = zero;
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(in + x));
+        const __m256i in_range =
+            _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_max_epu16(d, near_v), d),
+                             _mm256_cmpeq_epi16(_mm256_min_epu16(d, far_v), d));
+        const __m256i v = _mm256_and_si256(d, in_range);
+        _mm256_storeu_si256((__m256i*)(out + x), v);
+        max_v = _mm256_max_epu16(max_v, v);
+        min_v = _mm256_min_epu16(min_v, _mm256_or_si256(v, _mm256_cmpeq_epi16(v, zero)));
+    }
+
+    const __m128i min_128 = _mm_min_epu16(_mm256_castsi256_si128(min_v),
+                                          _mm256_extracti128_si256(min_v, 1));
+    const __m128i max_128 = _mm_max_epu16(_mm256_castsi256_si128(max_v),
+                                          _mm256_extracti128_si256(max_v, 1));
+    const __m128i ones = _mm_set1_epi16(-1);
+    Range range;
+    range.min = (uint16_t)_mm_extract_epi16(_mm_minpos_epu16(min_128), 0);
+    range.max = (uint16_t)~_mm_extract_epi16(_mm_minpos_epu16(_mm_xor_si128(max_128, ones)), 0);
+    const Range tail = threshold_row_scalar(in + x, width - x, near, far, out + x);
+    range.min = std::min(range.min, tail.min);
+    range.max = std::max(range.max, tail.max);
+    return range;
+}
+
+__attribute__((target("avx2"))) void deproject_row_avx2(const uint16_t* in, int width, float units,
+                                                        const float* column_factors,
+                                                        float row_factor, float* x, float* y,
+                                                        float* z) {
+    const __m256 units_v = _mm256_set1_ps(units);
+    const __m256 row_v = _mm256_set1_ps(row_factor);
+
+    int u = 0;
+    for (; u + 8 <= width; u += 8) {
+        const __m256i d = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(in + u)));
+        const __m256 depth = _mm256_mul_ps(_mm256_cvtepi32_ps(d), units_v);
+        _mm256_storeu_ps(x + u, _mm256_mul_ps(_mm256_loadu_ps(column_factors + u), depth));
+        _mm256_storeu_ps(y + u, _mm256_mul_ps(row_v, depth));
+        _mm256_storeu_ps(z + u, depth);
+    }
+    deproject_row_scalar(in + u, width - u, units, column_factors + u, row_factor, x + u, y + u,
+                         z + u);
+}
+
+template <int factor>
+__attribute__((target("avx2"))) inline __m256i vertical_min_avx2(const uint16_t* const* rows,
+                                                                 int x) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i closest = _mm256_set1_epi16((short)no_depth);
+    for (int j = 0; j < factor; ++j) {
+        const __m256i d = _mm256_loadu_si256((const __m256i*)(rows[j] + x));
+        closest = _mm256_min_epu16(closest, _mm256_or_si256(d, _mm256_cmpeq_epi16(d, zero)));
+    }
+    return closest;
+}
+
+__attribute__((target("avx2"))) inline __m256i restore_invalid_avx2(__m256i v) {
+    return _mm256_andnot_si256(_mm256_cmpeq_epi16(v, _mm256_set1_epi16((short)no_depth)), v);
+}
+
+template <int factor>
+__attribute__((target("avx2"))) void decimate_row_avx2(const uint16_t* const* rows, int out_width,
+                                                       uint16_t* out) {
+    const __m256i low16 = _mm256_set1_epi32(0xFFFF);
+    int ox = 0;
+    if (factor == 2) {
+        // 32 input pixels -> 16 output pixels
+        for (; ox + 16 <= out_width; ox += 16) {
+            __m256i a = vertical_min_avx2<factor>(rows, ox * 2);
+            __m256i b = vertical_min_avx2<factor>(rows, ox * 2 + 16);
+            a = _mm256_and_si256(_mm256_min_epu16(a, _mm256_srli_epi32(a, 16)), low16);
+            b = _mm256_and_si256(_mm256_min_epu16(b, _mm256_srli_epi32(b, 16)), low16);
+            // the pack works within 128-bit lanes: put the 64-bit quarters back in order
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+            _mm256_storeu_si256((__m256i*)(out + ox), restore_invalid_avx2(packed));
+        }
+    } else {
+        // 16 input pixels -> 4 output pixels
+        for (; ox + 4 <= out_width; ox += 4) {
+            __m256i v = vertical_min_avx2<factor>(rows, ox * 4);
+            v = _mm256_min_epu16(v, _mm256_srli_epi32(v, 16));
+            v = restore_invalid_avx2(_mm256_min_epu16(v, _mm256_srli_epi64(v, 32)));
+            out[ox] = (uint16_t)_mm256_extract_epi16(v, 0);
+            out[ox + 1] = (uint16_t)_mm256_extract_epi16(v, 4);
+            out[ox + 2] = (uint16_t)_mm256_extract_epi16(v, 8);
+            out[ox + 3] = (uint16_t)_mm256_extract_epi16(v, 12);
+        }
+    }
+
+    const uint16_t* tail_rows[factor];
+    for (int j = 0; j < factor; ++j) {
+        tail_rows[j] = rows[j] + ox * factor;
+    }
+    decimate_row_scalar<factor>(tail_rows, out_width - ox, out + ox);
+}
+
+#endif  // DEPTH_KERNELS_X86
+
+// ---------------------------------------------------------------------------------------------
+// NEON
+
+#ifdef DEPTH_KERNELS_NEON
+
+Range threshold_row_neon(const uint16_t* in, int width, uint16_t near, uint16_t far,
+                         uint16_t* out) {
+    const uint16x8_t near_v = vdupq_n_u16(near);
+    const uint16x8_t far_v = vdupq_n_u16(far);
+    uint16x8_t min_v = vdupq_n_u16(no_depth);
+    uint16x8_t max_v = vdupq_n_u16(0);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const uint16x8_t d = vld1q_u16(in + x);
+        const uint16x8_t in_range = vandq_u16(vcgeq_u16(d, near_v), vcleq_u16(d, far_v));
+        const uint16x8_t v = vandq_u16(d, in_range);
+        vst1q_u16(out + x, v);
+        max_v = vmaxq_u16(max_v, v);
+        min_v = vminq_u16(min_v, vorrq_u16(v, vceqzq_u16(v)));
+    }
+
+    Range range;
+    range.min = vminvq_u16(min_v);
+    range.max = vmaxvq_u16(max_v);
+    const Range tail = threshold_row_scalar(in + x, width - x, near, far, out + x);
+    range.min = std::min(range.min, tail.min);
+    range.max = std::max(range.max, tail.max);
+    return range;
+}
+
+void deproject_row_neon(const uint16_t* in, int width, float units, const float* column_factors,
+                        float row_factor, float* x, float* y, float* z) {
+    int u = 0;
+    for (; u + 8 <= width; u += 8) {
+        const uint16x8_t d = vld1q_u16(in + u);
+        const float32x4_t depth_low = vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(d))), units);
+        const float32x4_t depth_high = vmulq_n_f32(vcvtq_f32_u32(vmovl_high_u16(d)), units);
+        vst1q_f32(x + u, vmulq_f32(vld1q_f32(column_factors + u), depth_low));
+        vst1q_f32(x + u + 4, vmulq_f32(vld1q_f32(column_factors + u + 4), depth_high));
+        vst1q_f32(y + u, vmulq_n_f32(depth_low, row_factor));
+        vst1q_f32(y + u + 4, vmulq_n_f32(depth_high, row_factor));
+        vst1q_f32(z + u, depth_low);
+        vst1q_f32(z + u + 4, depth_high);
+    }
+    deproject_row_scalar(in + u, width - u, units, column_factors + u, row_factor, x + u, y + u,
+                         z + u);
+}
+
+template <int factor>
+inline uint16x8_t vertical_min_neon(const uint16_t* const* rows, int x) {
+    uint16x8_t closest = vdupq_n_u16(no_depth);
+    for (int j = 0; j < factor; ++j) {
+        const uint16x8_t d = vld1q_u16(rows[j] + x);
+        closest = vminq_u16(closest, vorrq_u16(d, vceqzq_u16(d)));
+    }
+    return closest;
+}
+
+inline uint16x8_t restore_invalid_neon(uint16x8_t v) {
+    return vbicq_u16(v, vceqq_u16(v, vdupq_n_u16(no_depth)));
+}
+
+template <int factor>
+void decimate_row_neon(const uint16_t* const* rows, int out_width, uint16_t* out) {
+    int ox = 0;
+    if (factor == 2) {
+        // 16 input pixels -> 8 output pixels, with pairwise minimums
+        for (; ox + 8 <= out_width; ox += 8) {
+            const uint16x8_t a = vertical_min_neon<factor>(rows, ox * 2);
+            const uint16x8_t b = vertical_min_neon<factor>(rows, ox * 2 + 8);
+            vst1q_u16(out + ox, restore_invalid_neon(vpminq_u16(a, b)));
+        }
+    } else {
+        // 32 input pixels -> 8 output pixels, with two rounds of pairwise minimums
+        for (; ox + 8 <= out_width; ox += 8) {
+            const uint16x8_t a = vertical_min_neon<factor>(rows, ox * 4);
+            const uint16x8_t b = vertical_min_neon<factor>(rows, ox * 4 + 8);
+            const uint16x8_t c = vertical_min_neon<factor>(rows, ox * 4 + 16);
+            const uint16x8_t d = vertical_min_neon<factor>(rows, ox * 4 + 24);
+            const uint16x8_t pairs = vpminq_u16(vpminq_u16(a, b), vpminq_u16(c, d));
+            vst1q_u16(out + ox, restore_invalid_neon(pairs));
+        }
+    }
+
+    const uint16_t* tail_rows[factor];
+    for (int j = 0; j < factor; ++j) {
+        tail_rows[j] = rows[j] + ox * factor;
+    }
+    decimate_row_scalar<factor>(tail_rows, out_width - ox, out + ox);
+}
+
+#endif  // DEPTH_KERNELS_NEON
+
+// ---------------------------------------------------------------------------------------------
+// Dispatch
+
+struct RowKernels {
+    ThresholdRowFn threshold;
+    DeprojectRowFn deproject;
+    DecimateRowFn decimate2;
+    DecimateRowFn decimate4;
+};
+
+RowKernels row_kernels(KernelImpl impl) {
+    switch (impl) {
+    case KernelImpl::eigen:
+        return {threshold_row_eigen, deproject_row_eigen, decimate_row_eigen<2>,
+                decimate_row_eigen<4>};
+#ifdef DEPTH_KERNELS_X86
+    case KernelImpl::sse:
+        return {threshold_row_sse, deproject_row_sse, decimate_row_sse<2>, decimate_row_sse<4>};
+    case KernelImpl::avx2:
+        return {threshold_row_avx2, deproject_row_avx2, decimate_row_avx2<2>,
+                decimate_row_avx2<4>};
+#endif
+#ifdef DEPTH_KERNELS_NEON
+    case KernelImpl::neon:
+        return {threshold_row_neon, deproject_row_neon, decimate_row_neon<2>,
+                decimate_row_neon<4>};
+#endif
+    default:
+        return {threshold_row_scalar, deproject_row_scalar, decimate_row_scalar<2>,
+                decimate_row_scalar<4>};
+    }
+}
+
+}  // namespace
+
+bool parse_depth_kernel(const std::string& name, DepthKernel& kernel) {
+    static const struct {
+        const char* name;
+        DepthKernel kernel;
+    } kernels[] = {
+        {"range", DepthKernel::range},         {"threshold", DepthKernel::threshold},
+        {"deproject", DepthKernel::deproject}, {"decimate2", DepthKernel::decimate2},
+        {"decimate4", DepthKernel::decimate4},
+    };
+    for (const auto& entry : kernels) {
+        if (name == entry.name) {
+            kernel = entry.kernel;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_kernel_impl(const std::string& name, KernelImpl& impl) {
+    static const struct {
+        const char* name;
+        KernelImpl impl;
+    } impls[] = {
+        {"scalar", KernelImpl::scalar}, {"eigen", KernelImpl::eigen}, {"sse", KernelImpl::sse},
+        {"avx2", KernelImpl::avx2},     {"neon", KernelImpl::neon},
+    };
+    for (const auto& entry : impls) {
+        if (name == entry.name) {
+            impl = entry.impl;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool kernel_impl_supported(KernelImpl impl) {
+    switch (impl) {
+    case KernelImpl::scalar:
+    case KernelImpl::eigen:
+        return true;
+#ifdef DEPTH_KERNELS_X86
+    case KernelImpl::sse:
+        return __builtin_cpu_supports("sse4.1");
+    case KernelImpl::avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef DEPTH_KERNELS_NEON
+    case KernelImpl::neon:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+DepthProcessor::DepthProcessor(DepthKernel kernel, KernelImpl impl, int width, int height)
+    : _kernel(kernel), _impl(impl), _width(width), _height(height), _table_intrinsics() {
+    if (kernel == DepthKernel::deproject) {
+        _column_factors.resize(width);
+        _row_factors.resize(height);
+    }
+}
+
+void DepthProcessor::allocate_output(DepthOutput& output) const {
+    const size_t nb_pixels = (size_t)_width * _height;
+    switch (_kernel) {
+    case DepthKernel::threshold:
+        output.image.resize(nb_pixels);
+        break;
+    case DepthKernel::deproject:
+        output.x.resize(nb_pixels);
+        output.y.resize(nb_pixels);
+        output.z.resize(nb_pixels);
+        break;
+    case DepthKernel::decimate2:
+        output.image.resize((size_t)(_width / 2) * (_height / 2));
+        break;
+    case DepthKernel::decimate4:
+        output.image.resize((size_t)(_width / 4) * (_height / 4));
+        break;
+    case DepthKernel::range:
+        break;
+    }
+}
+
+void DepthProcessor::update_deprojection_tables(const DepthIntrinsics& intrinsics) {
+    if (intrinsics.fx == _table_intrinsics.fx && intrinsics.fy == _table_intrinsics.fy &&
+        intrinsics.ppx == _table_intrinsics.ppx && intrinsics.ppy == _table_intrinsics.ppy) {
+        return;
+    }
+    for (int u = 0; u < _width; ++u) {
+        _column_factors[u] = ((float)u - intrinsics.ppx) / intrinsics.fx;
+    }
+    for (int v = 0; v < _height; ++v) {
+        _row_factors[v] = ((float)v - intrinsics.ppy) / intrinsics.fy;
+    }
+    _table_intrinsics = intrinsics;
+}
+
+uint64_t DepthProcessor::run(const DepthView& depth, const DepthIntrinsics& intrinsics,
+                             DepthOutput& output) {
+    const RowKernels kernels = row_kernels(_impl);
+    const int width = std::min(depth.width, _width);
+    const int height = std::min(depth.height, _height);
+
+    switch (_kernel) {
+    case DepthKernel::threshold: {
+        const uint16_t near = (uint16_t)std::min(near_m / intrinsics.depth_units, 65535.0f);
+        const uint16_t far = (uint16_t)std::min(far_m / intrinsics.depth_units, 65535.0f);
+        Range range = {no_depth, 0};
+        for (int v = 0; v < height; ++v) {
+            const Range row = kernels.threshold(depth.data + (size_t)v * depth.stride, width, near,
+                                                far, &output.image[(size_t)v * _width]);
+            range.min = std::min(range.min, row.min);
+            range.max = std::max(range.max, row.max);
+        }
+        return range.min == no_depth ? 0 : (uint64_t)(range.max - range.min);
+    }
+    case DepthKernel::deproject: {
+        update_deprojection_tables(intrinsics);
+        for (int v = 0; v < height; ++v) {
+            const size_t offset = (size_t)v * _width;
+            kernels.deproject(depth.data + (size_t)v * depth.stride, width, intrinsics.depth_units,
+                              _column_factors.data(), _row_factors[v], &output.x[offset],
+                              &output.y[offset], &output.z[offset]);
+        }
+        const size_t center = (size_t)(height / 2) * _width + width / 2;
+        return (uint64_t)(output.z[center] * 1000.0f);
+    }
+    case DepthKernel::decimate2:
+    case DepthKernel::decimate4: {
+        const int factor = _kernel == DepthKernel::decimate2 ? 2 : 4;
+        const DecimateRowFn decimate =
+            _kernel == DepthKernel::decimate2 ? kernels.decimate2 : kernels.decimate4;
+        const int out_width = width / factor;
+        const int out_height = height / factor;
+        const uint16_t* rows[4];
+        for (int oy = 0; oy < out_height; ++oy) {
+            for (int j = 0; j < factor; ++j) {
+                rows[j] = depth.data + (size_t)(oy * factor + j) * depth.stride;
+            }
+            decimate(rows, out_width, &output.image[(size_t)oy * (_width / factor)]);
+        }
+        return output.image[(size_t)(out_height / 2) * (_width / factor) + out_width / 2];
+    }
+    case DepthKernel::range:
+        break;
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef DEPTH_KERNELS_HPP
+#define DEPTH_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Processing kernels applied to the Z16 depth image.
+enum class DepthKernel {
+    range,      // value range of the image (cv::minMaxIdx, no implementation variants)
+    threshold,  // zero the pixels outside [near, far], min/max of the remaining ones
+    deproject,  // depth to point cloud (x, y, z planes, in meters), distortion ignored
+    decimate2,  // closest valid (non-zero) depth of each 2x2 block
+    decimate4,  // closest valid (non-zero) depth of each 4x4 block
+};
+
+// Implementations of the kernels.
+enum class KernelImpl {
+    scalar,  // plain loops
+    eigen,   // Eigen array expressions
+    sse,     // SSE4.1 intrinsics (x86)
+    avx2,    // AVX2 intrinsics (x86)
+    neon,    // NEON intrinsics (Armv8)
+};
+
+bool parse_depth_kernel(const std::string& name, DepthKernel& kernel);
+bool parse_kernel_impl(const std::string& name, KernelImpl& impl);
+
+// Whether the implementation is compiled in and supported by the running CPU.
+bool kernel_impl_supported(KernelImpl impl);
+
+// Depth image borrowed from the frame buffer; stride is in pixels.
+struct DepthView {
+    const uint16_t* data;
+    int width;
+    int height;
+    int stride;
+};
+
+// Pinhole model of the depth stream and scale of the depth values.
+struct DepthIntrinsics {
+    float fx;
+    float fy;
+    float ppx;
+    float ppy;
+    float depth_units;  // meters per depth unit
+};
+
+// Output buffers of a kernel for one frame.
+struct DepthOutput {
+    std::vector<uint16_t> image;  // threshold and decimation output
+    std::vector<float> x;         // deprojection output planes
+    std::vector<float> y;
+    std::vector<float> z;
+};
+
+// Runs one kernel implementation on depth images of a given size.
+// Running the kernel does not allocate: the output buffers are provided by the caller, and sized
+// once with allocate_output. One instance must be used per processing thread.
+class DepthProcessor {
+public:
+    DepthProcessor(DepthKernel kernel, KernelImpl impl, int width, int height);
+
+    // Size the output buffers for the kernel and image size of this processor.
+    void allocate_output(DepthOutput& output) const;
+
+    // Run the kernel on the image, writing into output, and return a checksum of the output.
+    uint64_t run(const DepthView& depth, const DepthIntrinsics& intrinsics, DepthOutput& output);
+
+    // Thresholds of the threshold kernel, in meters.
+    static constexpr float near_m = 0.3f;
+    static constexpr float far_m = 4.0f;
+
+private:
+    void update_deprojection_tables(const DepthIntrinsics& intrinsics);
+
+    DepthKernel _kernel;
+    KernelImpl _impl;
+    int _width;
+    int _height;
+
+    // Deprojection factors (u - ppx) / fx per column and (v - ppy) / fy per row, recomputed only
+    // when the intrinsics change.
+    DepthIntrinsics _table_intrinsics;
+    std::vector<float> _column_factors;
+    std::vector<float> _row_factors;
+};
+
+#endif  // DEPTH_KERNELS_HPP
@@ -0,0 +1,107 @@
+#ifndef FRAME_STATS_HPP
+#define FRAME_STATS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+static inline uint64_t now_ns() {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Durations of one stage of the frame processing, recorded into preallocated storage so that
+// recording never allocates on the measured path. Samples beyond the capacity are not kept.
+class StageLatency {
+public:
+    StageLatency(const std::string& name, size_t capacity) : _name(name) {
+        _samples.reserve(capacity);
+    }
+
+    void record(uint64_t duration_ns) {
+        if (_samples.size() < _samples.capacity()) {
+            _samples.push_back(duration_ns);
+        }
+    }
+
+    void merge(const StageLatency& other) {
+        _samples.insert(_samples.end(), other._samples.begin(), other._samples.end());
+    }
+
+    // Prints "Stage <name>: p50_ns=<v> p99_ns=<v> max_ns=<v>".
+    void print(std::ostream& os) {
+        std::sort(_samples.begin(), _samples.end());
+        os << "Stage " << _name << ": p50_ns=" << percentile(50.0) << " p99_ns=" << percentile(99.0)
+           << " max_ns=" << (_samples.empty() ? 0 : _samples.back()) << std::endl;
+    }
+
+private:
+    // Nearest-rank percentile of the sorted samples.
+    uint64_t percentile(double p) const {
+        if (_samples.empty()) {
+            return 0;
+        }
+        size_t rank = (size_t)std::ceil(p / 100.0 * (double)_samples.size());
+        rank = std::max<size_t>(rank, 1);
+        return _samples[rank - 1];
+    }
+
+    std::string _name;
+    std::vector<uint64_t> _samples;
+};
+
+// Frame numbers and hardware timestamps of the captured frames, from which the camera-side frame
+// drops and the inter-frame jitter are derived.
+class FrameTimeline {
+public:
+    explicit FrameTimeline(size_t capacity) {
+        _frame_numbers.reserve(capacity);
+        _timestamps_ms.reserve(capacity);
+    }
+
+    void record(unsigned long long frame_number, double timestamp_ms) {
+        if (_frame_numbers.size() < _frame_numbers.capacity()) {
+            _frame_numbers.push_back(frame_number);
+            _timestamps_ms.push_back(timestamp_ms);
+        }
+    }
+
+    // Prints the number of frames skipped in the frame number sequence, and the mean and standard
+    // deviation (jitter) of the interval between consecutive frames, in microseconds.
+    // A frame number that does not increase marks a restart of the stream (looped replay of a
+    // recording): the interval across the restart is not counted.
+    void print(std::ostream& os) const {
+        unsigned long long dropped = 0;
+        double sum = 0.0;
+        double sum_squares = 0.0;
+        size_t nb_intervals = 0;
+        for (size_t i = 1; i < _frame_numbers.size(); ++i) {
+            if (_frame_numbers[i] <= _frame_numbers[i - 1]) {
+                continue;
+            }
+            if (_frame_numbers[i] > _frame_numbers[i - 1] + 1) {
+                dropped += _frame_numbers[i] - _frame_numbers[i - 1] - 1;
+            }
+            const double interval_us = (_timestamps_ms[i] - _timestamps_ms[i - 1]) * 1000.0;
+            sum += interval_us;
+            sum_squares += interval_us * interval_us;
+            nb_intervals++;
+        }
+        const double mean = nb_intervals > 0 ? sum / (double)nb_intervals : 0.0;
+        const double mean_squares = nb_intervals > 0 ? sum_squares / (double)nb_intervals : 0.0;
+        const double variance = std::max(mean_squares - mean * mean, 0.0);
+
+        os << "Camera dropped frames: " << dropped << std::endl;
+        os << "Interframe: mean_us=" << mean << " jitter_us=" << std::sqrt(variance) << std::endl;
+    }
+
+private:
+    std::vector<unsigned long long> _frame_numbers;
+    std::vector<double> _timestamps_ms;
+};
+
+#endif  // FRAME_STATS_HPP
@@ -0,0 +1,114 @@
+#include "raw_recording.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char raw_recording_magic[8] = {'Z', '1', '6', 'R', 'A', 'W', '0', '1'};
+
+namespace {
+
+size_t record_size(const RawRecordingHeader& header) {
+    const size_t pixels_size = (size_t)header.width * header.height * sizeof(uint16_t);
+    return sizeof(RawFrameHeader) + (pixels_size + 63) / 64 * 64;
+}
+
+std::runtime_error system_error(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+}  // namespace
+
+RawRecording::RawRecording(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw system_error("Cannot open", path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw system_error("Cannot stat", path);
+    }
+    _size = (size_t)st.st_size;
+    if (_size < sizeof(RawRecordingHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Not a raw Z16 recording: " + path);
+    }
+
+    void* data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw system_error("Cannot map", path);
+    }
+    _data = (const uint8_t*)data;
+
+    const RawRecordingHeader& h = header();
+    _record_size = record_size(h);
+    if (std::memcmp(h.magic, raw_recording_magic, sizeof(h.magic)) != 0 || h.nb_frames == 0 ||
+        _size < sizeof(RawRecordingHeader) + h.nb_frames * _record_size) {
+        ::munmap((void*)_data, _size);
+        throw std::runtime_error("Not a raw Z16 recording, or truncated: " + path);
+    }
+}
+
+RawRecording::~RawRecording() {
+    ::munmap((void*)_data, _size);
+}
+
+RawRecordingWriter::RawRecordingWriter(const std::string& path, const RawRecordingHeader& header)
+    : _header(header) {
+    std::memcpy(_header.magic, raw_recording_magic, sizeof(_header.magic));
+    _header.nb_frames = 0;
+    _padding = record_size(_header) - sizeof(RawFrameHeader) -
+               (size_t)_header.width * _header.height * sizeof(uint16_t);
+
+    _file = std::fopen(path.c_str(), "wb");
+    if (_file == nullptr) {
+        throw system_error("Cannot create", path);
+    }
+    write(&_header, sizeof(_header));
+}
+
+RawRecordingWriter::~RawRecordingWriter() {
+    if (_file != nullptr) {
+        std::fclose(_file);
+    }
+}
+
+void RawRecordingWriter::write_frame(uint64_t frame_number, double timestamp_ms,
+                                     const uint16_t* data, int stride) {
+    RawFrameHeader frame_header = {};
+    frame_header.frame_number = frame_number;
+    frame_header.timestamp_ms = timestamp_ms;
+    write(&frame_header, sizeof(frame_header));
+    for (uint32_t y = 0; y < _header.height; ++y) {
+        write(data + (size_t)y * stride, _header.width * sizeof(uint16_t));
+    }
+    static const uint8_t zeros[64] = {};
+    write(zeros, _padding);
+    _header.nb_frames++;
+}
+
+void RawRecordingWriter::close() {
+    if (std::fseek(_file, 0, SEEK_SET) != 0) {
+        throw std::runtime_error(std::string("Cannot rewrite recording header: ") +
+                                 std::strerror(errno));
+    }
+    write(&_header, sizeof(_header));
+    const int ret = std::fclose(_file);
+    _file = nullptr;
+    if (ret != 0) {
+        throw std::runtime_error(std::string("Cannot close recording: ") + std::strerror(errno));
+    }
+}
+
+void RawRecordingWriter::write(const void* data, size_t size) {
+    if (size > 0 && std::fwrite(data, size, 1, _file) != 1) {
+        throw std::runtime_error(std::string("Cannot write recording: ") + std::strerror(errno));
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef RAW_RECORDING_HPP
+#define RAW_RECORDING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Raw Z16 recording: a file header followed by fixed-size frame records, each made of a frame
+// header and the width * height depth pixels (row-major, no padding between rows), in the byte
+// order of the host. Records are padded to a multiple of 64 bytes so that, once the file is
+// mapped, the pixels of every frame start on a cache line.
+struct RawRecordingHeader {
+    char magic[8];  // raw_recording_magic
+    uint32_t width;
+    uint32_t height;
+    uint32_t fps;
+    uint32_t nb_frames;
+    float fx;
+    float fy;
+    float ppx;
+    float ppy;
+    float depth_units;  // meters per depth unit
+    uint8_t reserved[20];
+};
+
+struct RawFrameHeader {
+    uint64_t frame_number;
+    double timestamp_ms;
+    uint8_t reserved[48];
+};
+
+static_assert(sizeof(RawRecordingHeader) == 64, "unexpected raw recording header size");
+static_assert(sizeof(RawFrameHeader) == 64, "unexpected raw frame header size");
+
+extern const char raw_recording_magic[8];
+
+// Read-only view of a raw recording, mapped in memory: the frames are read in place, without
+// copy. The mapping is populated when the recording is opened so that replaying it does not
+// fault pages in. Throws std::runtime_error if the file cannot be mapped or is not a recording.
+class RawRecording {
+public:
+    explicit RawRecording(const std::string& path);
+    ~RawRecording();
+
+    RawRecording(const RawRecording&) = delete;
+    RawRecording& operator=(const RawRecording&) = delete;
+
+    const RawRecordingHeader& header() const { return *(const RawRecordingHeader*)_data; }
+    size_t nb_frames() const { return header().nb_frames; }
+
+    const RawFrameHeader& frame_header(size_t index) const {
+        return *(const RawFrameHeader*)record(index);
+    }
+    const uint16_t* frame_data(size_t index) const {
+        return (const uint16_t*)(record(index) + sizeof(RawFrameHeader));
+    }
+
+private:
+    const uint8_t* record(size_t index) const {
+        return _data + sizeof(RawRecordingHeader) + index * _record_size;
+    }
+
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+    size_t _record_size = 0;
+};
+
+// Writes a raw recording frame by frame; the frame count of the header is updated on close.
+// Throws std::runtime_error on I/O errors.
+class RawRecordingWriter {
+public:
+    // header.nb_frames is ignored.
+    RawRecordingWriter(const std::string& path, const RawRecordingHeader& header);
+    ~RawRecordingWriter();
+
+    RawRecordingWriter(const RawRecordingWriter&) = delete;
+    RawRecordingWriter& operator=(const RawRecordingWriter&) = delete;
+
+    // stride is in pixels.
+    void write_frame(uint64_t frame_number, double timestamp_ms, const uint16_t* data, int stride);
+    void close();
+
+private:
+    void write(const void* data, size_t size);
+
+    FILE* _file = nullptr;
+    RawRecordingHeader _header;
+    size_t _padding = 0;
+};
+
+#endif  // RAW_RECORDING_HPP
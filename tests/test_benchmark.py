@@ -4,13 +4,18 @@
 Module for testing the benchmark class.
 """
 
+import importlib.util
+import pathlib
 import tempfile
+import threading
 import unittest
 from io import StringIO
 from unittest.mock import patch
 
 from benchkit.benchmark import Benchmark, RecordResult
 from benchkit.sharedlibs.tiltlib import TiltLib
+from benchkit.utils.convergence import ConvergenceCriterion
+from benchkit.utils.parquetsink import parquet_dataset_path
 
 
 class TiltMock(TiltLib):
@@ -209,5 +214,571 @@ class TestBenchmark(unittest.TestCase):
         self.assertEqual(obtained_csv, expected_csv)
 
 
+class TestContinuing(unittest.TestCase):
+    """Test suite of the continuation of a campaign from its result file."""
+
+    @staticmethod
+    def _run(csv_path: str, nb_runs: int, continuing: bool) -> str:
+        with patch("sys.stdout", new_callable=StringIO) as mock_stdout:
+            bench = BenchmarkMock(tilt=TiltMock())
+            bench.configure_variables(
+                experiment_name="{EXPERIMENT NAME}",
+                benchmark_name="{BENCHMARK NAME}",
+                csv_output_path=csv_path,
+                base_data_dir=None,
+                benchmark_duration_seconds=0,
+                nb_runs=nb_runs,
+                constants={"kernel": "6.1"},
+                variables=[{"a": a, "b": 10 + a, "c": c} for a in [1, 2] for c in [21, 22]],
+                pretty_variables=None,
+                debug=False,
+                gdb=False,
+            )
+            bench.run(other_campaigns_seconds=0, barrier=None, continuing=continuing)
+            return mock_stdout.getvalue()
+
+    def test_continuing(self):
+        """Only the records that are not in the result file are run."""
+        _, csv_path = tempfile.mkstemp(prefix="bench-", suffix=".csv")
+        output = self._run(csv_path=csv_path, nb_runs=1, continuing=False)
+        self.assertEqual(output.count("[BENCH] RUN"), 4)
+
+        output = self._run(csv_path=csv_path, nb_runs=2, continuing=True)
+        self.assertEqual(output.count("[CONTINUING]"), 4)
+        self.assertEqual(output.count("[BENCH] RUN"), 4)
+
+        output = self._run(csv_path=csv_path, nb_runs=2, continuing=True)
+        self.assertEqual(output.count("[CONTINUING]"), 8)
+        self.assertEqual(output.count("[BENCH] RUN"), 0)
+
+        with open(csv_path, "r") as csv_file:
+            lines = [line for line in csv_file.read().split("\n") if line and line[0] != "#"]
+        self.assertEqual(len(lines), 1 + 8)
+        self.assertEqual(
+            sorted(line.split(";")[-2] for line in lines[1:]),
+            ["1"] * 4 + ["2"] * 4,
+        )
+
+
+class BackgroundBuildBenchmarkMock(BenchmarkMock):
+    """Mock of a benchmark supporting the background builds, logging the build events."""
+
+    def __init__(self, tilt):
+        super().__init__(tilt=tilt)
+        self.events = []
+
+    def build_bench(  # pylint: disable=arguments-differ
+        self,
+        benchmark_duration_seconds: int,
+        **kwargs,
+    ):
+        self.events.append(("build", kwargs["a"]))
+
+    def background_build_bench(  # pylint: disable=arguments-differ
+        self,
+        cpus,
+        parallel_make_str,
+        benchmark_duration_seconds: int,
+        **kwargs,
+    ):
+        self.events.append(("background", kwargs["a"], tuple(cpus), parallel_make_str))
+
+    def single_run(self, **kwargs) -> str:
+        self.events.append(("run", kwargs["build_variables"]["a"]))
+        return super().single_run(**kwargs)
+
+
+class TestBackgroundBuilds(unittest.TestCase):
+    """Test suite of the builds overlapping with the runs."""
+
+    @patch("sys.stdout", new_callable=StringIO)
+    def test_background_builds(self, _mock_stdout):
+        """The next variants are built in the background before their own build step."""
+        bench = BackgroundBuildBenchmarkMock(tilt=TiltMock())
+        _, csv_path = tempfile.mkstemp(prefix="bench-", suffix=".csv")
+        bench.configure_variables(
+            experiment_name="{EXPERIMENT NAME}",
+            benchmark_name="{BENCHMARK NAME}",
+            csv_output_path=csv_path,
+            base_data_dir=None,
+            benchmark_duration_seconds=0,
+            nb_runs=1,
+            constants=None,
+            variables=[{"a": a, "b": 10 + a, "c": 20 + a} for a in [1, 2, 3]],
+            pretty_variables=None,
+            debug=False,
+            gdb=False,
+            nb_background_builds=1,
+            background_build_cpus=[0, 1],
+        )
+        bench.run(other_campaigns_seconds=0, barrier=None, continuing=False)
+
+        events = bench.events
+        self.assertEqual([e for e in events if e[0] == "build"], [("build", a) for a in [1, 2, 3]])
+        self.assertEqual([e for e in events if e[0] == "run"], [("run", a) for a in [1, 2, 3]])
+        self.assertEqual(
+            [e for e in events if e[0] == "background"],
+            [("background", a, (0, 1), " -j 2 ") for a in [2, 3]],
+        )
+        for a in [2, 3]:
+            background_index = events.index(("background", a, (0, 1), " -j 2 "))
+            self.assertLess(events.index(("build", a - 1)), background_index)
+            self.assertLess(background_index, events.index(("build", a)))
+
+    @patch("sys.stdout", new_callable=StringIO)
+    def test_unsupported_background_builds(self, mock_stdout):
+        """Benchmarks without background builds fall back to the regular builds."""
+        bench = BenchmarkMock(tilt=TiltMock())
+        _, csv_path = tempfile.mkstemp(prefix="bench-", suffix=".csv")
+        bench.configure_variables(
+            experiment_name="{EXPERIMENT NAME}",
+            benchmark_name="{BENCHMARK NAME}",
+            csv_output_path=csv_path,
+            base_data_dir=None,
+            benchmark_duration_seconds=0,
+            nb_runs=1,
+            constants=None,
+            variables=[{"a": a, "b": 10 + a, "c": 20 + a} for a in [1, 2, 3]],
+            pretty_variables=None,
+            debug=False,
+            gdb=False,
+            nb_background_builds=2,
+            background_build_cpus=[0],
+        )
+        bench.run(other_campaigns_seconds=0, barrier=None, continuing=False)
+
+        output = mock_stdout.getvalue()
+        self.assertEqual(output.count("does not support background builds"), 1)
+        self.assertEqual(output.count("[BENCH] BUILD {'a'"), 3)
+        self.assertEqual(output.count("[BENCH] RUN"), 3)
+        self.assertEqual(bench.background_build_cpus(), [])
+
+    def test_background_build_cpus(self):
+        """The background builds run on CPUs of their own, out of the partitions of the runs."""
+
+        def configure(**kwargs):
+            bench = BackgroundBuildBenchmarkMock(tilt=TiltMock())
+            bench.configure_variables(
+                experiment_name="{EXPERIMENT NAME}",
+                benchmark_name="{BENCHMARK NAME}",
+                csv_output_path=tempfile.mkstemp(prefix="bench-", suffix=".csv")[1],
+                base_data_dir=None,
+                benchmark_duration_seconds=0,
+                nb_runs=1,
+                constants=None,
+                variables=[{"a": 1, "b": 11, "c": 21}],
+                pretty_variables=None,
+                debug=False,
+                gdb=False,
+                nb_background_builds=1,
+                **kwargs,
+            )
+            return bench
+
+        with self.assertRaises(ValueError):
+            configure()
+        with self.assertRaises(ValueError):
+            configure(background_build_cpus=[1, 2], concurrent_partitions=[[0], [1]])
+        bench = configure(background_build_cpus=[2, 3], concurrent_partitions=[[0], [1]])
+        self.assertEqual(bench.background_build_cpus(), [2, 3])
+
+        with patch.object(type(bench.platform), "nb_cpus", return_value=4):
+            bench = configure(concurrent_partitions=[[0], [1]])
+        self.assertEqual(bench.background_build_cpus(), [2, 3])
+
+
+class PartitionBenchmarkMock(BenchmarkMock):
+    """Mock of a benchmark checking that its runs overlap, each one on its own partition."""
+
+    def __init__(self, tilt, nb_partitions):
+        super().__init__(tilt=tilt)
+        self.lock = threading.Lock()
+        self.busy_partitions = set()
+        self.run_partitions = []
+        self.rendezvous = threading.Barrier(parties=nb_partitions, timeout=10)
+
+    def single_run(self, **kwargs) -> str:
+        partition = self.current_partition()
+        with self.lock:
+            assert partition.index not in self.busy_partitions
+            self.busy_partitions.add(partition.index)
+            self.run_partitions.append(partition.index)
+            output = super().single_run(**kwargs)
+        self.rendezvous.wait()  # only passes if the runs on all the partitions are concurrent
+        with self.lock:
+            self.busy_partitions.remove(partition.index)
+        return output
+
+
+class TestConcurrentPartitions(unittest.TestCase):
+    """Test suite of the records running concurrently on partitions of the platform."""
+
+    @patch("sys.stdout", new_callable=StringIO)
+    def test_concurrent_partitions(self, _mock_stdout):
+        """The records run concurrently, one per partition, and all their results are stored."""
+        bench = PartitionBenchmarkMock(tilt=TiltMock(), nb_partitions=2)
+        _, csv_path = tempfile.mkstemp(prefix="bench-", suffix=".csv")
+        bench.configure_variables(
+            experiment_name="{EXPERIMENT NAME}",
+            benchmark_name="{BENCHMARK NAME}",
+            csv_output_path=csv_path,
+            base_data_dir=None,
+            benchmark_duration_seconds=0,
+            nb_runs=1,
+            constants=None,
+            variables=[{"a": a, "b": 10 + a, "c": c} for a in [1, 2] for c in [21, 22]],
+            pretty_variables=None,
+            debug=False,
+            gdb=False,
+            concurrent_partitions=[[0], [1]],
+        )
+        self.assertIsNone(bench.current_partition())
+        bench.run(other_campaigns_seconds=0, barrier=None, continuing=False)
+
+        self.assertEqual(sorted(bench.run_partitions), [0, 0, 1, 1])
+        with open(csv_path, "r") as csv_file:
+            lines = [line for line in csv_file.read().split("\n") if line and line[0] != "#"]
+        header = lines[0].split(";")
+        self.assertEqual(len(lines), 1 + 4)
+        partition_column = header.index("run_partition")
+        self.assertEqual(
+            sorted(line.split(";")[partition_column] for line in lines[1:]),
+            ["0", "0", "1", "1"],
+        )
+        self.assertEqual(sorted(int(line.split(";")[-1]) for line in lines[1:]), [41, 42, 43, 44])
+
+
+
+class InProcessRepetitionsBenchmarkMock(BenchmarkMock):
+    """Mock of a benchmark running all the remaining repetitions of a record in one run."""
+
+    def in_process_repetitions(self) -> bool:
+        return True
+
+    def single_run(self, **kwargs) -> str:
+        output = super().single_run(**kwargs)
+        return f"{output};{kwargs['nb_repetitions']}"
+
+    def parse_output_to_results(  # pylint: disable=arguments-differ
+        self,
+        command_output: str,
+        **_kwargs,
+    ) -> RecordResult:
+        counter, nb_repetitions = map(int, command_output.split(";"))
+        return [{"rep": r, "out": 10 * counter + r} for r in range(1, nb_repetitions + 1)]
+
+
+class TestInProcessRepetitions(unittest.TestCase):
+    """Test suite of the repetitions of a record run in a single run of the benchmark."""
+
+    @staticmethod
+    def _run(csv_path: str, nb_runs: int, continuing: bool) -> str:
+        with patch("sys.stdout", new_callable=StringIO) as mock_stdout:
+            bench = InProcessRepetitionsBenchmarkMock(tilt=TiltMock())
+            bench.configure_variables(
+                experiment_name="{EXPERIMENT NAME}",
+                benchmark_name="{BENCHMARK NAME}",
+                csv_output_path=csv_path,
+                base_data_dir=None,
+                benchmark_duration_seconds=0,
+                nb_runs=nb_runs,
+                constants=None,
+                variables=[{"a": 1, "b": 11, "c": c} for c in [21, 22]],
+                pretty_variables=None,
+                debug=False,
+                gdb=False,
+            )
+            bench.run(other_campaigns_seconds=0, barrier=None, continuing=continuing)
+            return mock_stdout.getvalue()
+
+    def test_in_process_repetitions(self):
+        """Each record is run once, and the remaining repetitions of a continued one only."""
+        _, csv_path = tempfile.mkstemp(prefix="bench-", suffix=".csv")
+        output = self._run(csv_path=csv_path, nb_runs=3, continuing=False)
+        self.assertEqual(output.count("[BENCH] RUN"), 2)
+        self.assertIn("'nb_repetitions': 3", output)
+
+        output = self._run(csv_path=csv_path, nb_runs=5, continuing=True)
+        self.assertEqual(output.count("[CONTINUING]"), 6)
+        self.assertEqual(output.count("[BENCH] RUN"), 2)
+        self.assertIn("'nb_repetitions': 2", output)
+
+        with open(csv_path, "r") as csv_file:
+            lines = [line for line in csv_file.read().split("\n") if line and line[0] != "#"]
+        self.assertEqual(lines[0], "experiment_name;benchmark_name;a;c;b;rep;out")
+        self.assertEqual(
+            [[line.split(";")[k] for k in [3, 5, 6]] for line in lines[1:]],
+            [["21", "1", "411"], ["21", "2", "412"], ["21", "3", "413"]]
+            + [["22", "1", "421"], ["22", "2", "422"], ["22", "3", "423"]]
+            + [["21", "4", "411"], ["21", "5", "412"]]
+            + [["22", "4", "421"], ["22", "5", "422"]],
+        )
+
+    def test_missing_repetitions(self):
+        """The repetitions missing from the result file run, even if they are not the last ones."""
+        _, csv_path = tempfile.mkstemp(prefix="bench-", suffix=".csv")
+        self._run(csv_path=csv_path, nb_runs=4, continuing=False)
+        with open(csv_path, "r") as csv_file:
+            lines = csv_file.read().split("\n")
+        with open(csv_path, "w") as csv_file:  # drop the repetitions 2 and 4 of the first record
+            dropped = [["21", "11", "2"], ["21", "11", "4"]]
+            csv_file.write("\n".join(line for line in lines if line.split(";")[3:6] not in dropped))
+
+        output = self._run(csv_path=csv_path, nb_runs=4, continuing=True)
+        self.assertEqual(output.count("[BENCH] RUN"), 1)
+        self.assertIn("'nb_repetitions': 2", output)
+        with open(csv_path, "r") as csv_file:
+            lines = [line for line in csv_file.read().split("\n") if line and line[0] != "#"]
+        self.assertEqual(
+            sorted(line.split(";")[5] for line in lines[1:] if line.split(";")[3] == "21"),
+            ["1", "2", "3", "4"],
+        )
+
+    def test_convergence_rejected(self):
+        """The repetitions run in a single run cannot be stopped by a convergence criterion."""
+        bench = InProcessRepetitionsBenchmarkMock(tilt=TiltMock())
+        bench.configure_variables(
+            experiment_name="{EXPERIMENT NAME}",
+            benchmark_name="{BENCHMARK NAME}",
+            csv_output_path=tempfile.mkstemp(prefix="bench-", suffix=".csv")[1],
+            base_data_dir=None,
+            benchmark_duration_seconds=0,
+            nb_runs=5,
+            constants=None,
+            variables=[{"a": 1, "b": 11, "c": 21}],
+            pretty_variables=None,
+            debug=False,
+            gdb=False,
+            convergence=ConvergenceCriterion(metric="out", relative_ci=0.1),
+        )
+        with self.assertRaises(ValueError):
+            bench.run(other_campaigns_seconds=0, barrier=None, continuing=False)
+
+
+
+class ThreadColumnsBenchmarkMock(BenchmarkMock):
+    """Mock of a benchmark reporting one thread_<k> column per thread, c - 20 threads."""
+
+    def __init__(self, tilt):
+        super().__init__(tilt=tilt)
+        self._post_run_hooks = [lambda **_kwargs: {"hook": "h"}]
+
+    def parse_output_to_results(  # pylint: disable=arguments-differ
+        self,
+        command_output: str,
+        run_variables,
+        **_kwargs,
+    ) -> RecordResult:
+        nb_threads = run_variables["c"] - 20
+        result_dict = {f"thread_{k}": k for k in range(nb_threads)}
+        result_dict["out"] = int(command_output)
+        return result_dict
+
+
+class TestThreadColumns(unittest.TestCase):
+    """Test suite of the per-thread columns in the result file."""
+
+    @patch("sys.stdout", new_callable=StringIO)
+    def test_thread_columns_last(self, _mock_stdout):
+        """The thread_<k> columns come after the columns added by the hooks."""
+        bench = ThreadColumnsBenchmarkMock(tilt=TiltMock())
+        _, csv_path = tempfile.mkstemp(prefix="bench-", suffix=".csv")
+        bench.configure_variables(
+            experiment_name="{EXPERIMENT NAME}",
+            benchmark_name="{BENCHMARK NAME}",
+            csv_output_path=csv_path,
+            base_data_dir=None,
+            benchmark_duration_seconds=0,
+            nb_runs=1,
+            constants=None,
+            variables=[{"a": 1, "b": 11, "c": c} for c in [21, 22]],
+            pretty_variables=None,
+            debug=False,
+            gdb=False,
+        )
+        bench.run(other_campaigns_seconds=0, barrier=None, continuing=False)
+
+        with open(csv_path, "r") as csv_file:
+            lines = [line for line in csv_file.read().split("\n") if line and line[0] != "#"]
+        header = lines[0].split(";")
+        self.assertEqual(
+            header[:8],
+            ["experiment_name", "benchmark_name", "a", "c", "b", "rep", "out", "hook"],
+        )
+        self.assertTrue(all(c.startswith("thread_") for c in header[8:]))
+        self.assertEqual(lines[1].split(";")[6:], ["41", "h", "0"])
+        self.assertEqual(lines[2].split(";")[6:], ["42", "h", "0", "1"])
+
+
+class ConvergenceBenchmarkMock(BenchmarkMock):
+    """Mock of a benchmark whose metric is stable for c = 21 and noisy for c = 22."""
+
+    def parse_output_to_results(  # pylint: disable=arguments-differ
+        self,
+        command_output: str,
+        run_variables,
+        **_kwargs,
+    ) -> RecordResult:
+        counter = int(command_output)
+        metric = 100 if run_variables["c"] == 21 else 100 * (counter % 2) + 1
+        return {"out": counter, "metric": metric}
+
+
+class ZeroMetricBenchmarkMock(BenchmarkMock):
+    """Mock of a benchmark whose metric is 0 in the first run of each campaign, then 100."""
+
+    def parse_output_to_results(  # pylint: disable=arguments-differ
+        self,
+        command_output: str,
+        **_kwargs,
+    ) -> RecordResult:
+        counter = int(command_output)
+        return {"out": counter, "metric": 0 if counter == 41 else 100}
+
+
+class TestConvergence(unittest.TestCase):
+    """Test suite of the runs of the configurations that stop on convergence."""
+
+    @staticmethod
+    def _run(csv_path: str, convergence, continuing: bool, nb_runs: int = 6) -> str:
+        with patch("sys.stdout", new_callable=StringIO) as mock_stdout:
+            bench = ConvergenceBenchmarkMock(tilt=TiltMock())
+            bench.configure_variables(
+                experiment_name="{EXPERIMENT NAME}",
+                benchmark_name="{BENCHMARK NAME}",
+                csv_output_path=csv_path,
+                base_data_dir=None,
+                benchmark_duration_seconds=0,
+                nb_runs=nb_runs,
+                constants=None,
+                variables=[{"a": 1, "b": 11, "c": c} for c in [21, 22]],
+                pretty_variables=None,
+                debug=False,
+                gdb=False,
+                convergence=convergence,
+            )
+            bench.run(other_campaigns_seconds=0, barrier=None, continuing=continuing)
+            return mock_stdout.getvalue()
+
+    @staticmethod
+    def _lines(csv_path: str):
+        with open(csv_path, "r") as csv_file:
+            lines = [line for line in csv_file.read().split("\n") if line and line[0] != "#"]
+        header = lines[0].split(";")
+        return [dict(zip(header, line.split(";"))) for line in lines[1:]]
+
+    def test_convergence(self):
+        """A stable configuration stops after the minimal runs, a noisy one runs nb_runs times."""
+        _, csv_path = tempfile.mkstemp(prefix="bench-", suffix=".csv")
+        convergence = ConvergenceCriterion(metric="metric", relative_ci=0.05, min_runs=3)
+        output = self._run(csv_path=csv_path, convergence=convergence, continuing=False)
+        self.assertEqual(output.count("[BENCH] RUN"), 3 + 6)
+        self.assertEqual(output.count("converged after 3 runs"), 1)
+
+        lines = self._lines(csv_path=csv_path)
+        self.assertEqual([line["c"] for line in lines], ["21"] * 3 + ["22"] * 6)
+        self.assertEqual(
+            [line["metric_converged"] for line in lines],
+            ["False", "False", "True"] + ["False"] * 6,
+        )
+        self.assertEqual(lines[0]["metric_rel_ci"], "inf")
+        self.assertEqual(float(lines[2]["metric_rel_ci"]), 0.0)
+        self.assertGreater(float(lines[-1]["metric_rel_ci"]), 0.05)
+
+    def test_continuing_convergence(self):
+        """The cached runs of a continued campaign count towards the convergence."""
+        _, csv_path = tempfile.mkstemp(prefix="bench-", suffix=".csv")
+        convergence = ConvergenceCriterion(metric="metric", relative_ci=0.05, min_runs=3)
+        self._run(csv_path=csv_path, convergence=convergence, continuing=False, nb_runs=2)
+        output = self._run(csv_path=csv_path, convergence=convergence, continuing=True)
+        self.assertEqual(output.count("[CONTINUING]"), 2 + 2)
+        self.assertEqual(output.count("[BENCH] RUN"), 1 + 4)
+
+    def test_continuing_zero_metric(self):
+        """A cached value of 0 of the metric counts towards the convergence."""
+        _, csv_path = tempfile.mkstemp(prefix="bench-", suffix=".csv")
+        convergence = ConvergenceCriterion(metric="metric", relative_ci=0.05, min_runs=3)
+        for nb_runs, continuing in [(1, False), (3, True)]:
+            with patch("sys.stdout", new_callable=StringIO):
+                bench = ZeroMetricBenchmarkMock(tilt=TiltMock())
+                bench.configure_variables(
+                    experiment_name="{EXPERIMENT NAME}",
+                    benchmark_name="{BENCHMARK NAME}",
+                    csv_output_path=csv_path,
+                    base_data_dir=None,
+                    benchmark_duration_seconds=0,
+                    nb_runs=nb_runs,
+                    constants=None,
+                    variables=[{"a": 1, "b": 11, "c": 21}],
+                    pretty_variables=None,
+                    debug=False,
+                    gdb=False,
+                    convergence=convergence,
+                )
+                bench.run(other_campaigns_seconds=0, barrier=None, continuing=continuing)
+
+        lines = self._lines(csv_path=csv_path)
+        self.assertEqual([line["metric"] for line in lines], ["0", "0", "100"])
+        self.assertEqual(
+            float(lines[-1]["metric_rel_ci"]),
+            convergence.relative_half_width(values=[0.0, 0.0, 100.0]),
+        )
+
+
+class TestParquetOutput(unittest.TestCase):
+    """Test suite of the Parquet dataset written alongside the CSV file."""
+
+    @staticmethod
+    def _run(csv_path: str, parquet_row_group_size, continuing: bool, nb_runs: int = 2) -> None:
+        with patch("sys.stdout", new_callable=StringIO):
+            bench = ThreadColumnsBenchmarkMock(tilt=TiltMock())
+            bench.configure_variables(
+                experiment_name="{EXPERIMENT NAME}",
+                benchmark_name="{BENCHMARK NAME}",
+                csv_output_path=csv_path,
+                base_data_dir=None,
+                benchmark_duration_seconds=0,
+                nb_runs=nb_runs,
+                constants=None,
+                variables=[{"a": 1, "b": 11, "c": c} for c in [21, 22]],
+                pretty_variables=None,
+                debug=False,
+                gdb=False,
+                parquet_row_group_size=parquet_row_group_size,
+            )
+            bench.run(other_campaigns_seconds=0, barrier=None, continuing=continuing)
+
+    def test_no_parquet_output(self):
+        """Without a row group size, only the CSV file is written."""
+        csv_path = pathlib.Path(tempfile.mkdtemp()) / "bench.csv"
+        self._run(csv_path=csv_path, parquet_row_group_size=None, continuing=False)
+        self.assertTrue(csv_path.exists())
+        self.assertFalse(parquet_dataset_path(csv_output_path=csv_path).exists())
+
+    @unittest.skipUnless(importlib.util.find_spec("pyarrow"), "pyarrow is not installed")
+    def test_parquet_output(self):
+        """The dataset holds the lines of the CSV file, the header and the continued runs."""
+        # pylint: disable=import-outside-toplevel
+        from benchkit.utils.parquetsink import read_columns, read_metadata
+
+        csv_path = pathlib.Path(tempfile.mkdtemp()) / "bench.csv"
+        dataset_path = parquet_dataset_path(csv_output_path=csv_path)
+        self._run(csv_path=csv_path, parquet_row_group_size=3, continuing=False)
+
+        df = read_columns(pathname=dataset_path, columns=["c", "out", "thread_1"])
+        self.assertEqual(list(df["c"]), [21, 21, 22, 22])
+        self.assertEqual(list(df["out"]), [41, 41, 42, 42])
+        self.assertEqual(list(df["thread_1"].fillna(-1)), [-1, -1, 1, 1])
+        metadata = read_metadata(pathname=dataset_path)
+        self.assertEqual(metadata["nb_runs"], "2")
+        self.assertEqual(metadata["benchmark_campaign_name"], "{EXPERIMENT NAME}")
+
+        self.assertEqual(len(list(dataset_path.glob("part-0000-*.parquet"))), 2)
+
+        self._run(csv_path=csv_path, parquet_row_group_size=3, continuing=True, nb_runs=3)
+        self.assertEqual(len(list(dataset_path.glob("part-0001-*.parquet"))), 1)
+        self.assertEqual(len(read_columns(pathname=dataset_path, columns=["out"])), 6)
+
+
 if __name__ == "__main__":
     unittest.main()
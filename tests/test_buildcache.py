@@ -0,0 +1,115 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Module for testing the content-addressed cache of benchmark builds.
+"""
+
+import pathlib
+import tempfile
+import unittest
+from unittest.mock import patch
+
+from benchkit.platforms import get_current_platform
+from benchkit.utils.buildcache import BuildCache, hash_source_tree, toolchain_fingerprint
+
+
+class TestBuildCache(unittest.TestCase):
+    """Tests of the build cache and of the source tree hash."""
+
+    def setUp(self):
+        self._tmp_dir = tempfile.TemporaryDirectory()
+        self.root = pathlib.Path(self._tmp_dir.name)
+        self.src = self.root / "src"
+        (self.src / "include").mkdir(parents=True)
+        (self.src / "main.c").write_text("int main(void) { return 0; }\n")
+        (self.src / "include" / "config.h").write_text("#define N 1\n")
+
+    def tearDown(self):
+        self._tmp_dir.cleanup()
+
+    def test_source_hash(self):
+        """The hash follows the content and the names of the files, not their timestamps."""
+        initial = hash_source_tree(source_paths=[self.src])
+        (self.src / "main.c").touch()
+        self.assertEqual(hash_source_tree(source_paths=[self.src]), initial)
+
+        (self.src / "include" / "config.h").write_text("#define N 2\n")
+        modified = hash_source_tree(source_paths=[self.src])
+        self.assertNotEqual(modified, initial)
+
+        (self.src / "include" / "config.h").rename(self.src / "include" / "other.h")
+        self.assertNotEqual(hash_source_tree(source_paths=[self.src]), modified)
+
+    def test_excluded_dirs(self):
+        """The excluded directories, e.g. the build directories, are not hashed."""
+        initial = hash_source_tree(source_paths=[self.src], excluded_dirnames=["build"])
+        (self.src / "build").mkdir()
+        (self.src / "build" / "main.o").write_text("object")
+        self.assertEqual(
+            hash_source_tree(source_paths=[self.src], excluded_dirnames=["build"]),
+            initial,
+        )
+
+    def test_key(self):
+        """The key depends on the sources, the build variables and the toolchain only."""
+        toolchain = {"cc": "gcc 12"}
+        key = BuildCache.key(source_hash="s", build_variables={"a": 1, "b": 2}, toolchain=toolchain)
+        self.assertEqual(
+            BuildCache.key(source_hash="s", build_variables={"b": 2, "a": 1}, toolchain=toolchain),
+            key,
+        )
+        self.assertNotEqual(
+            BuildCache.key(source_hash="t", build_variables={"a": 1, "b": 2}, toolchain=toolchain),
+            key,
+        )
+        self.assertNotEqual(
+            BuildCache.key(source_hash="s", build_variables={"a": 1, "b": 3}, toolchain=toolchain),
+            key,
+        )
+        self.assertNotEqual(
+            BuildCache.key(
+                source_hash="s", build_variables={"a": 1, "b": 2}, toolchain={"cc": "gcc 13"}
+            ),
+            key,
+        )
+
+    def test_entries(self):
+        """A variant is cached only once marked as built, and an incomplete build starts over."""
+        cache = BuildCache(cache_dir=self.root / "cache")
+        key = BuildCache.key(source_hash="s", build_variables={"a": 1}, toolchain={})
+        self.assertFalse(cache.is_built(key))
+        self.assertEqual(cache.keys(), [])
+
+        build_dir = cache.start_build(key)
+        (build_dir / "partial.o").write_text("object")
+        build_dir = cache.start_build(key)
+        self.assertEqual(list(build_dir.iterdir()), [])
+
+        (build_dir / "bench").write_text("binary")
+        cache.mark_built(key=key, description={"a": 1})
+        self.assertTrue(cache.is_built(key))
+        self.assertEqual(cache.keys(), [key])
+        self.assertEqual(cache.build_dir(key), build_dir)
+        self.assertEqual(cache.description(key), {"a": 1})
+        self.assertTrue((build_dir / "bench").is_file())
+
+    def test_toolchain_environment(self):
+        """The toolchain variables are the ones of the platform, not of the benchkit process."""
+        platform = get_current_platform()
+
+        def shell(command, **kwargs):
+            if command == ["env"]:
+                return "HOME=/home/user\nCC=clang\nCFLAGS=-O3 -march=native\n"
+            return f"{command[0]} 1.0\n"
+
+        with patch.object(platform.comm, "shell", side_effect=shell):
+            with patch.dict("os.environ", {"CC": "gcc", "CXX": "g++"}):
+                toolchain = toolchain_fingerprint(platform=platform, commands=["cc"])
+        self.assertEqual(toolchain["cc"], "cc 1.0")
+        self.assertEqual(toolchain["CC"], "clang")
+        self.assertEqual(toolchain["CFLAGS"], "-O3 -march=native")
+        self.assertEqual(toolchain["CXX"], "")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,56 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Module for testing the convergence criterion of the runs of a configuration.
+"""
+
+import math
+import unittest
+
+from benchkit.utils.convergence import ConvergenceCriterion, student_t_quantile
+
+
+class TestConvergence(unittest.TestCase):
+    """Tests of the Student's t quantiles and of the convergence criterion."""
+
+    def test_student_t_quantile(self):
+        """The quantiles match the tables of the Student's t-distribution."""
+        for p, df, expected in [
+            (0.975, 1, 12.706),
+            (0.975, 2, 4.303),
+            (0.975, 9, 2.262),
+            (0.995, 4, 4.604),
+            (0.95, 30, 1.697),
+        ]:
+            self.assertAlmostEqual(student_t_quantile(p=p, df=df), expected, places=3)
+
+    def test_relative_half_width(self):
+        """The half-width of the t-interval of the mean is relative to the mean."""
+        criterion = ConvergenceCriterion(metric="m", relative_ci=0.05)
+        values = [98.0, 100.0, 102.0]  # mean 100, standard deviation 2
+        expected = 4.303 * 2 / math.sqrt(3) / 100
+        self.assertAlmostEqual(criterion.relative_half_width(values=values), expected, places=4)
+        self.assertEqual(criterion.relative_half_width(values=[5.0]), math.inf)
+        self.assertEqual(criterion.relative_half_width(values=[5.0, 5.0]), 0.0)
+        self.assertEqual(criterion.relative_half_width(values=[-1.0, 1.0]), math.inf)
+
+    def test_is_converged(self):
+        """The criterion needs the minimal number of runs and a narrow enough interval."""
+        criterion = ConvergenceCriterion(metric="m", relative_ci=0.05, min_runs=3)
+        self.assertFalse(criterion.is_converged(values=[100.0, 100.0]))
+        self.assertTrue(criterion.is_converged(values=[100.0, 100.0, 100.0]))
+        self.assertTrue(criterion.is_converged(values=[98.0, 100.0, 102.0]))
+        self.assertFalse(criterion.is_converged(values=[50.0, 100.0, 150.0]))
+
+    def test_invalid_criterion(self):
+        """The ill-formed criteria are rejected."""
+        with self.assertRaises(ValueError):
+            ConvergenceCriterion(metric="m", relative_ci=0)
+        with self.assertRaises(ValueError):
+            ConvergenceCriterion(metric="m", relative_ci=0.05, confidence=1)
+        with self.assertRaises(ValueError):
+            ConvergenceCriterion(metric="m", relative_ci=0.05, min_runs=1)
+
+
+if __name__ == "__main__":
+    unittest.main()
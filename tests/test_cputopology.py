@@ -0,0 +1,75 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Module for testing the CPU orders derived from the topology of the platform.
+"""
+
+import unittest
+
+from benchkit.platforms.utils import (
+    CpuLocation,
+    compact_cpu_order,
+    parse_lscpu_topology,
+    smt_cpu_order,
+)
+
+# 2 nodes of 2 cores with 2 hyperthreads, siblings numbered apart (e.g. most x86 servers)
+LSCPU_SIBLINGS_APART = """
+# The following is the parsable format, which can be fed to other
+# programs. Each different item in every column has an unique ID
+# starting usually from zero.
+# CPU,Core,Socket,Node
+0,0,0,0
+1,1,0,0
+2,2,1,1
+3,3,1,1
+4,0,0,0
+5,1,0,0
+6,2,1,1
+7,3,1,1
+"""
+
+# same topology, siblings numbered adjacently (e.g. some Power or Arm servers)
+LSCPU_SIBLINGS_ADJACENT = """
+# CPU,Core,Socket,Node
+0,0,0,0
+1,0,0,0
+2,1,0,0
+3,1,0,0
+4,2,1,1
+5,2,1,1
+6,3,1,1
+7,3,1,1
+"""
+
+
+class TestCpuTopology(unittest.TestCase):
+    """Tests of the CPU orders derived from the topology."""
+
+    def test_parse(self):
+        """Each CPU is located in its package, node and core; a missing node is node 0."""
+        topology = parse_lscpu_topology(lscpu_output=LSCPU_SIBLINGS_APART)
+        self.assertEqual(len(topology), 8)
+        self.assertEqual(topology[6], CpuLocation(package=1, node=1, core=2))
+        self.assertEqual(
+            parse_lscpu_topology(lscpu_output="0,0,0,\n"),
+            {0: CpuLocation(package=0, node=0, core=0)},
+        )
+
+    def test_compact(self):
+        """The cores of a node come first, whatever the numbering of the siblings."""
+        apart = parse_lscpu_topology(lscpu_output=LSCPU_SIBLINGS_APART)
+        self.assertEqual(compact_cpu_order(topology=apart), [0, 1, 2, 3, 4, 5, 6, 7])
+        adjacent = parse_lscpu_topology(lscpu_output=LSCPU_SIBLINGS_ADJACENT)
+        self.assertEqual(compact_cpu_order(topology=adjacent), [0, 2, 4, 6, 1, 3, 5, 7])
+
+    def test_smt(self):
+        """The siblings of a core come first, whatever their numbering."""
+        apart = parse_lscpu_topology(lscpu_output=LSCPU_SIBLINGS_APART)
+        self.assertEqual(smt_cpu_order(topology=apart), [0, 4, 1, 5, 2, 6, 3, 7])
+        adjacent = parse_lscpu_topology(lscpu_output=LSCPU_SIBLINGS_ADJACENT)
+        self.assertEqual(smt_cpu_order(topology=adjacent), [0, 1, 2, 3, 4, 5, 6, 7])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,168 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Module for testing the native benchmark harness and the parsing of its result lines.
+"""
+
+import pathlib
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+from benchkit.benchmark import Benchmark, parse_harness_output
+from benchkit.utils.dir import benchkit_include_dir
+
+HARNESS_PROGRAM = r"""
+#include <benchkit/harness.h>
+#include <pthread.h>
+
+#define NB_THREADS 4
+#define NB_OPS 1000
+
+static bk_barrier_t barrier;
+static bk_slot_t slots[NB_THREADS];
+static bk_hist_t hists[NB_THREADS];
+
+static void *worker(void *arg) {
+    const unsigned k = (unsigned) (size_t) arg;
+    bk_barrier_wait(&barrier);
+    for (uint64_t i = 1; i <= NB_OPS; ++i) {
+        bk_slot_record(&slots[k], i);
+        bk_hist_record(&hists[k], i);
+    }
+    return NULL;
+}
+
+int main(void) {
+    pthread_t threads[NB_THREADS];
+    bk_barrier_init(&barrier, NB_THREADS);
+    for (size_t k = 0; k < NB_THREADS; ++k) {
+        bk_slot_init(&slots[k]);
+        bk_hist_init(&hists[k]);
+        pthread_create(&threads[k], NULL, worker, (void *) k);
+    }
+    bk_hist_t total;
+    bk_hist_init(&total);
+    uint64_t global_count = 0;
+    for (unsigned k = 0; k < NB_THREADS; ++k) {
+        pthread_join(threads[k], NULL);
+        global_count += bk_slot_count(&slots[k]);
+        bk_hist_merge(&total, &hists[k]);
+        bk_emit_thread_u64(k, slots[k].count);
+    }
+    printf("unrelated output=1\n");
+    bk_emit_u64("global_count", global_count);
+    bk_emit_double("ticks_positive", bk_ticks_calibrate() > 0.0 ? 1.0 : 0.0);
+    bk_emit_str("lock", "none");
+    bk_emit_hist("lat", &total, 1.0);
+    return 0;
+}
+"""
+
+
+class NoParserBenchmark(Benchmark):
+    """Benchmark relying on the default output parser."""
+
+    def __init__(self):
+        super().__init__(
+            command_wrappers=[],
+            command_attachments=[],
+            shared_libs=[],
+            pre_run_hooks=[],
+            post_run_hooks=[],
+        )
+
+    @property
+    def bench_src_path(self):
+        return "."
+
+    @staticmethod
+    def get_build_var_names():
+        return []
+
+    @staticmethod
+    def get_run_var_names():
+        return []
+
+
+class TestHarness(unittest.TestCase):
+    """Tests of the harness result lines."""
+
+    def test_parse_harness_output(self):
+        """Only the result lines are parsed, their values converted, the last value winning."""
+        output = "\n".join(
+            [
+                "starting",
+                "[benchkit] global_count=42",
+                "[benchkit] throughput=1.5e3",
+                "[benchkit] lock=caslock",
+                "key=7;not=harness",
+                "[benchkit] global_count=43",
+                "[benchkit] malformed",
+            ]
+        )
+        result = parse_harness_output(command_output=output)
+        self.assertEqual(result, {"global_count": 43, "throughput": 1500.0, "lock": "caslock"})
+
+    def test_default_parser(self):
+        """The default parser reads the harness lines, and fails on other outputs."""
+        benchmark = NoParserBenchmark()
+        result = benchmark.parse_output_to_results(
+            command_output="[benchkit] thread_0=12\n",
+            build_variables={},
+            run_variables={},
+            benchmark_duration_seconds=1,
+            record_data_dir=None,
+        )
+        self.assertEqual(result, {"thread_0": 12})
+        with self.assertRaises(NotImplementedError):
+            benchmark.parse_output_to_results(
+                command_output="Final counter value: 12\n",
+                build_variables={},
+                run_variables={},
+                benchmark_duration_seconds=1,
+                record_data_dir=None,
+            )
+
+    def _run_program(self, compiler: str, source_name: str) -> dict:
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            source = pathlib.Path(tmp_dir) / source_name
+            binary = pathlib.Path(tmp_dir) / "harness"
+            source.write_text(HARNESS_PROGRAM)
+            subprocess.run(
+                [compiler, "-O2", "-Wall", "-Werror", "-pthread", f"-I{benchkit_include_dir()}"]
+                + [str(source), "-o", str(binary)],
+                check=True,
+            )
+            output = subprocess.run(
+                [str(binary)], check=True, capture_output=True, text=True
+            ).stdout
+        return parse_harness_output(command_output=output)
+
+    def _check_program_results(self, result: dict) -> None:
+        self.assertEqual(result["global_count"], 4000)
+        self.assertEqual([result[f"thread_{k}"] for k in range(4)], [1000] * 4)
+        self.assertEqual(result["ticks_positive"], 1.0)
+        self.assertEqual(result["lock"], "none")
+        self.assertEqual(result["lat_count"], 4000)
+        self.assertAlmostEqual(result["lat_mean_ns"], 500.5)
+        self.assertEqual(result["lat_max_ns"], 1000.0)
+        # lower bound of the bucket, within 1/16 of the exact percentile
+        self.assertLessEqual(result["lat_p50_ns"], 500.0)
+        self.assertGreaterEqual(result["lat_p50_ns"], 500.0 * 15 / 16)
+        self.assertNotIn("output", result)
+
+    @unittest.skipIf(shutil.which("cc") is None, "no C compiler")
+    def test_c_program(self):
+        """The harness compiles as C and emits the expected results."""
+        self._check_program_results(self._run_program(compiler="cc", source_name="harness.c"))
+
+    @unittest.skipIf(shutil.which("c++") is None, "no C++ compiler")
+    def test_cpp_program(self):
+        """The harness compiles as C++ and emits the expected results."""
+        self._check_program_results(self._run_program(compiler="c++", source_name="harness.cpp"))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,177 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Module for testing the monitor of the system noise.
+"""
+
+import os
+import signal
+import subprocess
+import time
+import unittest
+from unittest.mock import patch
+
+from benchkit.helpers.linux.noisemonitor import FILENAME_NOISE_SAMPLES, NoiseMonitor
+
+INTERRUPTS = """
+           CPU0       CPU1       CPU3
+  0:         44          0          1   IO-APIC   2-edge      timer
+  8:          0          1          0   IO-APIC   8-edge      rtc0
+NMI:          2          3          0   Non-maskable interrupts
+LOC:     100000      90000         10   Local timer interrupts
+ERR:          0
+MIS:          0
+""".lstrip(
+    "\n"
+)
+
+SOFTIRQS = """
+                    CPU0       CPU1       CPU3
+          HI:          1          0          0
+       TIMER:      75110      60000         20
+""".lstrip(
+    "\n"
+)
+
+SCHEDSTAT = """
+version 15
+timestamp 4295450498
+cpu0 0 0 1000 400 500 300 123456789 987654 2500
+domain0 3 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0
+cpu1 0 0 2000 800 900 600 223456789 887654 3500
+""".lstrip(
+    "\n"
+)
+
+
+def _sample(time_ns, counters, freq_khz):
+    return {
+        cpu: {
+            "time_ns": time_ns,
+            "interrupts": value,
+            "softirqs": 2 * value,
+            "context_switches": None,
+            "throttle_count": 0,
+            "freq_khz": freq_khz,
+        }
+        for cpu, value in counters.items()
+    }
+
+
+class TestNoiseMonitor(unittest.TestCase):
+    """Tests of the parsing and of the summary of the noise counters."""
+
+    def test_per_cpu_table(self):
+        """The counts of all the sources are summed per CPU, the system-wide ones ignored."""
+        self.assertEqual(
+            NoiseMonitor.parse_per_cpu_table(text=INTERRUPTS),
+            {0: 100046, 1: 90004, 3: 11},
+        )
+        self.assertEqual(
+            NoiseMonitor.parse_per_cpu_table(text=SOFTIRQS),
+            {0: 75111, 1: 60000, 3: 20},
+        )
+        self.assertEqual(NoiseMonitor.parse_per_cpu_table(text=""), {})
+
+    def test_schedstat(self):
+        """The context switches of each CPU are the timeslices run on it."""
+        self.assertEqual(NoiseMonitor.parse_schedstat(text=SCHEDSTAT), {0: 2500, 1: 3500})
+
+    def test_summary(self):
+        """The summary gives the increments of the counters and the frequencies on the CPUs."""
+        samples = [
+            _sample(time_ns=0, counters={0: 10, 1: 100}, freq_khz=2000000),
+            _sample(time_ns=1, counters={0: 15, 1: 200}, freq_khz=1000000),
+            _sample(time_ns=2, counters={0: 30, 1: 400}, freq_khz=3000000),
+        ]
+        self.assertEqual(
+            NoiseMonitor.summary(samples=samples, cpus=[0]),
+            {
+                "noise_interrupts": 20,
+                "noise_softirqs": 40,
+                "noise_throttle_events": 0,
+                "noise_min_freq_mhz": 1000,
+                "noise_mean_freq_mhz": 2000,
+            },
+        )
+        summary = NoiseMonitor.summary(samples=samples, cpus=[0, 1])
+        self.assertEqual(summary["noise_interrupts"], 320)
+        self.assertEqual(NoiseMonitor.summary(samples=samples[:1], cpus=[0]), {})
+
+    def test_hooks(self):
+        """The hooks around a run store the time series of the CPUs and return the summary."""
+        monitor = NoiseMonitor(cpus=[0])
+        files = {}
+
+        def write_record_file(file_content, filename):
+            files[filename] = file_content
+
+        monitor.pre_run_hook(build_variables={}, run_variables={}, record_data_dir=None)
+        summary = monitor.post_run_hook_update_results(
+            experiment_results_lines=[{"out": 1}],
+            record_data_dir=None,
+            write_record_file_fun=write_record_file,
+        )
+
+        lines = files[FILENAME_NOISE_SAMPLES].splitlines()
+        self.assertEqual(
+            lines[0],
+            "time_ns,cpu,interrupts,softirqs,context_switches,throttle_count,freq_khz",
+        )
+        self.assertEqual([line.split(",")[1] for line in lines[1:]], ["0", "0"])
+        self.assertGreaterEqual(summary["noise_interrupts"], 0)
+
+    def test_sampled_cpus(self):
+        """The counters of the CPUs that are not monitored are not read."""
+        monitor = NoiseMonitor(cpus=[1])
+        read_paths = []
+
+        def read(path):
+            read_paths.append(path)
+            return {
+                "/proc/interrupts": INTERRUPTS,
+                "/proc/softirqs": SOFTIRQS,
+                "/proc/schedstat": SCHEDSTAT,
+            }.get(path, "")
+
+        with patch.object(monitor, "_read", side_effect=read):
+            sample = monitor.sample()
+        self.assertEqual(list(sample), [1])
+        self.assertEqual(sample[1]["interrupts"], 90004)
+        self.assertEqual(sample[1]["context_switches"], 3500)
+        sysfs_paths = [path for path in read_paths if path.startswith("/sys/")]
+        self.assertTrue(sysfs_paths)
+        self.assertTrue(all(p.startswith("/sys/devices/system/cpu/cpu1/") for p in sysfs_paths))
+
+    def test_move_sampler(self):
+        """The sampling thread leaves the monitored CPUs, unless it has no other CPU."""
+        with patch("os.sched_getaffinity", return_value={0, 1, 2, 3}), patch(
+            "os.sched_setaffinity"
+        ) as set_affinity:
+            NoiseMonitor._move_sampler(monitored_cpus=[0, 1])
+            set_affinity.assert_called_once_with(0, {2, 3})
+            set_affinity.reset_mock()
+            NoiseMonitor._move_sampler(monitored_cpus=[0, 1, 2, 3])
+            set_affinity.assert_not_called()
+
+    def test_pinned_cpus_of_children(self):
+        """The threads of the child processes (e.g. run by a wrapper) are observed as well."""
+        wrapper = subprocess.Popen(["sh", "-c", "sleep 10 & wait"], start_new_session=True)
+        try:
+            time.sleep(0.2)
+
+            def affinity(tid):
+                with open(f"/proc/{tid}/comm", "r") as comm_file:
+                    is_benchmark = comm_file.read().strip() == "sleep"
+                return {1} if is_benchmark else {0, 1}
+
+            with patch("os.sched_getaffinity", side_effect=affinity):
+                pinned_cpus = NoiseMonitor._pinned_cpus(pid=wrapper.pid, all_cpus={0, 1})
+            self.assertEqual(pinned_cpus, {1})
+        finally:
+            os.killpg(wrapper.pid, signal.SIGKILL)
+            wrapper.wait()
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,153 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Module for testing the Parquet output of the results.
+"""
+
+import importlib.util
+import pathlib
+import tempfile
+import unittest
+
+from benchkit.utils.parquetsink import (
+    ParquetSink,
+    comment_metadata,
+    is_parquet_path,
+    parquet_dataset_path,
+    read_columns,
+    read_metadata,
+)
+
+_PYARROW_ENABLED = importlib.util.find_spec("pyarrow") is not None
+
+
+class TestParquetPaths(unittest.TestCase):
+    """Tests of the paths and of the metadata of the Parquet datasets."""
+
+    def test_dataset_path(self):
+        """The dataset is next to the CSV file, with the same name."""
+        path = parquet_dataset_path(csv_output_path="/tmp/results/benchmark_x_20240101.csv")
+        self.assertEqual(path, pathlib.Path("/tmp/results/benchmark_x_20240101.parquet"))
+        self.assertTrue(is_parquet_path(pathname=path))
+        self.assertFalse(is_parquet_path(pathname="/tmp/results/benchmark_x_20240101.csv"))
+
+    def test_comment_metadata(self):
+        """The metadata are the "key: value" comment lines of the CSV header."""
+        comments = (
+            "# benchmark_campaign_name: locks\n"
+            "# nb_runs: 3\n"
+            "# kernel: Linux host 6.1.0 #1 SMP x86_64 GNU/Linux\n"
+            "# Continuing campaign execution\n"
+        )
+        self.assertEqual(
+            comment_metadata(comments=comments),
+            {
+                "benchmark_campaign_name": "locks",
+                "nb_runs": "3",
+                "kernel": "Linux host 6.1.0 #1 SMP x86_64 GNU/Linux",
+            },
+        )
+
+
+@unittest.skipUnless(_PYARROW_ENABLED, "pyarrow is not installed")
+class TestParquetSink(unittest.TestCase):
+    """Tests of the writing of the result lines in the files of the dataset."""
+
+    @staticmethod
+    def _dataset_dir() -> pathlib.Path:
+        return pathlib.Path(tempfile.mkdtemp()) / "results.parquet"
+
+    def test_append_flush(self):
+        """The lines are written every row group size, with thread columns and header metadata."""
+        import pyarrow.parquet as pq  # pylint: disable=import-outside-toplevel
+
+        dataset_dir = self._dataset_dir()
+        sink = ParquetSink(
+            dataset_path=dataset_dir,
+            metadata={"nb_runs": "3"},
+            row_group_size=2,
+            nb_thread_columns=4,
+        )
+        sink.append(row={"lock": "cas", "out": 1, "thread_0": 1})
+        self.assertEqual(list(dataset_dir.glob("*.parquet")), [])
+        sink.append(row={"lock": "ttas", "out": 2, "thread_0": 1, "thread_1": 1})
+        sink.append(row={"lock": "ticket", "out": 3})
+        self.assertEqual(len(list(dataset_dir.glob("*.parquet"))), 1)
+        sink.close()
+
+        files = sorted(dataset_dir.glob("part-*.parquet"))
+        self.assertEqual(len(files), 2)
+        first_file = pq.ParquetFile(files[0])
+        self.assertEqual(first_file.metadata.num_row_groups, 1)
+        self.assertEqual(
+            first_file.schema_arrow.names,
+            ["lock", "out", "thread_0", "thread_1", "thread_2", "thread_3"],
+        )
+        self.assertEqual(read_metadata(pathname=dataset_dir)["nb_runs"], "3")
+
+        df = read_columns(pathname=dataset_dir, columns=["lock", "thread_1", "missing"])
+        self.assertEqual(list(df.columns), ["lock", "thread_1"])
+        self.assertEqual(list(df["lock"]), ["cas", "ttas", "ticket"])
+        self.assertEqual(list(df["thread_1"].fillna(-1)), [-1, 1, -1])
+
+    def test_flush_without_lines(self):
+        """Flushing or closing a sink without pending lines writes no file."""
+        dataset_dir = self._dataset_dir()
+        sink = ParquetSink(dataset_path=dataset_dir, metadata={}, row_group_size=1)
+        sink.append(row={"out": 1})
+        sink.flush()
+        sink.close()
+        self.assertEqual(len(list(dataset_dir.glob("*.parquet"))), 1)
+
+    def test_schema_change(self):
+        """The columns and their types may change from a file to the next one."""
+        dataset_dir = self._dataset_dir()
+        sink = ParquetSink(dataset_path=dataset_dir, metadata={}, row_group_size=1)
+        sink.append(row={"out": 1})
+        sink.append(row={"out": 2, "other": 3})
+        sink.append(row={"out": "error", "other": None})
+        sink.close()
+
+        df = read_columns(pathname=dataset_dir)
+        self.assertEqual(list(df.columns), ["out", "other"])
+        self.assertEqual([f"{v}" for v in df["out"]], ["1", "2", "error"])
+        self.assertEqual(list(df["other"].fillna(-1)), [-1, 3, -1])
+
+    def test_new_part(self):
+        """Each sink writes new files of the dataset, so a continued campaign adds some."""
+        dataset_dir = self._dataset_dir()
+        for out in [1, 2]:
+            sink = ParquetSink(dataset_path=dataset_dir, metadata={}, row_group_size=10)
+            sink.append(row={"out": out})
+            sink.close()
+        self.assertEqual(
+            sorted(path.name for path in dataset_dir.glob("*.parquet")),
+            ["part-0000-00000.parquet", "part-0001-00000.parquet"],
+        )
+        self.assertEqual(sorted(read_columns(pathname=dataset_dir)["out"]), [1, 2])
+
+    def test_reopen_after_crash(self):
+        """The flushed files of a stopped campaign are kept, its incomplete file removed."""
+        dataset_dir = self._dataset_dir()
+        sink = ParquetSink(dataset_path=dataset_dir, metadata={}, row_group_size=2)
+        for out in [1, 2, 3]:
+            sink.append(row={"out": out})
+        # the campaign is killed: the last line is lost, the file being written stays incomplete
+        incomplete_path = dataset_dir / "part-0000-00001.parquet.tmp"
+        incomplete_path.write_bytes(b"PAR1")
+        del sink
+
+        sink = ParquetSink(dataset_path=dataset_dir, metadata={}, row_group_size=2)
+        self.assertFalse(incomplete_path.exists())
+        self.assertEqual(sorted(read_columns(pathname=dataset_dir)["out"]), [1, 2])
+        sink.append(row={"out": 4})
+        sink.close()
+        self.assertEqual(
+            sorted(path.name for path in dataset_dir.glob("*.parquet")),
+            ["part-0000-00000.parquet", "part-0001-00000.parquet"],
+        )
+        self.assertEqual(sorted(read_columns(pathname=dataset_dir)["out"]), [1, 2, 4])
+
+
+if __name__ == "__main__":
+    unittest.main()
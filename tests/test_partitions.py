@@ -0,0 +1,48 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Module for testing the partitions of the platform on which runs execute concurrently.
+"""
+
+import unittest
+
+from benchkit.platforms import get_current_platform
+from benchkit.utils.partitions import RunPartition, cpu_partitions, get_run_partitions
+
+
+class TestPartitions(unittest.TestCase):
+    """Tests of the partitions and of their command prefixes."""
+
+    def test_command_prefix(self):
+        """NUMA partitions bind both the CPUs and the memory, CPU partitions the CPUs only."""
+        self.assertEqual(
+            RunPartition(index=0, cpus=(4, 5), numa_node=1).command_prefix(),
+            ["numactl", "--cpunodebind=1", "--membind=1"],
+        )
+        self.assertEqual(
+            RunPartition(index=1, cpus=(2, 3)).command_prefix(),
+            ["numactl", "--localalloc", "--physcpubind=2,3"],
+        )
+
+    def test_cpu_partitions(self):
+        """CPU partitions are indexed in order and must be non-empty and disjoint."""
+        self.assertEqual(
+            cpu_partitions(cpu_lists=[[0, 1], [2, 3]]),
+            [RunPartition(index=0, cpus=(0, 1)), RunPartition(index=1, cpus=(2, 3))],
+        )
+        with self.assertRaises(ValueError):
+            cpu_partitions(cpu_lists=[[0, 1], [1, 2]])
+        with self.assertRaises(ValueError):
+            cpu_partitions(cpu_lists=[[0], []])
+
+    def test_spec(self):
+        """No specification means no partition, and unknown specifications are rejected."""
+        platform = get_current_platform()
+        self.assertEqual(get_run_partitions(platform=platform, spec=None), [])
+        self.assertEqual(len(get_run_partitions(platform=platform, spec=[[0]])), 1)
+        with self.assertRaises(ValueError):
+            get_run_partitions(platform=platform, spec="sockets")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,140 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Module for testing the parsing of the perf c2c reports.
+"""
+
+import unittest
+
+from benchkit.commandwrappers.perf import PerfC2CWrap
+
+# excerpt of the output of "perf c2c report --stdio" on a lock microbenchmark
+REPORT = """
+=================================================
+            Trace Event Information
+=================================================
+  Total records                     :     329219
+  Locked Load/Store Operations      :      14654
+  Load Operations                   :      69679
+  Loads - Miss                      :       3972
+  Load Local HITM                   :       3402
+  Load Remote HITM                  :      12757
+  Load Remote HIT                   :       5295
+  LLC Misses to Remote cache (HITM) :       57.3%
+  Store Operations                  :     259539
+
+=================================================
+    Global Shared Cache Line Event Information
+=================================================
+  Total Shared Cache Lines          :         55
+  Load HITs on shared lines         :      55454
+
+=================================================
+                 c2c details
+=================================================
+  Events                            : cpu/mem-loads,ldlat=30/P
+                                    : cpu/mem-stores/P
+  Cachelines sort on                : Total HITMs
+
+=================================================
+           Shared Data Cache Line Table
+=================================================
+#
+#        ----------- Cacheline ----------      Tot  ------- Load Hitm -------    Total    Total    Total  ---- Stores ----  ----- Core Load Hit -----  - LLC Load Hit --  - RMT Load Hit --  --- Load Dram ----
+# Index             Address  Node  PA cnt     Hitm    Total  LclHitm  RmtHitm  records    Loads   Stores    L1Hit   L1Miss       FB       L1       L2    LclHit  LclHitm    RmtHit  RmtHitm       Lcl       Rmt
+# .....  ..................  ....  ......  .......  .......  .......  .......  .......  .......  .......  .......  .......  .......  .......  .......  ........  .......  ........  .......  ........  ........
+#
+      0            0x602180     0    2030   39.51%     6450     1643     4807    13352     7902     5450     5450        0      381     1235        2       119     1643      483     4807       484       355
+      1            0x6021c0     1     120    2.10%      343      300       43      900      600      300      300        0       10       20        0        10      300        5       43         1         0
+
+=================================================
+      Shared Cache Line Distribution Pareto
+=================================================
+#
+#        ----- HITM -----  -- Store Refs --  --------- Data address ---------                      ---------- cycles ----------    Total       cpu                                  Shared
+#   Num  RmtHitm  LclHitm   L1 Hit  L1 Miss              Offset  Node  PA cnt        Code address  rmt hitm  lcl hitm      load  records       cnt                         Symbol             Object                  Source:Line  Node
+# .....  .......  .......  .......  .......  ..................  ....  ......  ..................  ........  ........  ........  .......  ........  .............................  .................  ..........................  ....
+#
+  -------------------------------------------------------------
+      0     4807     1643     5450        0            0x602180
+  -------------------------------------------------------------
+           74.53%   75.04%    0.00%    0.00%                 0x0     0       1            0x400ce8      1341       795       397     7260         2  [.] caslock_acquire            libvsync-locks  caslock.h:60                   0
+           25.47%   24.96%  100.00%    0.00%                0x10     0       1            0x400d00      1341       795       397     6092         2  [.] run_benchmark              libvsync-locks  libvsync-locks.c:262           0
+  -------------------------------------------------------------
+      1       43      300      300        0            0x6021c0
+  -------------------------------------------------------------
+          100.00%  100.00%  100.00%    0.00%                0x8     1       1      0xffffffff8101      2000       900       300      900         2  [k] native_queued_spin_lock  [kernel.kallsyms]  qspinlock.c:100                1
+"""  # noqa: E501
+
+
+class TestPerfC2C(unittest.TestCase):
+    """Tests of the parsing of the perf c2c reports."""
+
+    def test_summary(self):
+        """The summary columns come from the statistics of the report."""
+        self.assertEqual(
+            PerfC2CWrap.parse_summary(report=REPORT),
+            {
+                "c2c_records": 329219,
+                "c2c_loads": 69679,
+                "c2c_stores": 259539,
+                "c2c_local_hitm": 3402,
+                "c2c_remote_hitm": 12757,
+                "c2c_shared_cachelines": 55,
+                "c2c_total_hitm": 3402 + 12757,
+            },
+        )
+
+    def test_cachelines(self):
+        """Each contended cache line gets its HITMs, from the columns named in the header."""
+        cachelines = PerfC2CWrap.parse_cachelines(report=REPORT)
+        self.assertEqual(len(cachelines), 2)
+        self.assertEqual(
+            cachelines[0],
+            {
+                "index": "0",
+                "address": "0x602180",
+                "node": "0",
+                "hitm_share": "39.51%",
+                "total_hitm": "6450",
+                "local_hitm": "1643",
+                "remote_hitm": "4807",
+                "records": "13352",
+                "loads": "7902",
+                "stores": "5450",
+            },
+        )
+        self.assertEqual(cachelines[1]["address"], "0x6021c0")
+        self.assertEqual(cachelines[1]["remote_hitm"], "43")
+
+    def test_symbols(self):
+        """Each code address accessing a contended cache line is reported with its symbol."""
+        symbols = PerfC2CWrap.parse_symbols(report=REPORT)
+        self.assertEqual([s["cacheline"] for s in symbols], ["0", "0", "1"])
+        self.assertEqual(
+            symbols[0],
+            {
+                "cacheline": "0",
+                "cacheline_address": "0x602180",
+                "offset": "0x0",
+                "code_address": "0x400ce8",
+                "local_hitm_share": "75.04%",
+                "remote_hitm_share": "74.53%",
+                "symbol": "caslock_acquire",
+                "object": "libvsync-locks",
+                "source": "caslock.h:60",
+            },
+        )
+        self.assertEqual(symbols[1]["source"], "libvsync-locks.c:262")
+        self.assertEqual(symbols[2]["symbol"], "native_queued_spin_lock")
+        self.assertEqual(symbols[2]["object"], "[kernel.kallsyms]")
+
+    def test_empty_report(self):
+        """A report without samples gives no cache line and no summary column."""
+        self.assertEqual(PerfC2CWrap.parse_cachelines(report=""), [])
+        self.assertEqual(PerfC2CWrap.parse_symbols(report=""), [])
+        self.assertEqual(PerfC2CWrap.parse_summary(report=""), {})
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,66 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Module for testing the index of the cached records.
+"""
+
+import unittest
+
+from benchkit.utils.recordindex import RecordIndex
+
+
+class TestRecordIndex(unittest.TestCase):
+    """Tests of the lookups in the index of the cached records."""
+
+    def setUp(self):
+        self.index = RecordIndex(
+            records=[
+                {"lock": "cas", "nb_threads": "2", "rep": "1", "global_count": "10"},
+                {"lock": "cas", "nb_threads": "4", "rep": "1", "global_count": "20"},
+                {"lock": "mcs", "nb_threads": "2", "rep": "1", "global_count": "30"},
+            ]
+        )
+
+    def test_lookup(self):
+        """Records match on the given columns only, the results being ignored."""
+        columns = ["lock", "nb_threads", "rep"]
+        self.assertEqual(len(self.index), 3)
+        self.assertTrue(
+            self.index.contains(
+                record={"lock": "cas", "nb_threads": "4", "rep": "1"},
+                columns=columns,
+            )
+        )
+        self.assertTrue(
+            self.index.contains(
+                record={"lock": "mcs", "nb_threads": "2", "rep": "1", "global_count": "0"},
+                columns=columns,
+            )
+        )
+        self.assertFalse(
+            self.index.contains(
+                record={"lock": "mcs", "nb_threads": "4", "rep": "1"},
+                columns=columns,
+            )
+        )
+        self.assertFalse(
+            self.index.contains(
+                record={"lock": "cas", "nb_threads": "2", "rep": "2"},
+                columns=columns,
+            )
+        )
+
+    def test_new_columns(self):
+        """Columns that the cached records do not hold are not compared."""
+        columns = ["lock", "nb_threads", "rep", "placement"]
+        record = {"lock": "cas", "nb_threads": "2", "rep": "1", "placement": "compact"}
+        self.assertTrue(self.index.contains(record=record, columns=columns))
+
+    def test_empty(self):
+        """Nothing is cached in an empty index."""
+        index = RecordIndex(records=[])
+        self.assertFalse(index.contains(record={"lock": "cas"}, columns=["lock"]))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,88 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Module for testing the builds of the tilt library.
+"""
+
+import pathlib
+import tempfile
+import unittest
+from unittest.mock import patch
+
+from benchkit.sharedlibs.tiltlib import TiltLib
+
+
+class TiltLibMock(TiltLib):
+    """Tilt library whose sources select the lock and its atomics with CMake options."""
+
+    def cmake_definitions(self, lock, atomics, use_lse):
+        return {"LOCK": lock, "ATOMICS": atomics or "default", "LSE": "ON" if use_lse else "OFF"}
+
+
+class TestTiltLib(unittest.TestCase):
+    """Tests of the per-lock builds of the tilt library, with the build commands mocked."""
+
+    def setUp(self):
+        self._tmp_dir = tempfile.TemporaryDirectory()
+        self.tilt = TiltLibMock(src_path=self._tmp_dir.name, debug_mode=False)
+        self.commands = []
+        self.produced_locks = []
+        self._platform_shell = self.tilt.platform.comm.shell
+        shell_patcher = patch.object(self.tilt.platform.comm, "shell", side_effect=self._shell)
+        shell_patcher.start()
+        self.addCleanup(shell_patcher.stop)
+
+    def tearDown(self):
+        self._tmp_dir.cleanup()
+
+    def _shell(self, command, current_dir=None, **kwargs):
+        if command[0] not in ["cmake", "make"]:  # e.g. the queries of the platform
+            return self._platform_shell(command=command, current_dir=current_dir, **kwargs)
+        self.commands.append(command)
+        if command[0] == "make":
+            for lock in self.produced_locks:
+                (pathlib.Path(current_dir) / f"libtilt-{lock}.so").write_text("library")
+        return ""
+
+    def test_build_single_lock(self):
+        """Each lock is configured and built once, then preloaded from the build directory."""
+        self.produced_locks = ["cas"]
+        self.tilt.build_single_lock(lock="cas", atomics="c11", use_lse=False)
+        self.assertEqual(len(self.commands), 2)
+        self.assertIn("-DLOCK=cas", self.commands[0])
+        self.assertIn("-DATOMICS=c11", self.commands[0])
+        self.assertIn("-DLSE=OFF", self.commands[0])
+
+        self.tilt.build_single_lock(lock="cas", atomics="c11", use_lse=False)
+        self.tilt.build_single_lock(lock="")
+        self.assertEqual(len(self.commands), 2)
+
+        ld_preloads, _ = self.tilt.preload(lock="cas", use_lse=False, atomics="c11")
+        self.assertEqual(ld_preloads, [(self.tilt.build_dir / "libtilt-cas.so").resolve()])
+
+    def test_invalid_builds(self):
+        """Unknown atomics, other variants of a built lock and missing libraries are errors."""
+        self.produced_locks = ["cas"]
+        with self.assertRaises(ValueError):
+            self.tilt.build_single_lock(lock="cas", atomics="x86")
+        self.tilt.build_single_lock(lock="cas")
+        with self.assertRaises(ValueError):
+            self.tilt.build_single_lock(lock="cas", atomics="blt")
+        with self.assertRaises(TiltLib.LibTiltNotFoundError):
+            self.tilt.build_single_lock(lock="ttas")
+
+        self.tilt.clean()
+        self.assertFalse(self.tilt.build_dir.exists())
+        self.tilt.build_single_lock(lock="cas", atomics="blt")
+
+    def test_generic_sources(self):
+        """The options of the sources are only known by the subclasses; the baseline builds none."""
+        tilt = TiltLib(src_path=self._tmp_dir.name, debug_mode=False)
+        tilt.build_single_lock(lock="")
+        with self.assertRaises(NotImplementedError):
+            tilt.build_single_lock(lock="cas")
+        self.assertEqual(self.commands, [])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -4,26 +4,74 @@
 Benchkit support for the custom VSync lock microbenchmarks.
 """
 
+import math
 import pathlib
+import re
 import shutil
-from typing import Any, Dict, List
+from typing import Any, Dict, Iterable, List, Optional
 
-from benchkit.benchmark import Benchmark
-from benchkit.utils.dir import get_curdir, parentdir
+from benchkit.benchmark import Benchmark, CommandAttachment, PostRunHook, PreRunHook
+from benchkit.commandwrappers import CommandWrapper
+from benchkit.utils.buildcache import BuildCache, hash_source_tree, toolchain_fingerprint
+from benchkit.utils.dir import benchkit_include_dir, get_curdir, parentdir
+from benchkit.utils.types import PathType
 
 
 class LockMicroBench(Benchmark):
     """Benchmark object for VSync lock micro benchmark."""
 
+    _samples_filename = "throughput_samples.csv"
+    _per_thread_filename = "per_thread_stats.csv"
+
+    # per-thread values of a statistic, e.g. cycles_t0, stored in the record data directory
+    _per_thread_key = re.compile(r"^(?P<name>.+)_t(?P<thread>[0-9]+)$")
+
+    # a thread completing less than this share of the mean per-thread count is counted as starved
+    _starvation_share = 0.1
+
+    # files and directories of the microbenchmark sources that the builds depend on
+    _source_names = ["CMakeLists.txt", "src", "include", "deps"]
+
     def __init__(
         self,
+        build_cache: bool = True,
+        in_process_repetitions: bool = False,
+        command_wrappers: Iterable[CommandWrapper] = (),
+        command_attachments: Iterable[CommandAttachment] = (),
+        pre_run_hooks: Iterable[PreRunHook] = (),
+        post_run_hooks: Iterable[PostRunHook] = (),
     ) -> None:
+        """
+        Create the lock microbenchmark.
+
+        Args:
+            build_cache (bool, optional):
+                whether to keep each variant (set of build variables) in its own build directory
+                under microbench/build-cache, reused as long as the sources, the build variables and
+                the toolchain do not change. Otherwise, every variant is built from scratch in
+                microbench/build. Defaults to True.
+            in_process_repetitions (bool, optional):
+                whether to run all the repetitions of a record in a single invocation of the
+                microbenchmark, which creates its threads once and measures the repetitions back
+                to back, instead of one invocation per repetition. Defaults to False.
+            command_wrappers (Iterable[CommandWrapper], optional):
+                wrappers of the microbenchmark command, e.g. PerfC2CWrap to find the contended
+                cache lines. Defaults to ().
+            command_attachments (Iterable[CommandAttachment], optional):
+                attachments to the running microbenchmark process, e.g. the one of NoiseMonitor
+                sampling the system noise during the run. Defaults to ().
+            pre_run_hooks (Iterable[PreRunHook], optional):
+                hooks run before each run. Defaults to ().
+            post_run_hooks (Iterable[PostRunHook], optional):
+                hooks run after each run, e.g. the one of a wrapper adding columns to the results.
+                Defaults to ().
+        """
         super().__init__(
-            command_wrappers=(),
-            command_attachments=(),
+            command_wrappers=command_wrappers,
+            command_attachments=command_attachments,
             shared_libs=(),
-            pre_run_hooks=(),
-            post_run_hooks=(),
+            pre_run_hooks=pre_run_hooks,
+            post_run_hooks=post_run_hooks,
         )
 
         script_path = get_curdir(__file__)
@@ -31,6 +79,13 @@ class LockMicroBench(Benchmark):
 
         self._bench_src_path = bench_path
         self._build_dir = bench_path / "build"
+        self._build_cache = None
+        if build_cache:
+            self._build_cache = BuildCache(cache_dir=bench_path / "build-cache")
+        self._toolchain = None
+        self._source_hash = None
+        self._warned_no_data_dir = False
+        self._in_process_repetitions = in_process_repetitions
 
     @property
     def bench_src_path(self) -> pathlib.Path:
@@ -39,14 +94,30 @@ class LockMicroBench(Benchmark):
     @staticmethod
     def get_build_var_names() -> List[str]:
         return [
-            "lock",
-            "nb_threads",
             "benchmark_duration_seconds",
+            "warmup_ms",
+            "cs_length",
+            "cs_cache_lines",
+            "ncs_length",
+            "latency_histogram",
+            "shared_layout",
+            "cache_line_size",
         ]
 
     @staticmethod
     def get_run_var_names() -> List[str]:
-        return []
+        return [
+            "lock",
+            "nb_threads",
+            "placement",
+            "workload",
+            "read_ratio",
+            "sample_period_ms",
+            "perf_counters",
+            "perf_raw_event",
+            "backoff",
+            "sched_fifo_priority",
+        ]
 
     @staticmethod
     def get_tilt_var_names() -> List[str]:
@@ -56,33 +127,117 @@ class LockMicroBench(Benchmark):
         self,
         benchmark_duration_seconds: int,
     ) -> None:
-        pass
+        # the sources and the toolchain are described once per campaign, for all its variants
+        self._toolchain = None
+        self._source_hash = None
+        if self._build_cache is not None:
+            self._describe_build_inputs()
 
     def build_bench(  # pylint: disable=arguments-differ
         self,
-        lock: str,
-        nb_threads: int,
         benchmark_duration_seconds: int,
+        **kwargs,
     ) -> None:
-        duration = benchmark_duration_seconds
-        build_dir = self._build_dir
+        cmake_variables = self._cmake_variables(
+            benchmark_duration_seconds=benchmark_duration_seconds,
+            **kwargs,
+        )
+        self._build_dir = self._build_variant(cmake_variables=cmake_variables)
 
-        if self._build_dir.is_dir() and len(str(build_dir)) > 4:
-            shutil.rmtree(str(self._build_dir))
+    def background_build_bench(  # pylint: disable=arguments-differ
+        self,
+        cpus: Optional[List[int]],
+        parallel_make_str: str,
+        benchmark_duration_seconds: int,
+        **kwargs,
+    ) -> None:
+        if self._build_cache is None:
+            raise NotImplementedError("Background builds need the per-variant build directories")
+        cmake_variables = self._cmake_variables(
+            benchmark_duration_seconds=benchmark_duration_seconds,
+            **kwargs,
+        )
+        command_prefix = [] if cpus is None else ["taskset", "-c", ",".join(map(str, cpus))]
+        self._build_variant(
+            cmake_variables=cmake_variables,
+            command_prefix=command_prefix,
+            parallel_make_str=parallel_make_str,
+        )
+
+    def _cmake_variables(
+        self,
+        benchmark_duration_seconds: int,
+        warmup_ms: int = 0,
+        cs_length: int = 0,
+        cs_cache_lines: int = 0,
+        ncs_length: int = 0,
+        latency_histogram: bool = False,
+        shared_layout: str = "default",
+        cache_line_size: int | None = None,
+    ) -> Dict[str, Any]:
+        if cache_line_size is None:
+            cache_line_size = self.platform.cache_line_size() or 64
+        debug_flag = "Debug" if self.must_debug() else "Release"
+        return {
+            "RUN_DURATION_SECONDS": benchmark_duration_seconds,
+            "WARMUP_MS": warmup_ms,
+            "CS_LENGTH": cs_length,
+            "CS_CACHE_LINES": cs_cache_lines,
+            "NCS_LENGTH": ncs_length,
+            "LATENCY_HISTOGRAM": int(latency_histogram),
+            "SHARED_LAYOUT": shared_layout,
+            "CACHE_LINE_SIZE": cache_line_size,
+            "CMAKE_BUILD_TYPE": debug_flag,
+        }
+
+    def _build_variant(
+        self,
+        cmake_variables: Dict[str, Any],
+        command_prefix: List[str] = (),
+        parallel_make_str: str = "",
+    ) -> pathlib.Path:
+        """
+        Build the variant of the microbenchmark with the given CMake variables, unless it is
+        already in the build cache.
 
-        # Create build directory
-        self.platform.comm.makedirs(path=build_dir, exist_ok=True)
+        Args:
+            cmake_variables (Dict[str, Any]):
+                the CMake variables defining the variant.
+            command_prefix (List[str], optional):
+                prefix of the build commands, e.g. to confine them to some CPUs. Defaults to ().
+            parallel_make_str (str, optional):
+                parallelism option of make. Defaults to "".
+
+        Returns:
+            pathlib.Path: the build directory of the variant.
+        """
+        if self._build_cache is None:
+            build_dir = self._bench_src_path / "build"
+            if build_dir.is_dir() and len(str(build_dir)) > 4:
+                shutil.rmtree(str(build_dir))
+            self.platform.comm.makedirs(path=build_dir, exist_ok=True)
+        else:
+            if self._source_hash is None:
+                self._describe_build_inputs()
+            source_hash = self._source_hash
+            cache_key = self._build_cache.key(
+                source_hash=source_hash,
+                build_variables=cmake_variables,
+                toolchain=self._toolchain,
+            )
+            if self._build_cache.is_built(cache_key):
+                build_dir = self._build_cache.build_dir(cache_key)
+                print(f"[INFO] Reusing the cached build: {build_dir}")
+                return build_dir
+            build_dir = self._build_cache.start_build(cache_key)
 
         # Configure with cmake
-        debug_flag = "Debug" if self.must_debug() else "Release"
-        cmake_command = [
-            "cmake",
-            f"-DLOCK={lock}",
-            f"-DNB_THREADS={nb_threads}",
-            f"-DRUN_DURATION_SECONDS={duration}",
-            f"-DCMAKE_BUILD_TYPE={debug_flag}",
-            f"{self._bench_src_path}",
-        ]
+        cmake_command = (
+            list(command_prefix)
+            + ["cmake"]
+            + [f"-D{name}={value}" for name, value in cmake_variables.items()]
+            + [f"{self._bench_src_path}"]
+        )
         self.platform.comm.shell(
             command=cmake_command,
             current_dir=build_dir,
@@ -91,26 +246,96 @@ class LockMicroBench(Benchmark):
 
         # Compile with make
         self.platform.comm.shell(
-            command="make",
+            command=list(command_prefix) + ["make"] + parallel_make_str.split(),
             current_dir=build_dir,
             output_is_log=True,
         )
 
+        if self._build_cache is not None:
+            self._build_cache.mark_built(
+                key=cache_key,
+                description={
+                    "source_hash": source_hash,
+                    "cmake_variables": cmake_variables,
+                    "toolchain": self._toolchain,
+                },
+            )
+        return build_dir
+
+    def _describe_build_inputs(self) -> None:
+        self._toolchain = toolchain_fingerprint(
+            platform=self.platform,
+            commands=["cc", "cmake"],
+        )
+        self._source_hash = hash_source_tree(
+            source_paths=[self._bench_src_path / name for name in self._source_names]
+            + [benchkit_include_dir()],
+        )
+
     def clean_bench(self) -> None:
         pass
 
-    def single_run(
+    def in_process_repetitions(self) -> bool:
+        return self._in_process_repetitions
+
+    def single_run(  # pylint: disable=arguments-differ
         self,
+        lock: str,
+        nb_threads: int,
+        placement: str | List[int] = "none",
+        workload: str = "mutex",
+        read_ratio: int = 90,
+        sample_period_ms: int = 0,
+        perf_counters: bool = False,
+        perf_raw_event: str = "",
+        backoff: str = "spin",
+        sched_fifo_priority: int = 0,
+        nb_repetitions: int = 1,
         **kwargs,
     ) -> str:
-        run_command = ["./libvsync-locks"]
+        run_command = [
+            "./libvsync-locks",
+            "-l",
+            f"{lock}",
+            "-t",
+            f"{nb_threads}",
+            "-w",
+            f"{workload}",
+            "-b",
+            f"{backoff}",
+        ]
+        if workload == "rw":
+            run_command.extend(["-r", f"{read_ratio}"])
+        if sample_period_ms > 0:
+            run_command.extend(["-s", f"{sample_period_ms}", "-o", self._run_samples_filename()])
+        if perf_counters:
+            run_command.append("-p")
+            if perf_raw_event:
+                run_command.extend(["-x", f"{perf_raw_event}"])
+        if sched_fifo_priority > 0:
+            run_command.extend(["-f", f"{sched_fifo_priority}"])
+        if nb_repetitions > 1:
+            run_command.extend(["-n", f"{nb_repetitions}"])
+
+        cpus = self._placement_cpus(
+            placement=placement,
+            nb_threads=nb_threads,
+        )
+        if cpus is not None:
+            run_command.extend(["-c", ",".join(map(str, cpus))])
+
+        wrapped_run_command, wrapped_environment = self._wrap_command(
+            run_command=run_command,
+            environment={},
+            **kwargs,
+        )
 
         output = self.run_bench_command(
             run_command=run_command,
-            wrapped_run_command=run_command,
+            wrapped_run_command=wrapped_run_command,
             current_dir=self._build_dir,
             environment=None,
-            wrapped_environment=None,
+            wrapped_environment=wrapped_environment,
             print_output=True,
         )
         return output
@@ -119,8 +344,226 @@ class LockMicroBench(Benchmark):
         self,
         command_output: str,
         run_variables: Dict[str, Any],
+        record_data_dir: PathType,
         **kwargs,
-    ) -> Dict[str, Any]:
-        key_seq_values = command_output.strip().split(";")
+    ) -> Dict[str, Any] | List[Dict[str, Any]]:
+        # one line per measurement round, i.e. per repetition of the invocation
+        lines = [line for line in command_output.splitlines() if "global_count=" in line]
+        results = [self._parse_round(line=line) for line in lines]
+
+        per_thread_rows = []
+        for round_id, result_dict in enumerate(results, start=1):
+            per_thread = self._pop_per_thread_values(result_dict)
+            result_dict.update(self._per_thread_aggregates(per_thread=per_thread))
+            per_thread_rows.extend(
+                {"round": round_id, "thread": k, **values}
+                for k, values in sorted(per_thread.items())
+            )
+        if per_thread_rows and record_data_dir is None:
+            if not self._warned_no_data_dir:
+                self._warned_no_data_dir = True
+                print(
+                    f"[WARNING] No data directory to store {self._per_thread_filename}: only the "
+                    "min, max and stddev of the per-thread values are kept in the results "
+                    "(create the campaign with enable_data_dir=True to keep them all)."
+                )
+        elif per_thread_rows:
+            names = list(dict.fromkeys(n for row in per_thread_rows for n in row))
+            rows = [",".join(str(row.get(n, "")) for n in names) for row in per_thread_rows]
+            self._write_to_record_data_dir(
+                file_content="\n".join([",".join(names)] + rows) + "\n",
+                filename=self._per_thread_filename,
+                record_data_dir=record_data_dir,
+            )
+
+        # time series of the per-thread counts, sampled during the run (in one file per round)
+        if run_variables.get("sample_period_ms", 0) > 0:
+            samples_path = self._build_dir / self._run_samples_filename()
+            if len(results) > 1:
+                base_filename = self._samples_filename.removesuffix(".csv")
+                samples_files = [
+                    (f"{samples_path}.{r}", f"{base_filename}_round{r}.csv")
+                    for r in range(1, len(results) + 1)
+                ]
+            else:
+                samples_files = [(samples_path, self._samples_filename)]
+            for path, filename in samples_files:
+                self._write_to_record_data_dir(
+                    file_content=self.platform.comm.read_file(path=path),
+                    filename=filename,
+                    record_data_dir=record_data_dir,
+                )
+
+        if len(results) == 1:
+            return results[0]
+        return results
+
+    def _parse_round(self, line: str) -> Dict[str, Any]:
+        key_seq_values = line.strip().split(";")
         result_dict = dict(map(lambda s: s.split("="), key_seq_values))
+        if "repetition" in result_dict:
+            result_dict["rep"] = int(result_dict.pop("repetition"))
+
+        # throughput over the measured interval (operations per second), excluding the warm-up
+        duration_ns = int(result_dict["duration_ns"])
+        if duration_ns > 0:
+            result_dict["throughput"] = int(result_dict["global_count"]) * 1e9 / duration_ns
+
+        thread_counts = [int(v) for k, v in result_dict.items() if self._is_thread_count(k)]
+        fairness = self._fairness_metrics(thread_counts=thread_counts, duration_ns=duration_ns)
+        result_dict.update(fairness)
+
+        # hardware events per operation, counted in-process over the measured interval
+        global_count = int(result_dict["global_count"])
+        for event in ["cycles", "instructions", "llc_misses", "raw_event"]:
+            if event in result_dict and global_count > 0:
+                result_dict[f"{event}_per_op"] = int(result_dict[event]) / global_count
+
         return result_dict
+
+    @staticmethod
+    def _is_thread_count(key: str) -> bool:
+        return key.startswith("thread_") and key.split("thread_")[-1].isdigit()
+
+    @classmethod
+    def _pop_per_thread_values(cls, result_dict: Dict[str, Any]) -> Dict[int, Dict[str, Any]]:
+        # remove the per-thread values (e.g. cycles_t0) from the result, grouped by thread
+        per_thread = {}
+        for key in list(result_dict):
+            match = cls._per_thread_key.match(key)
+            if match is not None:
+                thread = int(match.group("thread"))
+                per_thread.setdefault(thread, {})[match.group("name")] = result_dict.pop(key)
+        return per_thread
+
+    @staticmethod
+    def _per_thread_aggregates(per_thread: Dict[int, Dict[str, Any]]) -> Dict[str, Any]:
+        # the spread of each per-thread value across the threads, kept in the result row
+        values_by_name = {}
+        for values in per_thread.values():
+            for name, value in values.items():
+                number = float(value)
+                values_by_name.setdefault(name, []).append(
+                    int(number) if number.is_integer() else number
+                )
+        aggregates = {}
+        for name, values in values_by_name.items():
+            mean = sum(values) / len(values)
+            variance = sum((v - mean) ** 2 for v in values) / len(values)
+            aggregates[f"{name}_min"] = min(values)
+            aggregates[f"{name}_max"] = max(values)
+            aggregates[f"{name}_stddev"] = math.sqrt(variance)
+        return aggregates
+
+    def _run_samples_filename(self) -> str:
+        # the concurrent runs of a variant share its build directory, so each partition has a file
+        partition = self.current_partition()
+        if partition is None:
+            return self._samples_filename
+        return f"partition{partition.index}_{self._samples_filename}"
+
+    @classmethod
+    def _fairness_metrics(
+        cls,
+        thread_counts: List[int],
+        duration_ns: int,
+    ) -> Dict[str, Any]:
+        """
+        Compute the fairness metrics of a run from the number of operations of each thread.
+
+        Args:
+            thread_counts (List[int]): number of operations completed by each thread.
+            duration_ns (int): duration of the measured interval, in nanoseconds.
+
+        Returns:
+            Dict[str, Any]:
+                Jain's fairness index (1 when all threads progress equally, 1/n when a single
+                thread does), coefficient of variation of the per-thread counts, minimum and
+                maximum per-thread throughput (operations per second), their ratio, and the
+                number of starved threads.
+        """
+        if not thread_counts:
+            return {}
+
+        nb_threads = len(thread_counts)
+        total = sum(thread_counts)
+        mean = total / nb_threads
+        sum_squares = sum(c * c for c in thread_counts)
+        stddev = math.sqrt(max(sum_squares / nb_threads - mean * mean, 0.0))
+        per_second = 1e9 / duration_ns if duration_ns > 0 else 0.0
+
+        min_count = min(thread_counts)
+        max_count = max(thread_counts)
+        return {
+            "fairness_index": (total * total) / (nb_threads * sum_squares) if sum_squares else 1.0,
+            "throughput_cv": stddev / mean if mean else 0.0,
+            "min_thread_throughput": min_count * per_second,
+            "max_thread_throughput": max_count * per_second,
+            "min_max_ratio": min_count / max_count if max_count else 1.0,
+            "starved_threads": sum(1 for c in thread_counts if c < cls._starvation_share * mean),
+        }
+
+    def _placement_cpus(
+        self,
+        placement: str | List[int],
+        nb_threads: int,
+    ) -> Optional[List[int]]:
+        """
+        Compute the CPU on which each thread of the microbenchmark is pinned.
+
+        Args:
+            placement (str | List[int]):
+                placement policy: "none" (threads float freely), "compact" (fill the cores of a
+                NUMA node before moving to the next one, SMT siblings last), "scatter" (adjacent
+                threads as far as possible, using the "even" CPU order of the platform), "smt"
+                (fill the SMT siblings of a core before moving to the next core), or an explicit
+                list of CPU identifiers.
+            nb_threads (int):
+                number of threads of the microbenchmark.
+
+        Raises:
+            ValueError:
+                if the placement policy is not recognized, or if it lists CPUs of the partition
+                or of the background builds.
+
+        Returns:
+            Optional[List[int]]:
+                the CPU of each thread (wrapping around when there are more threads than CPUs), or
+                None if threads must not be pinned.
+        """
+        match placement:
+            case "none" | None:
+                return None
+            case "compact" | "smt":
+                # from the topology of the platform, as the numbering of the CPUs varies
+                cpu_order = self.platform.cpu_order(provided_order=placement)
+            case "scatter":
+                cpu_order = self.platform.cpu_order(provided_order="even")
+            case str():
+                raise ValueError(f"Unknown thread placement policy: {placement}")
+            case _:
+                cpu_order = self.platform.cpu_order(provided_order=list(placement))
+
+        # when records run concurrently, each one places its threads within its own partition
+        partition = self.current_partition()
+        if partition is not None:
+            if isinstance(placement, str):
+                cpu_order = [cpu for cpu in cpu_order if cpu in partition.cpus]
+            elif not set(cpu_order).issubset(partition.cpus):
+                raise ValueError(
+                    f"Placement {placement} is out of the CPUs of the partition: {partition.cpus}"
+                )
+
+        # the threads are kept out of the CPUs on which the next variants are built meanwhile
+        build_cpus = set(self.background_build_cpus())
+        if isinstance(placement, str):
+            cpu_order = [cpu for cpu in cpu_order if cpu not in build_cpus]
+        elif build_cpus.intersection(cpu_order):
+            raise ValueError(
+                f"Placement {placement} uses CPUs of the background builds: {sorted(build_cpus)}"
+            )
+        if not cpu_order:
+            raise ValueError(f"No CPU left for the placement {placement}")
+
+        result = [cpu_order[k % len(cpu_order)] for k in range(nb_threads)]
+        return result
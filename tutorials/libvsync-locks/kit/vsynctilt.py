@@ -0,0 +1,49 @@
+# Copyright (C) 2024 Huawei Technologies Co., Ltd. All rights reserved.
+# SPDX-License-Identifier: MIT
+"""
+Tilt library of the tutorial, replacing the pthread mutexes with the libvsync locks.
+"""
+
+from typing import Dict, Optional
+
+from benchkit.sharedlibs.tiltlib import TiltLib
+from benchkit.utils.dir import get_curdir, parentdir
+from benchkit.utils.types import PathType
+
+
+class VsyncTiltLib(TiltLib):
+    """
+    Tilt library built from tutorials/libvsync-locks/tilt, for the lock given in its TILT_LOCK
+    cache variable, with the atomics given in TILT_ATOMICS and, on Armv8, the LSE instructions if
+    TILT_USE_LSE is ON.
+    """
+
+    def __init__(
+        self,
+        debug_mode: bool,
+        src_path: Optional[PathType] = None,
+    ) -> None:
+        """
+        Create the tilt library of the tutorial.
+
+        Args:
+            debug_mode (bool):
+                whether to build the libraries in debug mode.
+            src_path (Optional[PathType], optional):
+                path of the tilt sources, None for the ones of the tutorial. Defaults to None.
+        """
+        if src_path is None:
+            src_path = parentdir(path=get_curdir(__file__), levels=1) / "tilt"
+        super().__init__(src_path=src_path, debug_mode=debug_mode)
+
+    def cmake_definitions(
+        self,
+        lock: str,
+        atomics: Optional[str],
+        use_lse: bool,
+    ) -> Dict[str, str]:
+        return {
+            "TILT_LOCK": lock,
+            "TILT_ATOMICS": atomics if atomics is not None else "default",
+            "TILT_USE_LSE": "ON" if use_lse else "OFF",
+        }
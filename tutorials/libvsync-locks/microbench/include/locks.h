@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2023 Huawei Technologies Co.,Ltd. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LOCKS_H
+#define LOCKS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <vsync/spinlock/caslock.h>
+#include <vsync/spinlock/hemlock.h>
+#include <vsync/spinlock/mcslock.h>
+#include <vsync/spinlock/rwlock.h>
+#include <vsync/spinlock/seqlock.h>
+#include <vsync/spinlock/ticketlock.h>
+#include <vsync/spinlock/ttaslock.h>
+#include <vsync/thread/mutex.h>
+
+/*
+ * Blocking locks, which park the waiting threads in the kernel instead of spinning: the futex-based
+ * mutex of libvsync and, as a baseline, the pthread mutex of the C library. They are adapted to
+ * the name##lock_* interface of the spinlocks.
+ */
+typedef vmutex_t futexlock_t;
+
+static inline void futexlock_init(futexlock_t* lock) {
+    vmutex_init(lock);
+}
+
+static inline void futexlock_acquire(futexlock_t* lock) {
+    vmutex_acquire(lock);
+}
+
+static inline void futexlock_release(futexlock_t* lock) {
+    vmutex_release(lock);
+}
+
+typedef pthread_mutex_t pthreadlock_t;
+
+static inline void pthreadlock_init(pthreadlock_t* lock) {
+    pthread_mutex_init(lock, NULL);
+}
+
+static inline void pthreadlock_acquire(pthreadlock_t* lock) {
+    pthread_mutex_lock(lock);
+}
+
+static inline bool pthreadlock_tryacquire(pthreadlock_t* lock) {
+    return pthread_mutex_trylock(lock) == 0;
+}
+
+static inline void pthreadlock_release(pthreadlock_t* lock) {
+    pthread_mutex_unlock(lock);
+}
+
+/*
+ * List of the mutual exclusion locks linked in the microbenchmark.
+ * LOCK(name) is for locks with the name##lock_acquire(name##lock_t*) interface,
+ * LOCK_NODE(name, node_t) is for queue locks that take a per-thread node:
+ * name##lock_acquire(name##lock_t*, node_t*).
+ * To benchmark another lock, include its header above and add it to the list.
+ */
+#define FOREACH_LOCK(LOCK, LOCK_NODE) \
+    LOCK(cas)                         \
+    LOCK(ttas)                        \
+    LOCK(ticket)                      \
+    LOCK_NODE(mcs, mcs_node_t)        \
+    LOCK_NODE(hem, hem_node_t)        \
+    LOCK(futex)                       \
+    LOCK(pthread)
+
+/* Subset of the locks above that provide name##lock_tryacquire(name##lock_t*). */
+#define FOREACH_TRYLOCK(LOCK) \
+    LOCK(cas)                 \
+    LOCK(ttas)                \
+    LOCK(ticket)              \
+    LOCK(pthread)
+
+/*
+ * List of the reader-writer locks: RWLOCK(name) for name##_{read,write}_{acquire,release},
+ * SEQLOCK(name) for the optimistic readers of name##_rbegin/name##_rend.
+ */
+#define FOREACH_RWLOCK(RWLOCK, SEQLOCK) \
+    RWLOCK(rwlock)                      \
+    SEQLOCK(seqlock)
+
+#define LOCK_NOOP(...)
+#define LOCK_UNION_FIELD(name, ...) name##lock_t name;
+#define RWLOCK_UNION_FIELD(name) name##_t name;
+#define LOCK_NODE_UNION_FIELD(name, node_t) node_t name;
+
+/* Storage large enough for any of the locks. */
+typedef union {
+    FOREACH_LOCK(LOCK_UNION_FIELD, LOCK_UNION_FIELD)
+    FOREACH_RWLOCK(RWLOCK_UNION_FIELD, RWLOCK_UNION_FIELD)
+} any_lock_t;
+
+/* Per-thread context large enough for the node of any queue lock. */
+typedef union {
+    char none;
+    FOREACH_LOCK(LOCK_NOOP, LOCK_NODE_UNION_FIELD)
+} any_lock_ctx_t;
+
+/*
+ * Uniform wrappers around each lock: <name>_ops_{init,acquire,release}(lock, ctx).
+ * They are meant to be called with constant function names so that they are inlined in the
+ * benchmark loop, avoiding any indirect call on the measured path.
+ */
+#define LOCK_OPS_DEFINE(name)                                                      \
+    static inline void name##_ops_init(any_lock_t* lock) {                         \
+        name##lock_init(&lock->name);                                              \
+    }                                                                              \
+    static inline void name##_ops_acquire(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        (void) ctx;                                                                \
+        name##lock_acquire(&lock->name);                                           \
+    }                                                                              \
+    static inline void name##_ops_release(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        (void) ctx;                                                                \
+        name##lock_release(&lock->name);                                           \
+    }
+
+#define LOCK_NODE_OPS_DEFINE(name, node_t)                                         \
+    static inline void name##_ops_init(any_lock_t* lock) {                         \
+        name##lock_init(&lock->name);                                              \
+    }                                                                              \
+    static inline void name##_ops_acquire(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        name##lock_acquire(&lock->name, &ctx->name);                               \
+    }                                                                              \
+    static inline void name##_ops_release(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        name##lock_release(&lock->name, &ctx->name);                               \
+    }
+
+FOREACH_LOCK(LOCK_OPS_DEFINE, LOCK_NODE_OPS_DEFINE)
+
+#define TRYLOCK_OPS_DEFINE(name)                                                      \
+    static inline bool name##_ops_tryacquire(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        (void) ctx;                                                                   \
+        return name##lock_tryacquire(&lock->name);                                    \
+    }
+
+FOREACH_TRYLOCK(TRYLOCK_OPS_DEFINE)
+
+/*
+ * Uniform reader-writer wrappers: <name>_ops_{init,write_acquire,write_release} and the reader
+ * section <name>_ops_read_begin(lock, ctx) -> token, <name>_ops_read_end(lock, ctx, token) ->
+ * whether the read section must be retried (only for optimistic readers).
+ * Mutual exclusion locks also get these wrappers, with readers taking the lock exclusively, as
+ * a baseline for the reader-writer locks.
+ */
+#define RWLOCK_OPS_DEFINE(name)                                                          \
+    static inline void name##_ops_init(any_lock_t* lock) {                               \
+        name##_init(&lock->name);                                                        \
+    }                                                                                    \
+    static inline void name##_ops_write_acquire(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        (void) ctx;                                                                      \
+        name##_write_acquire(&lock->name);                                               \
+    }                                                                                    \
+    static inline void name##_ops_write_release(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        (void) ctx;                                                                      \
+        name##_write_release(&lock->name);                                               \
+    }                                                                                    \
+    static inline uint32_t name##_ops_read_begin(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        (void) ctx;                                                                      \
+        name##_read_acquire(&lock->name);                                                \
+        return 0u;                                                                       \
+    }                                                                                    \
+    static inline bool name##_ops_read_end(any_lock_t* lock, any_lock_ctx_t* ctx,        \
+                                           uint32_t token) {                             \
+        (void) ctx;                                                                      \
+        (void) token;                                                                    \
+        name##_read_release(&lock->name);                                                \
+        return false;                                                                    \
+    }
+
+#define SEQLOCK_OPS_DEFINE(name)                                                         \
+    static inline void name##_ops_init(any_lock_t* lock) {                               \
+        name##_init(&lock->name);                                                        \
+    }                                                                                    \
+    static inline void name##_ops_write_acquire(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        (void) ctx;                                                                      \
+        name##_acquire(&lock->name);                                                     \
+    }                                                                                    \
+    static inline void name##_ops_write_release(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        (void) ctx;                                                                      \
+        name##_release(&lock->name);                                                     \
+    }                                                                                    \
+    static inline uint32_t name##_ops_read_begin(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        (void) ctx;                                                                      \
+        return (uint32_t) name##_rbegin(&lock->name);                                    \
+    }                                                                                    \
+    static inline bool name##_ops_read_end(any_lock_t* lock, any_lock_ctx_t* ctx,        \
+                                           uint32_t token) {                             \
+        (void) ctx;                                                                      \
+        return !name##_rend(&lock->name, (seqvalue_t) token);                            \
+    }
+
+FOREACH_RWLOCK(RWLOCK_OPS_DEFINE, SEQLOCK_OPS_DEFINE)
+
+#define LOCK_AS_RWLOCK_OPS_DEFINE(name, ...)                                             \
+    static inline void name##_ops_write_acquire(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        name##_ops_acquire(lock, ctx);                                                   \
+    }                                                                                    \
+    static inline void name##_ops_write_release(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        name##_ops_release(lock, ctx);                                                   \
+    }                                                                                    \
+    static inline uint32_t name##_ops_read_begin(any_lock_t* lock, any_lock_ctx_t* ctx) { \
+        name##_ops_acquire(lock, ctx);                                                   \
+        return 0u;                                                                       \
+    }                                                                                    \
+    static inline bool name##_ops_read_end(any_lock_t* lock, any_lock_ctx_t* ctx,        \
+                                           uint32_t token) {                             \
+        (void) token;                                                                    \
+        name##_ops_release(lock, ctx);                                                   \
+        return false;                                                                    \
+    }
+
+FOREACH_LOCK(LOCK_AS_RWLOCK_OPS_DEFINE, LOCK_AS_RWLOCK_OPS_DEFINE)
+
+#endif /* LOCKS_H */
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2023 Huawei Technologies Co.,Ltd. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/* Hardware events counted by each thread. */
+enum {
+    PERF_EVENT_CYCLES = 0,
+    PERF_EVENT_INSTRUCTIONS,
+    PERF_EVENT_LLC_MISSES, /* last-level cache read misses */
+    PERF_EVENT_RAW,        /* optional raw event, e.g. the HITM loads of the CPU model */
+    PERF_NB_EVENTS,
+};
+
+static const char *const perf_event_names[PERF_NB_EVENTS] = {
+    "cycles",
+    "instructions",
+    "llc_misses",
+    "raw_event",
+};
+
+/*
+ * Group of counters of one thread (user space only), enabled and disabled together around the
+ * measurement window. Events that cannot be opened (unsupported by the CPU, or not allowed by
+ * perf_event_paranoid) are left out of the group.
+ */
+typedef struct {
+    int leader;              /* file descriptor of the group leader, -1 if nothing is counted */
+    int fds[PERF_NB_EVENTS]; /* -1 for the events that are not counted */
+    uint64_t values[PERF_NB_EVENTS];
+} __attribute__((aligned(CACHE_LINE_SIZE))) perf_counters_t;
+
+static inline int perf_event_open_thread(uint32_t type, uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+/* Open the counters of the calling thread; raw_config 0 leaves out the raw event. */
+static inline void perf_counters_open(perf_counters_t *counters, uint64_t raw_config) {
+    const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[PERF_NB_EVENTS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_RAW, raw_config},
+    };
+
+    counters->leader = -1;
+    for (int i = 0; i < PERF_NB_EVENTS; ++i) {
+        counters->values[i] = 0u;
+        counters->fds[i] = -1;
+        if (i == PERF_EVENT_RAW && raw_config == 0u) {
+            continue;
+        }
+        counters->fds[i] = perf_event_open_thread(events[i].type, events[i].config,
+                                                  counters->leader);
+        if (counters->fds[i] >= 0 && counters->leader == -1) {
+            counters->leader = counters->fds[i];
+        }
+    }
+}
+
+static inline void perf_counters_start(perf_counters_t *counters) {
+    if (counters->leader >= 0) {
+        ioctl(counters->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(counters->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+/*
+ * Stop counting and read the values, scaled up if the group was multiplexed with other events
+ * (i.e. only scheduled on the PMU part of the time).
+ */
+static inline void perf_counters_stop(perf_counters_t *counters) {
+    if (counters->leader < 0) {
+        return;
+    }
+    ioctl(counters->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    /* group read format: nr, time_enabled, time_running, then the values in opening order */
+    uint64_t data[3 + PERF_NB_EVENTS];
+    if (read(counters->leader, data, sizeof(data)) < (ssize_t) (3 * sizeof(uint64_t))) {
+        return;
+    }
+    const double scale = data[2] > 0u ? (double) data[1] / (double) data[2] : 0.0;
+    uint64_t index = 0u;
+    for (int i = 0; i < PERF_NB_EVENTS && index < data[0]; ++i) {
+        if (counters->fds[i] >= 0) {
+            counters->values[i] = (uint64_t) ((double) data[3 + index] * scale);
+            index++;
+        }
+    }
+}
+
+static inline void perf_counters_close(perf_counters_t *counters) {
+    for (int i = 0; i < PERF_NB_EVENTS; ++i) {
+        if (counters->fds[i] >= 0) {
+            close(counters->fds[i]);
+            counters->fds[i] = -1;
+        }
+    }
+    counters->leader = -1;
+}
+
+#endif /* PERFCOUNTERS_H */
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2023 Huawei Technologies Co.,Ltd. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Time series of counter snapshots, kept in a preallocated ring buffer.
+ * Each sample is a row made of a timestamp (in nanoseconds) followed by nb_counters values.
+ * Once the buffer is full, the oldest samples are overwritten.
+ */
+typedef struct {
+    uint64_t *rows;
+    size_t nb_counters;
+    size_t capacity;
+    size_t next;
+    size_t size;
+} sampler_t;
+
+static inline bool sampler_init(sampler_t *sampler, size_t nb_counters, size_t capacity) {
+    sampler->rows = calloc(capacity * (nb_counters + 1u), sizeof(*sampler->rows));
+    sampler->nb_counters = nb_counters;
+    sampler->capacity = capacity;
+    sampler->next = 0u;
+    sampler->size = 0u;
+    return sampler->rows != NULL;
+}
+
+static inline void sampler_destroy(sampler_t *sampler) {
+    free(sampler->rows);
+    sampler->rows = NULL;
+}
+
+/* Row to fill for the next sample: row[0] is the timestamp, row[1 + i] the i-th counter. */
+static inline uint64_t *sampler_next_row(sampler_t *sampler) {
+    uint64_t *row = &sampler->rows[sampler->next * (sampler->nb_counters + 1u)];
+    sampler->next = (sampler->next + 1u) % sampler->capacity;
+    if (sampler->size < sampler->capacity) {
+        sampler->size++;
+    }
+    return row;
+}
+
+/* Write the samples, oldest first, as CSV with a time_ns,<prefix>0,<prefix>1,... header. */
+static inline void sampler_write_csv(const sampler_t *sampler, FILE *output, const char *prefix) {
+    fprintf(output, "time_ns");
+    for (size_t i = 0u; i < sampler->nb_counters; ++i) {
+        fprintf(output, ",%s%zu", prefix, i);
+    }
+    fprintf(output, "\n");
+
+    const size_t first = (sampler->next + sampler->capacity - sampler->size) % sampler->capacity;
+    for (size_t s = 0u; s < sampler->size; ++s) {
+        const uint64_t *row =
+            &sampler->rows[((first + s) % sampler->capacity) * (sampler->nb_counters + 1u)];
+        fprintf(output, "%llu", (unsigned long long) row[0]);
+        for (size_t i = 0u; i < sampler->nb_counters; ++i) {
+            fprintf(output, ",%llu", (unsigned long long) row[1u + i]);
+        }
+        fprintf(output, "\n");
+    }
+}
+
+#endif /* SAMPLER_H */
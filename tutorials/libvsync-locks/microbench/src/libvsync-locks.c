@@ -3,65 +3,942 @@
  * SPDX-License-Identifier: MIT
  */
 
+#define _GNU_SOURCE
 #include <vsync/atomic.h>
+#include <limits.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
 #include <unistd.h>
 
-#include <config.h> /* defines NB_THREADS, RUN_DURATION_SECONDS and lock_* operations and types. */
+#include <config.h>  /* defines RUN_DURATION_SECONDS and the workload parameters. */
+#include <locks.h>   /* defines the list of locks and their uniform any_lock_t operations. */
+#include <perfcounters.h> /* defines the per-thread groups of hardware counters. */
+#include <sampler.h> /* defines the ring buffer of the throughput time series. */
 
-static vatomic32_t must_stop;
-static lock_t lock;
-static unsigned long long shared_counter;
+#define BK_CACHE_LINE_SIZE CACHE_LINE_SIZE
+#include <benchkit/harness.h> /* defines the tick counter, the clock and the histograms. */
 
-void* run_thread() {
-    unsigned long count = 0u;
+/* Upper bound of the exponential backoff (in delay loop iterations) after a failed tryacquire. */
+#define TRYLOCK_MAX_BACKOFF 1024u
 
-    while (!vatomic32_read(&must_stop)) {
-        lock_acquire(&lock);
-        count++;
-        shared_counter++;
-        lock_release(&lock);
+/* Number of polls of the start barrier before a waiting thread yields its CPU. */
+#define START_SPINS 1024u
+
+/* Maximum number of throughput samples kept in memory; older samples are overwritten. */
+#define SAMPLES_MAX_ROWS 65536u
+
+/* Maximum number of thread counts in a single invocation. */
+#define MAX_THREAD_COUNTS 64u
+
+/*
+ * Phases of a run, published by the main thread in shared.phase.
+ * Threads wait in PHASE_INIT until all of them are created, then run the warm-up window (whose
+ * operations are not counted) and the measurement window until PHASE_STOP.
+ */
+enum {
+    PHASE_INIT = 0,
+    PHASE_WARMUP,
+    PHASE_MEASURE,
+    PHASE_STOP,
+};
+
+#if SHARED_LAYOUT_FALSESHARING
+/* The phase, the lock and the counter are deliberately co-located in a single cache line. */
+static struct {
+    vatomic32_t phase;
+    any_lock_t lock;
+    unsigned long long counter;
+} __attribute__((aligned(CACHE_LINE_SIZE))) shared;
+
+_Static_assert(offsetof(__typeof__(shared), counter) + sizeof(shared.counter) <= CACHE_LINE_SIZE,
+               "shared state does not fit in a single cache line");
+#else
+#if SHARED_LAYOUT_PADDED
+/* Each of the phase, the lock and the counter lives on its own cache line. */
+#define SHARED_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+#else
+#define SHARED_ALIGNED
+#endif
+
+static struct {
+    vatomic32_t phase SHARED_ALIGNED;
+    any_lock_t lock SHARED_ALIGNED;
+    unsigned long long counter SHARED_ALIGNED;
+} SHARED_ALIGNED shared;
+#endif
+
+#if CS_CACHE_LINES > 0
+/* Additional shared data written inside the critical section, one counter per cache line. */
+typedef struct {
+    unsigned long long value;
+} __attribute__((aligned(CACHE_LINE_SIZE))) cs_line_t;
+
+static cs_line_t cs_lines[CS_CACHE_LINES];
+#endif
+
+/* Statistics of one thread, each on its own cache line(s). */
+typedef struct {
+    unsigned long count;              /* completed operations (reads + writes) */
+    unsigned long reads;              /* completed read sections (rw workload) */
+    unsigned long writes;             /* completed write sections (rw workload) */
+    unsigned long read_retries;       /* optimistic read sections that were retried */
+    unsigned long failed_tryacquires; /* failed tryacquire attempts (trylock workload) */
+    /*
+     * Context switches of the thread over the measurement window, voluntary ones (the thread
+     * blocked, e.g. parked on a futex) and involuntary ones (the thread was preempted, or
+     * yielded its CPU to another thread). They hold the getrusage values at the start of the
+     * window until thread_done.
+     */
+    unsigned long voluntary_switches;
+    unsigned long involuntary_switches;
+} __attribute__((aligned(CACHE_LINE_SIZE))) thread_stats_t;
+
+static thread_stats_t* thread_stats;
+
+/*
+ * Number of operations completed so far by one thread, published for the sampler.
+ * Only allocated when the progress is sampled, so that the loop does not store it otherwise.
+ */
+typedef struct {
+    vatomic64_t count;
+} __attribute__((aligned(CACHE_LINE_SIZE))) thread_progress_t;
+
+static thread_progress_t* thread_progress;
+
+#if LATENCY_HISTOGRAM
+static bk_hist_t* thread_hists;
+#endif
+
+/* Hardware counters of each thread over the measurement window, NULL if not requested. */
+static perf_counters_t* thread_perf;
+static uint64_t perf_raw_config;
+
+/* Percentage of read sections in the rw workload. */
+static unsigned read_ratio;
+
+/* Whether a failed tryacquire yields the CPU instead of spinning in the exponential backoff. */
+static bool yield_backoff;
+
+/* Number of threads that reached the start barrier. */
+static vatomic32_t nb_ready_threads;
+
+/* Number of threads that published their statistics at the end of the round. */
+static vatomic32_t nb_done_threads;
+
+/*
+ * Rounds of measurement, run back to back by the same threads: one per thread count and
+ * repetition. The main thread starts a round by incrementing id, and the first nb_threads
+ * threads take part in it while the others stay blocked (out of the CPUs) until the next round.
+ */
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned id;
+    size_t nb_threads;
+    bool quit;
+} rounds = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+/* Busy-wait for the given number of iterations without touching memory. */
+static inline void delay_loop(unsigned long iterations) {
+    for (unsigned long i = 0u; i < iterations; ++i) {
+        __asm__ __volatile__("" : : : "memory");
     }
+}
+
+/* Cheap per-thread pseudo-random generator (xorshift32) used to pick reads or writes. */
+static inline uint32_t xorshift32(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/* Work done while holding the lock exclusively. */
+static inline void write_section(void) {
+    shared.counter++;
+#if CS_CACHE_LINES > 0
+    for (size_t l = 0u; l < CS_CACHE_LINES; ++l) {
+        cs_lines[l].value++;
+    }
+#endif
+    delay_loop(CS_LENGTH);
+}
 
-    void* result = (void*) count;
+/* Work done inside a read section, reading the data the writers update. */
+static inline unsigned long long read_section(void) {
+    unsigned long long sum = __atomic_load_n(&shared.counter, __ATOMIC_RELAXED);
+#if CS_CACHE_LINES > 0
+    for (size_t l = 0u; l < CS_CACHE_LINES; ++l) {
+        sum += __atomic_load_n(&cs_lines[l].value, __ATOMIC_RELAXED);
+    }
+#endif
+    delay_loop(CS_LENGTH);
+    return sum;
+}
+
+/*
+ * Start barrier: wait until the main thread releases all the threads at once, such that the
+ * first created threads do not run alone while the others are being spawned.
+ * Waiting threads end up yielding their CPU, so that the threads still to arrive can run when the
+ * CPUs are oversubscribed.
+ */
+static inline void wait_start(void) {
+    vatomic32_inc(&nb_ready_threads);
+    unsigned spins = 0u;
+    while (vatomic32_read(&shared.phase) == PHASE_INIT) {
+        if (++spins > START_SPINS) {
+            sched_yield();
+        }
+    }
+}
+
+/*
+ * Whether the thread must keep running the benchmark loop.
+ * When the warm-up window ends, the statistics gathered so far by the thread are discarded, and
+ * its hardware counters and context switches start counting.
+ */
+static inline bool keep_running(size_t k, uint32_t* seen_phase, thread_stats_t* stats) {
+    const uint32_t phase = vatomic32_read(&shared.phase);
+    if (phase != *seen_phase) {
+        if (phase == PHASE_MEASURE) {
+            memset(stats, 0, sizeof(*stats));
+            struct rusage usage;
+            getrusage(RUSAGE_THREAD, &usage);
+            stats->voluntary_switches = (unsigned long) usage.ru_nvcsw;
+            stats->involuntary_switches = (unsigned long) usage.ru_nivcsw;
+#if LATENCY_HISTOGRAM
+            bk_hist_init(&thread_hists[k]);
+#endif
+            if (thread_perf != NULL) {
+                perf_counters_start(&thread_perf[k]);
+            }
+        }
+        *seen_phase = phase;
+    }
+    if (thread_progress != NULL) {
+        vatomic64_write_rlx(&thread_progress[k].count, stats->count);
+    }
+    return phase != PHASE_STOP;
+}
+
+/* Publish the statistics of thread k at the end of the benchmark loop. */
+static inline void thread_done(size_t k, const thread_stats_t* stats) {
+    if (thread_perf != NULL) {
+        perf_counters_stop(&thread_perf[k]);
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    thread_stats[k] = *stats;
+    thread_stats[k].voluntary_switches = (unsigned long) usage.ru_nvcsw - stats->voluntary_switches;
+    thread_stats[k].involuntary_switches =
+        (unsigned long) usage.ru_nivcsw - stats->involuntary_switches;
+    vatomic32_inc(&nb_done_threads);
+}
+
+typedef void (*lock_init_fn)(any_lock_t* lock);
+typedef void (*lock_op_fn)(any_lock_t* lock, any_lock_ctx_t* ctx);
+typedef bool (*lock_try_fn)(any_lock_t* lock, any_lock_ctx_t* ctx);
+typedef uint32_t (*lock_read_begin_fn)(any_lock_t* lock, any_lock_ctx_t* ctx);
+typedef bool (*lock_read_end_fn)(any_lock_t* lock, any_lock_ctx_t* ctx, uint32_t token);
+
+/*
+ * Benchmark loops, generic over the lock operations (one per workload).
+ * They are always inlined in the per-lock run_thread_<workload>_<name> functions below, with
+ * constant lock operations, such that each lock gets its own loop without indirect calls.
+ */
+static inline __attribute__((always_inline)) void* run_thread_mutex_with(void* arg,
+                                                                         lock_op_fn acquire,
+                                                                         lock_op_fn release) {
+    thread_stats_t stats = {0};
+    any_lock_ctx_t ctx __attribute__((aligned(CACHE_LINE_SIZE)));
+    memset(&ctx, 0, sizeof(ctx));
+#if LATENCY_HISTOGRAM
+    bk_hist_t* hist = &thread_hists[(size_t) arg];
+#endif
+
+    uint32_t seen_phase = PHASE_WARMUP;
+    wait_start();
+    while (keep_running((size_t) arg, &seen_phase, &stats)) {
+#if LATENCY_HISTOGRAM
+        const uint64_t before = bk_ticks();
+        acquire(&shared.lock, &ctx);
+        bk_hist_record(hist, bk_ticks() - before);
+#else
+        acquire(&shared.lock, &ctx);
+#endif
+        stats.count++;
+        write_section();
+        release(&shared.lock, &ctx);
+
+        delay_loop(NCS_LENGTH);
+    }
+
+    thread_done((size_t) arg, &stats);
+    return NULL;
+}
+
+static inline __attribute__((always_inline)) void* run_thread_trylock_with(void* arg,
+                                                                           lock_try_fn tryacquire,
+                                                                           lock_op_fn release) {
+    thread_stats_t stats = {0};
+    any_lock_ctx_t ctx __attribute__((aligned(CACHE_LINE_SIZE)));
+    memset(&ctx, 0, sizeof(ctx));
+#if LATENCY_HISTOGRAM
+    bk_hist_t* hist = &thread_hists[(size_t) arg];
+#endif
+
+    uint32_t seen_phase = PHASE_WARMUP;
+    wait_start();
+    while (keep_running((size_t) arg, &seen_phase, &stats)) {
+#if LATENCY_HISTOGRAM
+        const uint64_t before = bk_ticks();
+#endif
+        unsigned backoff = 1u;
+        while (!tryacquire(&shared.lock, &ctx)) {
+            stats.failed_tryacquires++;
+            if (yield_backoff) {
+                sched_yield();
+                continue;
+            }
+            delay_loop(backoff);
+            backoff = backoff < TRYLOCK_MAX_BACKOFF ? 2u * backoff : TRYLOCK_MAX_BACKOFF;
+        }
+#if LATENCY_HISTOGRAM
+        bk_hist_record(hist, bk_ticks() - before);
+#endif
+        stats.count++;
+        write_section();
+        release(&shared.lock, &ctx);
+
+        delay_loop(NCS_LENGTH);
+    }
+
+    thread_done((size_t) arg, &stats);
+    return NULL;
+}
+
+static inline __attribute__((always_inline)) void* run_thread_rw_with(
+    void* arg,
+    lock_read_begin_fn read_begin,
+    lock_read_end_fn read_end,
+    lock_op_fn write_acquire,
+    lock_op_fn write_release) {
+    thread_stats_t stats = {0};
+    any_lock_ctx_t ctx __attribute__((aligned(CACHE_LINE_SIZE)));
+    memset(&ctx, 0, sizeof(ctx));
+    uint32_t seed = 2654435761u * ((uint32_t) (size_t) arg + 1u);
+    volatile unsigned long long read_sink;
+#if LATENCY_HISTOGRAM
+    bk_hist_t* hist = &thread_hists[(size_t) arg];
+#endif
+
+    uint32_t seen_phase = PHASE_WARMUP;
+    wait_start();
+    while (keep_running((size_t) arg, &seen_phase, &stats)) {
+        const bool is_read = (xorshift32(&seed) % 100u) < read_ratio;
+#if LATENCY_HISTOGRAM
+        const uint64_t before = bk_ticks();
+#endif
+        if (is_read) {
+            for (;;) {
+                const uint32_t token = read_begin(&shared.lock, &ctx);
+                read_sink = read_section();
+                if (!read_end(&shared.lock, &ctx, token)) {
+                    break;
+                }
+                stats.read_retries++;
+            }
+#if LATENCY_HISTOGRAM
+            /* one sample per read, from the first attempt to the one that validated */
+            bk_hist_record(hist, bk_ticks() - before);
+#endif
+            stats.reads++;
+        } else {
+            write_acquire(&shared.lock, &ctx);
+#if LATENCY_HISTOGRAM
+            bk_hist_record(hist, bk_ticks() - before);
+#endif
+            write_section();
+            write_release(&shared.lock, &ctx);
+            stats.writes++;
+        }
+        stats.count++;
+
+        delay_loop(NCS_LENGTH);
+    }
+    (void) read_sink;
+
+    thread_done((size_t) arg, &stats);
+    return NULL;
+}
+
+#define MUTEX_RUN_THREAD_DEFINE(name, ...)                                         \
+    static void* run_thread_mutex_##name(void* arg) {                              \
+        return run_thread_mutex_with(arg, name##_ops_acquire, name##_ops_release); \
+    }
+
+#define TRYLOCK_RUN_THREAD_DEFINE(name)                                                 \
+    static void* run_thread_trylock_##name(void* arg) {                                 \
+        return run_thread_trylock_with(arg, name##_ops_tryacquire, name##_ops_release); \
+    }
+
+#define RW_RUN_THREAD_DEFINE(name, ...)                      \
+    static void* run_thread_rw_##name(void* arg) {           \
+        return run_thread_rw_with(arg,                       \
+                                  name##_ops_read_begin,     \
+                                  name##_ops_read_end,       \
+                                  name##_ops_write_acquire,  \
+                                  name##_ops_write_release); \
+    }
+
+FOREACH_LOCK(MUTEX_RUN_THREAD_DEFINE, MUTEX_RUN_THREAD_DEFINE)
+FOREACH_TRYLOCK(TRYLOCK_RUN_THREAD_DEFINE)
+FOREACH_LOCK(RW_RUN_THREAD_DEFINE, RW_RUN_THREAD_DEFINE)
+FOREACH_RWLOCK(RW_RUN_THREAD_DEFINE, RW_RUN_THREAD_DEFINE)
+
+typedef struct {
+    const char* workload;
+    const char* name;
+    lock_init_fn init;
+    void* (*run_thread)(void* arg);
+} lock_bench_t;
+
+#define MUTEX_BENCH_ENTRY(name, ...) {"mutex", #name, name##_ops_init, run_thread_mutex_##name},
+#define TRYLOCK_BENCH_ENTRY(name) {"trylock", #name, name##_ops_init, run_thread_trylock_##name},
+#define RW_BENCH_ENTRY(name, ...) {"rw", #name, name##_ops_init, run_thread_rw_##name},
+
+static const lock_bench_t lock_benches[] = {
+    FOREACH_LOCK(MUTEX_BENCH_ENTRY, MUTEX_BENCH_ENTRY)
+    FOREACH_TRYLOCK(TRYLOCK_BENCH_ENTRY)
+    FOREACH_LOCK(RW_BENCH_ENTRY, RW_BENCH_ENTRY)
+    FOREACH_RWLOCK(RW_BENCH_ENTRY, RW_BENCH_ENTRY)
+};
+
+/* Benchmark of the invocation, run by the threads in each round. */
+static const lock_bench_t* lock_bench;
+
+static const lock_bench_t* find_lock_bench(const char* workload, const char* name) {
+    for (size_t i = 0u; i < sizeof(lock_benches) / sizeof(lock_benches[0]); ++i) {
+        if (strcmp(lock_benches[i].workload, workload) == 0 &&
+            strcmp(lock_benches[i].name, name) == 0) {
+            return &lock_benches[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Wait for the next round that thread k takes part in.
+ * Returns false when there is no round left and the thread must exit.
+ */
+static bool wait_round(size_t k, unsigned* seen_round) {
+    bool result = false;
+    pthread_mutex_lock(&rounds.mutex);
+    while (!rounds.quit) {
+        if (rounds.id != *seen_round) {
+            *seen_round = rounds.id;
+            if (k < rounds.nb_threads) {
+                result = true;
+                break;
+            }
+        }
+        pthread_cond_wait(&rounds.cond, &rounds.mutex);
+    }
+    pthread_mutex_unlock(&rounds.mutex);
     return result;
 }
 
-int main() {
-    unsigned long thread_counts[NB_THREADS];
-    unsigned long global_count = 0u;
+/*
+ * Start a round for the first nb_threads threads, or make all the threads exit when quit is set.
+ */
+static void start_round(size_t nb_threads, bool quit) {
+    pthread_mutex_lock(&rounds.mutex);
+    rounds.id++;
+    rounds.nb_threads = nb_threads;
+    rounds.quit = quit;
+    pthread_cond_broadcast(&rounds.cond);
+    pthread_mutex_unlock(&rounds.mutex);
+}
 
-    vatomic32_init(&must_stop, 0);
-    lock_init(&lock);
+/*
+ * Body of each thread: run the benchmark loop in every round it takes part in. The hardware
+ * counters of the thread are opened once, out of the measurement windows.
+ */
+static void* run_worker(void* arg) {
+    const size_t k = (size_t) arg;
+    if (thread_perf != NULL) {
+        perf_counters_open(&thread_perf[k], perf_raw_config);
+    }
+    unsigned seen_round = 0u;
+    while (wait_round(k, &seen_round)) {
+        lock_bench->run_thread(arg);
+    }
+    if (thread_perf != NULL) {
+        perf_counters_close(&thread_perf[k]);
+    }
+    return NULL;
+}
 
-    pthread_t pthreads[NB_THREADS];
-    for (size_t k = 0u; k < NB_THREADS; ++k) {
-        pthread_attr_t pthread_attr;
-        pthread_attr_init(&pthread_attr);
-        pthread_create(&pthreads[k],
-                       &pthread_attr,
-                       run_thread,
-                       NULL);
-        pthread_attr_destroy(&pthread_attr);
+/*
+ * Parse a comma-separated list of integers in [min_value, max_value] into values (at most
+ * max_values entries). Returns the number of parsed values, or -1 if the list is ill-formed or
+ * has more than max_values entries.
+ */
+static int parse_int_list(const char* list, int values[], size_t max_values, long min_value,
+                          long max_value) {
+    int nb_values = 0;
+    const char* cursor = list;
+
+    while (*cursor != '\0' && (size_t) nb_values < max_values) {
+        char* end;
+        const long value = strtol(cursor, &end, 10);
+        if (end == cursor || value < min_value || value > max_value) {
+            return -1;
+        }
+        values[nb_values++] = (int) value;
+        cursor = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return -1;
+        }
+    }
+    if (*cursor != '\0') {
+        return -1;
+    }
+
+    return nb_values;
+}
+
+static void sleep_until_ns(uint64_t deadline_ns) {
+    const struct timespec deadline = {
+        .tv_sec = (time_t) (deadline_ns / 1000000000ull),
+        .tv_nsec = (long) (deadline_ns % 1000000000ull),
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) != 0) {
+    }
+}
+
+#if LATENCY_HISTOGRAM
+/* Print the percentiles of a histogram in the key=value; format of the output, in nanoseconds. */
+static void print_hist(const char* prefix, const bk_hist_t* hist, double ns_per_tick) {
+    printf(";%s_p50_ns=%.0f", prefix, (double) bk_hist_percentile(hist, 50.0) * ns_per_tick);
+    printf(";%s_p90_ns=%.0f", prefix, (double) bk_hist_percentile(hist, 90.0) * ns_per_tick);
+    printf(";%s_p99_ns=%.0f", prefix, (double) bk_hist_percentile(hist, 99.0) * ns_per_tick);
+    printf(";%s_p999_ns=%.0f", prefix, (double) bk_hist_percentile(hist, 99.9) * ns_per_tick);
+    printf(";%s_max_ns=%.0f", prefix, (double) hist->max * ns_per_tick);
+}
+#endif
+
+/*
+ * Print the hardware counters in the key=value; format of the output: the total of each event
+ * counted by all the threads, and the per-thread values as <event>_t<k>.
+ */
+static void print_perf_counters(size_t nb_threads) {
+    uint64_t totals[PERF_NB_EVENTS] = {0};
+    bool counted[PERF_NB_EVENTS];
+    for (int i = 0; i < PERF_NB_EVENTS; ++i) {
+        counted[i] = true;
+        for (size_t k = 0u; k < nb_threads; ++k) {
+            counted[i] = counted[i] && thread_perf[k].fds[i] >= 0;
+            totals[i] += thread_perf[k].values[i];
+        }
+        if (counted[i]) {
+            printf(";%s=%llu", perf_event_names[i], (unsigned long long) totals[i]);
+        }
+    }
+    if (!counted[PERF_EVENT_CYCLES] && !counted[PERF_EVENT_INSTRUCTIONS] &&
+        !counted[PERF_EVENT_LLC_MISSES] && !counted[PERF_EVENT_RAW]) {
+        fprintf(stderr, "No hardware counter could be opened, see perf_event_paranoid\n");
+    }
+    if (counted[PERF_EVENT_CYCLES] && counted[PERF_EVENT_INSTRUCTIONS] &&
+        totals[PERF_EVENT_CYCLES] > 0u) {
+        printf(";ipc=%.3f",
+               (double) totals[PERF_EVENT_INSTRUCTIONS] / (double) totals[PERF_EVENT_CYCLES]);
+    }
+    for (size_t k = 0u; k < nb_threads; ++k) {
+        for (int i = 0; i < PERF_NB_EVENTS; ++i) {
+            if (counted[i]) {
+                printf(";%s_t%zu=%llu", perf_event_names[i], k,
+                       (unsigned long long) thread_perf[k].values[i]);
+            }
+        }
+    }
+}
+
+/* Settings of the measurement rounds, shared by all the rounds of the invocation. */
+typedef struct {
+    unsigned long nb_repetitions;
+    unsigned long sample_period_ms;
+    const char* samples_path; /* suffixed by .<round> when there are several rounds */
+    bool several_rounds;
+    double ns_per_tick;
+} round_settings_t;
+
+/*
+ * Run one round with the first nb_threads threads (which are blocked in wait_round) and print its
+ * results as one line. Returns false if the round could not run.
+ */
+static bool run_round(const round_settings_t* settings, unsigned round, size_t nb_threads,
+                      unsigned long repetition) {
+    /* Reset the shared state left by the previous round, while the threads are blocked. */
+    vatomic32_write(&shared.phase, PHASE_INIT);
+    vatomic32_write(&nb_ready_threads, 0u);
+    vatomic32_write(&nb_done_threads, 0u);
+    lock_bench->init(&shared.lock);
+    memset(thread_stats, 0, nb_threads * sizeof(*thread_stats));
+    for (size_t k = 0u; k < nb_threads; ++k) {
+        if (thread_progress != NULL) {
+            vatomic64_write_rlx(&thread_progress[k].count, 0u);
+        }
+#if LATENCY_HISTOGRAM
+        bk_hist_init(&thread_hists[k]);
+#endif
+    }
+
+    /* Optional time series of the per-thread progress, sampled by the main thread. */
+    sampler_t sampler = {0};
+    if (settings->sample_period_ms > 0u) {
+        size_t nb_rows = RUN_DURATION_SECONDS * 1000u / settings->sample_period_ms + 1u;
+        nb_rows = nb_rows < SAMPLES_MAX_ROWS ? nb_rows : SAMPLES_MAX_ROWS;
+        if (!sampler_init(&sampler, nb_threads, nb_rows)) {
+            fprintf(stderr, "Failed to allocate %zu samples\n", nb_rows);
+            return false;
+        }
     }
 
-    sleep(RUN_DURATION_SECONDS);
-    vatomic32_write(&must_stop, 1);
+    /*
+     * Release all the threads at once, then warm up and measure. The main thread sleeps while
+     * waiting, so that it does not hold a CPU the threads need to reach the barrier.
+     */
+    start_round(nb_threads, false);
+    const struct timespec ready_poll = {.tv_sec = 0, .tv_nsec = 100000L};
+    while (vatomic32_read(&nb_ready_threads) != nb_threads) {
+        nanosleep(&ready_poll, NULL);
+    }
+#if WARMUP_MS > 0
+    vatomic32_write(&shared.phase, PHASE_WARMUP);
+    const struct timespec warmup = {
+        .tv_sec = WARMUP_MS / 1000,
+        .tv_nsec = (WARMUP_MS % 1000) * 1000000L,
+    };
+    nanosleep(&warmup, NULL);
+#endif
+    const uint64_t start_ns = bk_now_ns();
+    vatomic32_write(&shared.phase, PHASE_MEASURE);
+    if (settings->sample_period_ms > 0u) {
+        const uint64_t period_ns = settings->sample_period_ms * 1000000ull;
+        const uint64_t end_ns = start_ns + RUN_DURATION_SECONDS * 1000000000ull;
+        for (uint64_t next_ns = start_ns + period_ns; next_ns <= end_ns; next_ns += period_ns) {
+            sleep_until_ns(next_ns);
+            uint64_t* row = sampler_next_row(&sampler);
+            row[0] = bk_now_ns() - start_ns;
+            for (size_t k = 0u; k < nb_threads; ++k) {
+                row[1u + k] = vatomic64_read_rlx(&thread_progress[k].count);
+            }
+        }
+        sleep_until_ns(end_ns);
+    } else {
+        sleep(RUN_DURATION_SECONDS);
+    }
+    vatomic32_write(&shared.phase, PHASE_STOP);
+    const uint64_t duration_ns = bk_now_ns() - start_ns;
 
-    for (size_t k = 0u; k < NB_THREADS; ++k) {
-        void* return_value;
-        pthread_join(pthreads[k], &return_value);
-        thread_counts[k] = (long) return_value;
-        global_count += thread_counts[k];
+    while (vatomic32_read(&nb_done_threads) != nb_threads) {
+        nanosleep(&ready_poll, NULL);
+    }
+    thread_stats_t total = {0};
+    for (size_t k = 0u; k < nb_threads; ++k) {
+        total.count += thread_stats[k].count;
+        total.reads += thread_stats[k].reads;
+        total.writes += thread_stats[k].writes;
+        total.read_retries += thread_stats[k].read_retries;
+        total.failed_tryacquires += thread_stats[k].failed_tryacquires;
+        total.voluntary_switches += thread_stats[k].voluntary_switches;
+        total.involuntary_switches += thread_stats[k].involuntary_switches;
     }
 
-    printf("global_count=%lu;duration=%u;nb_threads=%u",
-           global_count, RUN_DURATION_SECONDS, NB_THREADS);
-    for (size_t k = 0u; k < NB_THREADS; ++k) {
-        printf(";thread_%zu=%lu", k, thread_counts[k]);
+    printf("global_count=%lu;duration=%u;duration_ns=%llu;nb_threads=%zu",
+           total.count, RUN_DURATION_SECONDS, (unsigned long long) duration_ns, nb_threads);
+    if (settings->nb_repetitions > 1u) {
+        printf(";repetition=%lu", repetition);
+    }
+    if (strcmp(lock_bench->workload, "rw") == 0) {
+        printf(";read_count=%lu;write_count=%lu;read_retries=%lu",
+               total.reads, total.writes, total.read_retries);
+    } else if (strcmp(lock_bench->workload, "trylock") == 0) {
+        printf(";failed_tryacquires=%lu", total.failed_tryacquires);
+    }
+    for (size_t k = 0u; k < nb_threads; ++k) {
+        printf(";thread_%zu=%lu", k, thread_stats[k].count);
+    }
+    printf(";voluntary_switches=%lu;involuntary_switches=%lu",
+           total.voluntary_switches, total.involuntary_switches);
+    for (size_t k = 0u; k < nb_threads; ++k) {
+        printf(";voluntary_switches_t%zu=%lu;involuntary_switches_t%zu=%lu",
+               k, thread_stats[k].voluntary_switches, k, thread_stats[k].involuntary_switches);
+    }
+#if LATENCY_HISTOGRAM
+    static bk_hist_t merged_hist;
+    bk_hist_init(&merged_hist);
+    for (size_t k = 0u; k < nb_threads; ++k) {
+        bk_hist_merge(&merged_hist, &thread_hists[k]);
+    }
+    print_hist("acquire", &merged_hist, settings->ns_per_tick);
+#endif
+    if (thread_perf != NULL) {
+        print_perf_counters(nb_threads);
     }
     printf("\n");
+    fflush(stdout);
+
+    if (settings->sample_period_ms > 0u) {
+        char round_path[PATH_MAX];
+        const char* path = settings->samples_path;
+        if (settings->several_rounds) {
+            snprintf(round_path, sizeof(round_path), "%s.%u", settings->samples_path, round);
+            path = round_path;
+        }
+        FILE* samples_file = fopen(path, "w");
+        if (samples_file == NULL) {
+            fprintf(stderr, "Failed to open %s\n", path);
+            sampler_destroy(&sampler);
+            return false;
+        }
+        sampler_write_csv(&sampler, samples_file, "thread_");
+        fclose(samples_file);
+        sampler_destroy(&sampler);
+    }
+    return true;
+}
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s -l <lock> -t <nb_threads0,nb_threads1,...> [-n <repetitions>] "
+            "[-w mutex|trylock|rw] [-r <read_ratio>] "
+            "[-c <cpu0,cpu1,...>] [-s <sample_period_ms>] [-o <samples_csv>] "
+            "[-p [-x <raw_event_config>]] [-b spin|yield] [-f <fifo_priority>]\n",
+            program);
+    fprintf(stderr, "Available locks (workload/lock):");
+    for (size_t i = 0u; i < sizeof(lock_benches) / sizeof(lock_benches[0]); ++i) {
+        fprintf(stderr, " %s/%s", lock_benches[i].workload, lock_benches[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char** argv) {
+    const char* lock_name = NULL;
+    const char* workload = "mutex";
+    int thread_counts[MAX_THREAD_COUNTS];
+    int nb_thread_counts = 0;
+    const char* cpu_list = NULL;
+    bool perf_counters = false;
+    int fifo_priority = 0;
+    round_settings_t settings = {
+        .nb_repetitions = 1u,
+        .sample_period_ms = 0u,
+        .samples_path = "samples.csv",
+        .ns_per_tick = 0.0,
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:t:n:w:r:c:s:o:px:b:f:")) != -1) {
+        switch (opt) {
+            case 'l':
+                lock_name = optarg;
+                break;
+            case 't':
+                nb_thread_counts =
+                    parse_int_list(optarg, thread_counts, MAX_THREAD_COUNTS, 1, INT_MAX);
+                if (nb_thread_counts <= 0) {
+                    fprintf(stderr, "Ill-formed thread counts (at most %u): %s\n",
+                            MAX_THREAD_COUNTS, optarg);
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n': {
+                int nb_repetitions;
+                if (parse_int_list(optarg, &nb_repetitions, 1u, 1, INT_MAX) != 1) {
+                    fprintf(stderr, "Ill-formed number of repetitions: %s\n", optarg);
+                    usage(argv[0]);
+                    return 1;
+                }
+                settings.nb_repetitions = (unsigned long) nb_repetitions;
+                break;
+            }
+            case 'w':
+                workload = optarg;
+                break;
+            case 'r':
+                read_ratio = (unsigned) strtoul(optarg, NULL, 10);
+                break;
+            case 'c':
+                cpu_list = optarg;
+                break;
+            case 's':
+                settings.sample_period_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'o':
+                settings.samples_path = optarg;
+                break;
+            case 'p':
+                perf_counters = true;
+                break;
+            case 'x':
+                perf_raw_config = strtoull(optarg, NULL, 0);
+                break;
+            case 'b':
+                if (strcmp(optarg, "spin") != 0 && strcmp(optarg, "yield") != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                yield_backoff = strcmp(optarg, "yield") == 0;
+                break;
+            case 'f':
+                fifo_priority = (int) strtol(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (lock_name == NULL || nb_thread_counts <= 0 || settings.nb_repetitions == 0u ||
+        read_ratio > 100u) {
+        usage(argv[0]);
+        return 1;
+    }
+    lock_bench = find_lock_bench(workload, lock_name);
+    if (lock_bench == NULL) {
+        fprintf(stderr, "Unknown lock for the %s workload: %s\n", workload, lock_name);
+        usage(argv[0]);
+        return 1;
+    }
+    settings.several_rounds = nb_thread_counts > 1 || settings.nb_repetitions > 1u;
+
+    /* The threads are created once, as many as the largest thread count. */
+    size_t max_threads = 0u;
+    for (int c = 0; c < nb_thread_counts; ++c) {
+        max_threads = (size_t) thread_counts[c] > max_threads ? (size_t) thread_counts[c]
+                                                              : max_threads;
+    }
+
+    pthread_t* pthreads = calloc(max_threads, sizeof(*pthreads));
+    int* cpus = calloc(max_threads, sizeof(*cpus));
+    thread_stats = aligned_alloc(CACHE_LINE_SIZE, max_threads * sizeof(*thread_stats));
+    memset(thread_stats, 0, max_threads * sizeof(*thread_stats));
+    if (settings.sample_period_ms > 0u) {
+        thread_progress = aligned_alloc(CACHE_LINE_SIZE, max_threads * sizeof(*thread_progress));
+        for (size_t k = 0u; k < max_threads; ++k) {
+            vatomic64_init(&thread_progress[k].count, 0u);
+        }
+    }
+
+    /* Optional thread placement: thread k is pinned on cpus[k % nb_cpus]. */
+    int nb_cpus = 0;
+    if (cpu_list != NULL) {
+        nb_cpus = parse_int_list(cpu_list, cpus, max_threads, 0, CPU_SETSIZE - 1);
+        if (nb_cpus <= 0) {
+            fprintf(stderr, "Ill-formed CPU list (at most %zu CPUs): %s\n", max_threads, cpu_list);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    /*
+     * Optional real-time policy: the threads run with SCHED_FIFO at fifo_priority, and are then
+     * never preempted by the threads of the same priority, only by the main thread that runs one
+     * priority higher to end the run on time.
+     */
+    if (fifo_priority != 0) {
+        const int max_priority = sched_get_priority_max(SCHED_FIFO);
+        if (fifo_priority < sched_get_priority_min(SCHED_FIFO) || fifo_priority >= max_priority) {
+            fprintf(stderr, "SCHED_FIFO priority out of range: %d (expected %d to %d)\n",
+                    fifo_priority, sched_get_priority_min(SCHED_FIFO), max_priority - 1);
+            return 1;
+        }
+        const struct sched_param main_param = {.sched_priority = fifo_priority + 1};
+        const int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &main_param);
+        if (ret != 0) {
+            fprintf(stderr, "Failed to set the SCHED_FIFO policy (error %d): %s\n", ret,
+                    strerror(ret));
+            return 1;
+        }
+    }
+
+    if (perf_counters) {
+        thread_perf = aligned_alloc(CACHE_LINE_SIZE, max_threads * sizeof(*thread_perf));
+    }
+
+    vatomic32_init(&shared.phase, PHASE_INIT);
+    vatomic32_init(&nb_ready_threads, 0);
+    vatomic32_init(&nb_done_threads, 0);
+
+#if LATENCY_HISTOGRAM
+    settings.ns_per_tick = bk_ticks_calibrate();
+    thread_hists = aligned_alloc(CACHE_LINE_SIZE, max_threads * sizeof(*thread_hists));
+#endif
+
+    for (size_t k = 0u; k < max_threads; ++k) {
+        pthread_attr_t pthread_attr;
+        pthread_attr_init(&pthread_attr);
+        if (nb_cpus > 0) {
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(cpus[k % nb_cpus], &cpu_set);
+            pthread_attr_setaffinity_np(&pthread_attr, sizeof(cpu_set), &cpu_set);
+        }
+        if (fifo_priority != 0) {
+            const struct sched_param param = {.sched_priority = fifo_priority};
+            pthread_attr_setinheritsched(&pthread_attr, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&pthread_attr, SCHED_FIFO);
+            pthread_attr_setschedparam(&pthread_attr, &param);
+        }
+        const int ret = pthread_create(&pthreads[k], &pthread_attr, run_worker, (void*) k);
+        pthread_attr_destroy(&pthread_attr);
+        if (ret != 0) {
+            fprintf(stderr, "Failed to create thread %zu (error %d)\n", k, ret);
+            return 1;
+        }
+    }
+
+    /*
+     * One round per thread count and repetition, each printing its own result line. The threads
+     * of the next round are already created and their pages already touched.
+     */
+    int ret = 0;
+    unsigned round = 0u;
+    for (int c = 0; c < nb_thread_counts && ret == 0; ++c) {
+        for (unsigned long rep = 1u; rep <= settings.nb_repetitions && ret == 0; ++rep) {
+            round++;
+            if (!run_round(&settings, round, (size_t) thread_counts[c], rep)) {
+                ret = 1;
+            }
+        }
+    }
+    start_round(0u, true);
+    for (size_t k = 0u; k < max_threads; ++k) {
+        pthread_join(pthreads[k], NULL);
+    }
+
+#if LATENCY_HISTOGRAM
+    free(thread_hists);
+#endif
+    free(thread_perf);
+    free(thread_progress);
+    free(thread_stats);
+    free(cpus);
+    free(pthreads);
 
-    return 0;
+    return ret;
 }
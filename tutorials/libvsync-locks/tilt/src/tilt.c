@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2024 Huawei Technologies Co.,Ltd. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Drop-in replacement of the pthread mutexes by a libvsync lock (TILT_LOCK, e.g. cas), meant to
+ * be loaded with LD_PRELOAD into unmodified applications.
+ *
+ * The lock is stored in place of the pthread_mutex_t, so that statically initialized mutexes
+ * (PTHREAD_MUTEX_INITIALIZER, all zeroes) are valid unlocked locks. Only the normal mutexes are
+ * supported: pthread_mutex_init fails with ENOTSUP for the recursive and error-checking types
+ * (the static initializers of these types cannot be told apart, and behave as normal mutexes).
+ *
+ * The condition variables are replaced as well, since the ones of the C library release and
+ * acquire the mutex internally: a condition variable is then a sequence number, incremented by
+ * each signal, on which the waiters sleep with a private futex. The condition variables shared
+ * between processes are not supported.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <locks.h> /* defines the name##lock_* interface of the locks. */
+
+#define TILT_CAT_(a, b) a##b
+#define TILT_CAT(a, b) TILT_CAT_(a, b)
+#define TILT_LOCK_FN(op) TILT_CAT(TILT_LOCK, lock_##op)
+
+/* Number of failed attempts of pthread_mutex_timedlock between two reads of the clock. */
+#define TILT_TIMEDLOCK_CLOCK_PERIOD 256u
+
+typedef TILT_CAT(TILT_LOCK, lock_t) tilt_lock_t;
+
+_Static_assert(sizeof(tilt_lock_t) <= sizeof(pthread_mutex_t),
+               "the lock must fit in the storage of a pthread mutex");
+
+/* Condition variable stored in place of the pthread_cond_t (all zeroes when statically set). */
+typedef struct {
+    uint32_t seq;       /* incremented by each signal, waited on with a futex */
+    uint32_t monotonic; /* whether the deadlines of timed waits are on CLOCK_MONOTONIC */
+} tilt_cond_t;
+
+_Static_assert(sizeof(tilt_cond_t) <= sizeof(pthread_cond_t),
+               "the condition variable must fit in the storage of a pthread condition variable");
+
+static inline tilt_lock_t *tilt_lock(pthread_mutex_t *mutex) {
+    return (tilt_lock_t *) mutex;
+}
+
+static inline tilt_cond_t *tilt_cond(pthread_cond_t *cond) {
+    return (tilt_cond_t *) cond;
+}
+
+int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr) {
+    int type = PTHREAD_MUTEX_NORMAL;
+    if (attr != NULL && pthread_mutexattr_gettype(attr, &type) == 0 &&
+        (type == PTHREAD_MUTEX_RECURSIVE || type == PTHREAD_MUTEX_ERRORCHECK)) {
+        return ENOTSUP;
+    }
+    TILT_LOCK_FN(init)(tilt_lock(mutex));
+    return 0;
+}
+
+int pthread_mutex_destroy(pthread_mutex_t *mutex) {
+    (void) mutex;
+    return 0;
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+    TILT_LOCK_FN(acquire)(tilt_lock(mutex));
+    return 0;
+}
+
+int pthread_mutex_trylock(pthread_mutex_t *mutex) {
+    return TILT_LOCK_FN(tryacquire)(tilt_lock(mutex)) ? 0 : EBUSY;
+}
+
+static inline bool deadline_passed(clockid_t clock, const struct timespec *deadline) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return now.tv_sec > deadline->tv_sec ||
+           (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+/*
+ * The clock is read on the first failed attempt, then once every TILT_TIMEDLOCK_CLOCK_PERIOD
+ * attempts, when the thread also yields its CPU (e.g. to the holder of the lock).
+ */
+int pthread_mutex_timedlock(pthread_mutex_t *mutex, const struct timespec *abstime) {
+    for (unsigned attempts = 0u; !TILT_LOCK_FN(tryacquire)(tilt_lock(mutex)); ++attempts) {
+        if (attempts % TILT_TIMEDLOCK_CLOCK_PERIOD != 0u) {
+            continue;
+        }
+        if (abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000L) {
+            return EINVAL;
+        }
+        if (deadline_passed(CLOCK_REALTIME, abstime)) {
+            return ETIMEDOUT;
+        }
+        if (attempts > 0u) {
+            sched_yield();
+        }
+    }
+    return 0;
+}
+
+int pthread_mutex_unlock(pthread_mutex_t *mutex) {
+    TILT_LOCK_FN(release)(tilt_lock(mutex));
+    return 0;
+}
+
+int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr) {
+    clockid_t clock = CLOCK_REALTIME;
+    int pshared = PTHREAD_PROCESS_PRIVATE;
+    if (attr != NULL) {
+        pthread_condattr_getclock(attr, &clock);
+        pthread_condattr_getpshared(attr, &pshared);
+    }
+    if (pshared == PTHREAD_PROCESS_SHARED) {
+        return ENOTSUP;
+    }
+    tilt_cond(cond)->seq = 0u;
+    tilt_cond(cond)->monotonic = clock == CLOCK_MONOTONIC;
+    return 0;
+}
+
+int pthread_cond_destroy(pthread_cond_t *cond) {
+    (void) cond;
+    return 0;
+}
+
+/*
+ * Release the mutex and sleep until the sequence number changes (or until the absolute deadline
+ * on the given clock, if any), then acquire the mutex again. Reading the sequence number before
+ * releasing the mutex ensures that a signal sent after the release is not missed; spurious
+ * wake-ups are allowed by POSIX.
+ */
+static int cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, clockid_t clock,
+                     const struct timespec *abstime) {
+    uint32_t *seq = &tilt_cond(cond)->seq;
+    const uint32_t value = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+    int err = 0;
+
+    TILT_LOCK_FN(release)(tilt_lock(mutex));
+    if (abstime == NULL) {
+        syscall(SYS_futex, seq, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+    } else {
+        const int op = FUTEX_WAIT_BITSET_PRIVATE |
+                       (clock == CLOCK_REALTIME ? FUTEX_CLOCK_REALTIME : 0);
+        if (syscall(SYS_futex, seq, op, value, abstime, NULL, FUTEX_BITSET_MATCH_ANY) == -1 &&
+            errno == ETIMEDOUT) {
+            err = ETIMEDOUT;
+        }
+    }
+    TILT_LOCK_FN(acquire)(tilt_lock(mutex));
+    return err;
+}
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
+    return cond_wait(cond, mutex, CLOCK_REALTIME, NULL);
+}
+
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                           const struct timespec *abstime) {
+    const clockid_t clock = tilt_cond(cond)->monotonic ? CLOCK_MONOTONIC : CLOCK_REALTIME;
+    return cond_wait(cond, mutex, clock, abstime);
+}
+
+int pthread_cond_clockwait(pthread_cond_t *cond, pthread_mutex_t *mutex, clockid_t clock,
+                           const struct timespec *abstime) {
+    if (clock != CLOCK_REALTIME && clock != CLOCK_MONOTONIC) {
+        return EINVAL;
+    }
+    return cond_wait(cond, mutex, clock, abstime);
+}
+
+static void cond_wake(pthread_cond_t *cond, int nb_waiters) {
+    uint32_t *seq = &tilt_cond(cond)->seq;
+    __atomic_fetch_add(seq, 1u, __ATOMIC_RELEASE);
+    syscall(SYS_futex, seq, FUTEX_WAKE_PRIVATE, nb_waiters, NULL, NULL, 0);
+}
+
+int pthread_cond_signal(pthread_cond_t *cond) {
+    cond_wake(cond, 1);
+    return 0;
+}
+
+int pthread_cond_broadcast(pthread_cond_t *cond) {
+    cond_wake(cond, INT_MAX);
+    return 0;
+}